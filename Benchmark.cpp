@@ -0,0 +1,478 @@
+#include "ProductKernels.h"
+#include "Random.h"
+#include "ShardedSimulation.h"
+#include "TickScheduler.h"
+#include "World.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <span>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Tick throughput benchmarks.
+ *
+ * Usage: simulated_economy_bench [--businesses N,...] [--npcs N,...] [--products N,...] [--rounds N]
+ *                                [--threads N] [--shards N,...] [--json FILE|-] [--help]
+ *
+ * Every combination of business count, NPC count and products per business runs each benchmark on a fresh world.
+ * sharded_tick runs full ticks over every listed number of worker processes, which share the --threads.
+ * Results are printed as a table and, with --json, written as JSON so runs of different versions can be compared.
+ */
+
+namespace {
+
+std::atomic<std::uint64_t> allocationCount = 0; // Calls to the global operator new since the start of the process
+
+} // namespace
+
+// Count every heap allocation of the process; the benchmarks report the difference over the measured code
+void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size != 0 ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Config {
+    std::uint32_t businesses;
+    std::uint32_t npcs;
+    std::uint32_t products; // Products per business
+};
+
+struct Options {
+    std::vector<std::uint32_t> businesses = {100, 1000};
+    std::vector<std::uint32_t> npcs = {1000, 10000};
+    std::vector<std::uint32_t> products = {8};
+    std::uint32_t rounds = 20;  // Measured iterations of every benchmark
+    std::size_t threads = 0;    // Threads of the full tick, 0 uses every hardware thread
+    std::vector<std::uint32_t> shards = {1, 2, 4}; // Worker processes of sharded_tick
+    std::string json;           // JSON output, empty for none and "-" for stdout
+};
+
+struct Result {
+    std::string name;
+    Config config;
+    std::uint64_t iterations = 0;  // Measured rounds
+    std::uint64_t operations = 0;  // Measured entity updates or calls
+    double seconds = 0;            // Time spent in the measured code
+    std::uint64_t allocations = 0; // Heap allocations made by the measured code
+    double speedup = 0;            // Over business_update for the batch updates, over one shard for sharded_tick
+    std::uint32_t shards = 0;      // Worker processes, for sharded_tick only
+};
+
+/**
+ * @brief Accumulates the time and allocations of the measured parts of a benchmark.
+ */
+class Meter {
+  public:
+    template <class F> void measure(F&& body) {
+        std::uint64_t before = allocationCount.load(std::memory_order_relaxed);
+        Clock::time_point start = Clock::now();
+        body();
+        seconds_ += std::chrono::duration<double>(Clock::now() - start).count();
+        allocations_ += allocationCount.load(std::memory_order_relaxed) - before;
+    }
+
+    double seconds() const noexcept { return seconds_; }
+    std::uint64_t allocations() const noexcept { return allocations_; }
+
+  private:
+    double seconds_ = 0;
+    std::uint64_t allocations_ = 0;
+};
+
+std::vector<std::uint32_t> parseList(const std::string& text) {
+    std::vector<std::uint32_t> values;
+    std::stringstream stream(text);
+    std::string value;
+    while (std::getline(stream, value, ',')) {
+        values.push_back(static_cast<std::uint32_t>(std::stoul(value)));
+    }
+    return values;
+}
+
+/**
+ * @brief Populate a world with businesses selling a set of products and NPCs.
+ */
+void populate(World& world, const Config& config) {
+    RandomStream rng = RandomService::global().stream(RandomDomain::World, 0);
+    std::uint32_t names = std::max<std::uint32_t>(64, config.products); // Distinct product names in the market
+    for (std::uint32_t b = 0; b < config.businesses; ++b) {
+        Business* business = world.business(world.createBusiness("Business" + std::to_string(b)));
+        for (std::uint32_t p = 0; p < config.products; ++p) {
+            std::string product = "Product" + std::to_string((b * 7 + p) % names);
+            business->addProduct(product, 5 + rng.uniform() * 15);
+        }
+    }
+    for (std::uint32_t n = 0; n < config.npcs; ++n) {
+        world.createNpc("Npc" + std::to_string(n));
+    }
+}
+
+/**
+ * @brief Run a few full ticks, so NPCs hold stocks and the order books have traded.
+ */
+void warmUp(World& world, TickScheduler& scheduler, std::uint64_t& tick) {
+    for (int i = 0; i < 3; ++i) {
+        RandomService::global().setTick(tick++);
+        scheduler.tick(world);
+    }
+}
+
+template <class F> void forEachBusiness(World& world, F&& body) {
+    for (std::uint32_t i = 0; i < world.businesses().slots(); ++i) {
+        if (Business* business = world.businesses().at(i)) {
+            body(*business);
+        }
+    }
+}
+
+template <class F> void forEachNpc(World& world, F&& body) {
+    for (std::uint32_t i = 0; i < world.npcs().slots(); ++i) {
+        if (Npc* npc = world.npcs().at(i)) {
+            body(*npc);
+        }
+    }
+}
+
+// Auction every business and settle the reports with the NPCs, as the end of a tick does, so that no reservation
+// or pending order is carried into the next round; orders must be tagged with the slot of their NPC
+void settleAuctions(World& world) {
+    std::vector<JournalEntry> journal;
+    forEachBusiness(world, [&](Business& business) {
+        business.auction();
+        for (const StockFill& fill : business.orderBook().reports()) {
+            world.npcs().at(static_cast<std::uint32_t>(fill.owner))->settle(world, fill, journal);
+        }
+    });
+    world.ledger().transfer(journal);
+}
+
+Result businessUpdate(const Config& config, const Options& options) {
+    World world;
+    populate(world, config);
+
+    Meter meter;
+    std::uint64_t operations = 0;
+    for (std::uint32_t round = 0; round < options.rounds; ++round) {
+        RandomService::global().setTick(round);
+        meter.measure([&] { forEachBusiness(world, [&](Business& business) { business.update(); }); });
+        operations += world.businesses().size();
+    }
+    return {"business_update", config, options.rounds, operations, meter.seconds(), meter.allocations()};
+}
+
+Result businessUpdateBatch(const Config& config, const Options& options, SimdLevel level) {
+    World world;
+    populate(world, config);
+    TickScheduler scheduler(1); // One thread, like business_update, so the difference is the batch kernel
+
+    Meter meter;
+    std::uint64_t operations = 0;
+    for (std::uint32_t round = 0; round < options.rounds; ++round) {
+        RandomService::global().setTick(round);
+        meter.measure([&] { scheduler.updateBusinesses(world, level); });
+        operations += world.businesses().size();
+    }
+    return {std::string("business_update_") + simdName(level), config, options.rounds, operations, meter.seconds(),
+            meter.allocations()};
+}
+
+Result npcUpdate(const Config& config, const Options& options) {
+    World world;
+    populate(world, config);
+    TickScheduler scheduler(options.threads);
+    std::uint64_t tick = 0;
+    warmUp(world, scheduler, tick);
+
+    Meter meter;
+    std::uint64_t operations = 0;
+    CandidateSelector everyBusiness;
+    for (std::uint32_t round = 0; round < options.rounds; ++round) {
+        RandomService::global().setTick(tick++);
+        everyBusiness.prepare(world); // Once per tick, as the scheduler does
+        meter.measure([&] { forEachNpc(world, [&](Npc& npc) { npc.update(world, everyBusiness); }); });
+        operations += world.npcs().size();
+        settleAuctions(world); // Not measured
+    }
+    return {"npc_update", config, options.rounds, operations, meter.seconds(), meter.allocations()};
+}
+
+Result npcBuy(const Config& config, const Options& options) {
+    World world;
+    populate(world, config);
+
+    Meter meter;
+    std::uint64_t operations = 0;
+    std::uint32_t slots = world.businesses().slots();
+    for (std::uint32_t round = 0; round < options.rounds; ++round) {
+        RandomService::global().setTick(round);
+        RandomStream rng = RandomService::global().stream(RandomDomain::World, 1);
+        meter.measure([&] {
+            forEachNpc(world, [&](Npc& npc) {
+                Business& business = *world.businesses().at(static_cast<std::uint32_t>(rng.next() % slots));
+                std::span<const ProductId> products = business.products();
+                if (products.empty()) {
+                    return; // Benchmarked with --products 0
+                }
+                npc.buy(world, business, products[rng.next() % products.size()], 1);
+            });
+        });
+        operations += world.npcs().size();
+        forEachBusiness(world, [](Business& business) { business.update(); }); // Restock, not measured
+    }
+    return {"npc_buy", config, options.rounds, operations, meter.seconds(), meter.allocations()};
+}
+
+Result stockOrders(const Config& config, const Options& options) {
+    World world;
+    populate(world, config);
+    TickScheduler scheduler(options.threads);
+    std::uint64_t tick = 0;
+    warmUp(world, scheduler, tick);
+
+    Meter meter;
+    std::uint64_t operations = 0;
+    std::uint32_t slots = world.businesses().slots();
+    std::vector<StockOrder> orders; // Reused by every round, as the scheduler reuses its buffers
+    std::vector<std::size_t> ends(world.npcs().slots()); // End of the orders of every NPC slot in orders
+    for (std::uint32_t round = 0; round < options.rounds; ++round) {
+        RandomService::global().setTick(tick++);
+        RandomStream rng = RandomService::global().stream(RandomDomain::World, 2);
+        orders.clear();
+        meter.measure([&] {
+            forEachNpc(world, [&](Npc& npc) {
+                const Business* business = world.businesses().at(static_cast<std::uint32_t>(rng.next() % slots));
+                if (business != nullptr) {
+                    npc.buyStock(business, 1, orders);
+                    npc.sellStock(business, 1, orders);
+                }
+                ends[npc.handle().index] = orders.size();
+            });
+        });
+        operations += 2 * world.npcs().size();
+
+        std::size_t begin = 0; // Submit and settle the orders, not measured
+        forEachNpc(world, [&](Npc& npc) {
+            std::uint32_t slot = npc.handle().index;
+            for (; begin < ends[slot]; ++begin) {
+                world.business(orders[begin].business)->orderBook().submit(orders[begin], slot);
+            }
+        });
+        settleAuctions(world);
+    }
+    return {"stock_orders", config, options.rounds, operations, meter.seconds(), meter.allocations()};
+}
+
+Result worldTick(const Config& config, const Options& options) {
+    World world;
+    populate(world, config);
+    TickScheduler scheduler(options.threads);
+
+    Meter meter;
+    std::uint64_t operations = 0;
+    for (std::uint32_t round = 0; round < options.rounds; ++round) {
+        RandomService::global().setTick(round);
+        operations += world.businesses().size() + world.npcs().size();
+        meter.measure([&] { scheduler.tick(world); });
+    }
+    return {"world_tick", config, options.rounds, operations, meter.seconds(), meter.allocations()};
+}
+
+Result shardedTick(const Config& config, const Options& options, std::uint32_t shards) {
+    SimulationConfig simulation;
+    simulation.businesses = config.businesses;
+    simulation.npcs = config.npcs;
+    simulation.products = config.products;
+    simulation.warmupTicks = 1;
+    simulation.ticks = options.rounds;
+    simulation.seed = RandomService::global().seed();
+    simulation.hasSeed = true;
+    simulation.threads = options.threads == 0 ? 0 : std::max<std::size_t>(1, options.threads / shards);
+    simulation.shards = shards;
+
+    // The workers allocate in their own processes, out of reach of the counter
+    SimulationSummary summary;
+    if (!ShardedSimulation(simulation).run(summary)) {
+        return {"sharded_tick", config}; // No iterations: workers cannot be forked here
+    }
+    Result result{"sharded_tick", config, summary.ticks, summary.entityUpdates, summary.seconds, 0};
+    result.shards = shards;
+    return result;
+}
+
+void writeJson(std::ostream& out, const std::vector<Result>& results, const Options& options) {
+    out << std::defaultfloat << std::setprecision(6);
+    std::size_t threads = options.threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : options.threads;
+    out << "{\n  \"threads\": " << threads << ",\n  \"benchmarks\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result& result = results[i];
+        out << "    {\"name\": \"" << result.name << "\", \"businesses\": " << result.config.businesses
+            << ", \"npcs\": " << result.config.npcs << ", \"products\": " << result.config.products
+            << ", \"iterations\": " << result.iterations << ", \"seconds\": " << result.seconds
+            << ", \"iterations_per_sec\": " << result.iterations / result.seconds
+            << ", \"ns_per_op\": " << result.seconds * 1e9 / result.operations
+            << ", \"allocations_per_iteration\": "
+            << static_cast<double>(result.allocations) / result.iterations;
+        if (result.speedup != 0) {
+            out << ", \"speedup\": " << result.speedup;
+        }
+        if (result.shards != 0) {
+            out << ", \"shards\": " << result.shards;
+        }
+        out << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+void printUsage() {
+    std::cout << "Usage: simulated_economy_bench [options]\n"
+                 "  --businesses N,...  business counts of the grid (default 100,1000)\n"
+                 "  --npcs N,...        NPC counts of the grid (default 1000,10000)\n"
+                 "  --products N,...    products per business of the grid (default 8)\n"
+                 "  --rounds N          measured iterations of every benchmark (default 20)\n"
+                 "  --threads N         threads of the full tick, 0 for all (default 0)\n"
+                 "  --shards N,...      worker processes of sharded_tick, empty for none (default 1,2,4)\n"
+                 "  --json FILE|-       also write the results as JSON, to stdout with -\n";
+}
+
+// Set an option from its name and value, false if either is invalid
+bool setOption(Options& options, const std::string& name, const std::string& value) {
+    try {
+        if (name == "businesses") {
+            options.businesses = parseList(value);
+        } else if (name == "npcs") {
+            options.npcs = parseList(value);
+        } else if (name == "products") {
+            options.products = parseList(value);
+        } else if (name == "rounds") {
+            options.rounds = static_cast<std::uint32_t>(std::stoul(value));
+        } else if (name == "threads") {
+            options.threads = std::stoul(value);
+        } else if (name == "shards") {
+            options.shards = parseList(value);
+        } else if (name == "json") {
+            options.json = value;
+        } else {
+            return false; // Unknown option
+        }
+    } catch (const std::exception&) {
+        return false; // Not a number
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option == "--help" || option == "-h") {
+            printUsage();
+            return 0;
+        }
+        if (option.rfind("--", 0) != 0 || i + 1 == argc) {
+            std::cerr << "Invalid argument " << option << ", see --help." << std::endl;
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (!setOption(options, option.substr(2), value)) {
+            std::cerr << "Invalid option " << option << " " << value << ", see --help." << std::endl;
+            return 1;
+        }
+    }
+    RandomService::global().seed(1); // Every version benchmarks the same market
+
+    std::vector<std::function<Result(const Config&, const Options&)>> benchmarks = {businessUpdate};
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::Avx2, SimdLevel::Avx512}) {
+        if (simdSupported(level)) {
+            benchmarks.push_back([level](const Config& config, const Options& options) {
+                return businessUpdateBatch(config, options, level);
+            });
+        }
+    }
+    benchmarks.insert(benchmarks.end(), {npcUpdate, npcBuy, stockOrders, worldTick});
+    for (std::uint32_t shards : options.shards) {
+        benchmarks.push_back([shards](const Config& config, const Options& options) {
+            return shardedTick(config, options, shards); // Forked while no benchmark thread runs
+        });
+    }
+
+    std::vector<Result> results;
+    for (std::uint32_t businesses : options.businesses) {
+        for (std::uint32_t npcs : options.npcs) {
+            for (std::uint32_t products : options.products) {
+                double perObject = 0; // Seconds per business update of business_update
+                double perShard = 0;  // Seconds per entity update of sharded_tick over one shard
+                for (const auto& benchmark : benchmarks) {
+                    Result result = benchmark({businesses, npcs, products}, options);
+                    if (result.iterations == 0) {
+                        std::cerr << result.name << " is not supported on this platform" << std::endl;
+                        continue;
+                    }
+                    double perUpdate = result.seconds / result.operations;
+                    if (result.name == "business_update") {
+                        perObject = perUpdate;
+                    } else if (result.name.starts_with("business_update_")) {
+                        result.speedup = perObject / perUpdate;
+                    } else if (result.shards == 1) {
+                        perShard = perUpdate;
+                    } else if (result.shards != 0 && perShard != 0) {
+                        result.speedup = perShard / perUpdate;
+                    }
+                    std::cout << std::left << std::setw(16) << result.name << " businesses=" << std::setw(7)
+                              << businesses << " npcs=" << std::setw(7) << npcs << " products=" << std::setw(4)
+                              << products << std::right << std::fixed << std::setprecision(1)
+                              << " iter/s=" << std::setw(10) << result.iterations / result.seconds
+                              << " ns/op=" << std::setw(8) << result.seconds * 1e9 / result.operations
+                              << " allocs/iter=" << std::setw(10)
+                              << static_cast<double>(result.allocations) / result.iterations;
+                    if (result.shards != 0) {
+                        std::cout << " shards=" << result.shards;
+                    }
+                    if (result.speedup != 0) {
+                        std::cout << " speedup=" << std::setprecision(2) << result.speedup << "x";
+                    }
+                    std::cout << std::endl;
+                    results.push_back(result);
+                }
+            }
+        }
+    }
+
+    if (options.json == "-") {
+        writeJson(std::cout, results, options);
+    } else if (!options.json.empty()) {
+        std::ofstream out(options.json);
+        writeJson(out, results, options);
+    }
+    return 0;
+}
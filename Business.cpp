@@ -1,33 +1,87 @@
 #include "Business.h"
-#include <iostream>
-#include <random>
+#include "BusinessIdAllocator.h"
+#include "EventLog.h"
+#include "MarketAggregates.h"
+#include "Random.h"
+#include <algorithm>
 #include <string>
-#include <unordered_map>
-#include <unordered_set>
+#include <string_view>
+#include <utility>
 #include <vector>
 
-// Static member variable to keep track of used IDs
-std::unordered_set<int> Business::usedIDs_ = {}; // Initialize the set of used IDs
+Business::Business(std::string_view name, std::string_view description, ProductTable& table)
+    : table_(&table), slot_(table.allocateSlot()), ID(BusinessIdAllocator::global().allocate()),
+      name_(NameTable::global().add(name)), description_(NameTable::global().add(description)) {
+    // Initialize the business with a name, a description and a fresh ID
+}
 
-Business::Business(std::string name, std::string description)
-    : name_(name), description_(description), initialProductPrices_({}) {
-    // Initialize the business with a name and description
-    std::random_device rd;  // Random device for generating random numbers
-    std::mt19937 gen(rd()); // Mersenne Twister random number generator
-    std::uniform_int_distribution<> dis(100000000, 999999999);
+Business::Business(std::string_view name, std::string_view description, ProductTable& table, int id)
+    : table_(&table), slot_(table.allocateSlot()), ID(id), name_(NameTable::global().add(name)),
+      description_(NameTable::global().add(description)) {}
 
-    int newID;
+Business::~Business() {
+    if (slot_ != ProductTable::NO_SLOT) {
+        table_->releaseSlot(slot_); // Give the product rows back to the table
+    }
+    NameTable::global().release(name_);
+    NameTable::global().release(description_);
+}
 
-    do {
-        newID = dis(gen); // Generate a random ID for the business
-    } while (usedIDs_.find(newID = dis(gen)) != usedIDs_.end()); // Generate a unique ID for the business
+Business::Business(const Business& other)
+    : stockPrice_(other.stockPrice_), stockDemand_(other.stockDemand_), balance_(other.balance_),
+      sharesOutstanding_(other.sharesOutstanding_), table_(other.table_), slot_(other.table_->cloneSlot(other.slot_)),
+      ID(other.ID), name_(NameTable::global().add(other.name())),
+      description_(NameTable::global().add(other.description())), score_(other.score_) {
+    // Pending orders belong to the original business, the copy starts with an empty book
+}
 
-    usedIDs_.insert(newID); // Insert the new ID into the set of used IDs
-    ID = newID;             // Set the ID of the business
+Business::Business(Business&& other) noexcept
+    : stockPrice_(other.stockPrice_), stockDemand_(other.stockDemand_), balance_(other.balance_),
+      sharesOutstanding_(other.sharesOutstanding_), table_(other.table_),
+      slot_(std::exchange(other.slot_, ProductTable::NO_SLOT)), ID(other.ID), orderBook_(std::move(other.orderBook_)),
+      name_(std::exchange(other.name_, EMPTY_NAME)), description_(std::exchange(other.description_, EMPTY_NAME)),
+      score_(other.score_) {}
+
+Business& Business::operator=(Business&& other) noexcept {
+    if (this != &other) {
+        if (slot_ != ProductTable::NO_SLOT) {
+            table_->releaseSlot(slot_);
+        }
+        stockPrice_ = other.stockPrice_;
+        NameTable::global().release(name_);
+        NameTable::global().release(description_);
+        name_ = std::exchange(other.name_, EMPTY_NAME);
+        description_ = std::exchange(other.description_, EMPTY_NAME);
+        score_ = other.score_;
+        balance_ = other.balance_;
+        stockDemand_ = other.stockDemand_;
+        ID = other.ID;
+        orderBook_ = std::move(other.orderBook_);
+        sharesOutstanding_ = other.sharesOutstanding_;
+        table_ = other.table_;
+        slot_ = std::exchange(other.slot_, ProductTable::NO_SLOT); // Take over the rows of the other business
+        if (aggregates_ != nullptr) {
+            aggregates_->markProducts(); // Every row and the stock changed at once
+            aggregates_->markStock(handle_);
+        }
+    }
+    return *this;
 }
 
-int* Business::getID() noexcept {
-    return &ID; // Return the ID of the business
+Business& Business::operator=(const Business& other) {
+    if (this != &other) {
+        Business copy(other); // Clone the rows first so a failed copy leaves this business untouched
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+int Business::id() const noexcept {
+    return ID; // Return the ID of the business
+}
+
+BusinessHandle Business::handle() const noexcept {
+    return handle_; // Return the handle of the business
 }
 
 double Business::stockPrice() const noexcept {
@@ -38,104 +92,159 @@ const double Business::initialStockPrice() const noexcept {
     return INITIAL_STOCK_PRICE; // Return the initial stock price of the business
 }
 
-std::string Business::name() const noexcept {
-    return name_; // Return the name of the business
+std::string_view Business::name() const noexcept {
+    return NameTable::global().get(name_); // Return the name of the business
 }
 
-std::string Business::description() const noexcept {
-    return description_; // Return the description of the business
+std::string_view Business::description() const noexcept {
+    return NameTable::global().get(description_); // Return the description of the business
 }
 
-void Business::setDescription(const std::string& description) noexcept {
-    description_ = description; // Set the description of the business
+void Business::setDescription(const std::string& description) {
+    NameTable::global().assign(description_, description); // Set the description of the business
 }
 
-void Business::setName(const std::string& name) noexcept {
-    name_ = name; // Set the name of the business
+void Business::setName(const std::string& name) {
+    NameTable::global().assign(name_, name); // Set the name of the business
 }
 
-const auto& Business::supply() const {
-    return supply_; // Return the supply of the business
+std::span<const int> Business::supply() const noexcept {
+    return table_->supply(slot_); // Return the supply of the business
 }
 
-int Business::supply(const std::string& product) const {
-    auto it = supply_.find(product); // Find the product in the supply map
-    if (it != supply_.end()) {
-        return it->second; // Return the supply of the product if found
+int Business::supply(ProductId product) const {
+    std::size_t row = table_->find(slot_, product); // Find the product in the business's block
+    if (row != ProductTable::NPOS) {
+        return table_->supply(slot_)[row - table_->offset(slot_)]; // Return the supply of the product if found
     }
     return 0; // Return 0 if the product is not found in the supply
 }
 
+int Business::supply(const std::string& product) const {
+    return supply(ProductCatalog::global().find(product)); // Unknown names never match a row
+}
+
+void Business::setSupply(ProductId product, int amount) {
+    std::size_t row = table_->find(slot_, product);
+    if (row == ProductTable::NPOS) {
+        return; // Only products offered by the business have a supply
+    }
+    int& supply = table_->supply(slot_)[row - table_->offset(slot_)];
+    if (aggregates_ != nullptr) {
+        aggregates_->addSupply(product, static_cast<std::int64_t>(amount) - supply);
+    }
+    supply = amount; // Set the supply of the product in the business
+}
+
 void Business::setSupply(const std::string& product, int amount) {
-    supply_[product] = amount; // Set the supply of the product in the business
+    setSupply(ProductCatalog::global().find(product), amount);
 }
 
-const auto& Business::demand() const {
-    return demand_; // Return the demand of the business
+std::span<const double> Business::demand() const noexcept {
+    return table_->demand(slot_); // Return the demand of the business
 }
 
-const auto& Business::resupplyRates() const {
-    return resupplyRates_; // Return the resupply rates of the business
+std::span<const double> Business::resupplyRates() const noexcept {
+    return table_->resupplyRates(slot_); // Return the resupply rates of the business
 }
 
-const auto& Business::InitialProductPrices() const {
-    return initialProductPrices_; // Return the initial product prices of the
-                                  // business
+std::span<const double> Business::InitialProductPrices() const noexcept {
+    return table_->initialPrices(slot_); // Return the initial product prices of the business
 }
 
-const auto& Business::products() const {
-    return products_; // Return the products of the business
+std::span<const ProductId> Business::products() const noexcept {
+    return table_->products(slot_); // Return the products of the business
 }
 
-void Business::addBalance(double amount) {
-    balance_ += amount; // Add the specified amount to the business balance
+std::span<const double> Business::prices() const noexcept {
+    return table_->prices(slot_); // Return the current product prices of the business
+}
+
+PurchaseResult Business::sellProduct(ProductId product, int amount) {
+    std::size_t row = table_->find(slot_, product);
+    if (row == ProductTable::NPOS) {
+        return PurchaseResult::NotAvailable; // The business does not offer the product
+    }
+    int& supply = table_->supply(slot_)[row - table_->offset(slot_)];
+    if (supply == 0) {
+        return PurchaseResult::NotAvailable; // Out of stock
+    }
+    if (supply < amount) {
+        return PurchaseResult::NotEnoughSupply;
+    }
+    supply -= amount; // Hand the units over
+    if (aggregates_ != nullptr) {
+        aggregates_->addSupply(product, -amount);
+    }
+    return PurchaseResult::Filled;
+}
+
+double Business::price(ProductId product) const {
+    std::size_t row = table_->find(slot_, product);
+    if (row == ProductTable::NPOS) {
+        return 0.0; // Products the business does not offer have no price
+    }
+    return table_->prices(slot_)[row - table_->offset(slot_)];
 }
 
 std::vector<std::string> Business::productNames() const {
+    const ProductCatalog& catalog = ProductCatalog::global();
     std::vector<std::string> names;
-    for (const auto& product : products_) {
-        names.push_back(product.first); // Add the product name to the vector
+    for (ProductId product : table_->products(slot_)) {
+        names.push_back(catalog.name(product)); // Add the product name to the vector
     }
     return names; // Return the vector of product names
 }
 
 std::vector<double> Business::productPrices() const {
-    std::vector<double> prices;
-    for (const auto& product : products_) {
-        prices.push_back(product.second); // Add the product price to the vector
+    auto prices = table_->prices(slot_);
+    return {prices.begin(), prices.end()}; // Return the vector of product prices
+}
+
+void Business::addProduct(ProductId product, double price) {
+    if (table_->find(slot_, product) != ProductTable::NPOS) {
+        EventLog::emit(EventLevel::Debug, {.kind = EventKind::Rejected, .reason = RejectReason::ProductExists,
+                                           .business = static_cast<std::uint32_t>(ID), .product = product,
+                                           .price = price});
+        return; // Product already exists, do not add it again
+    }
+    // Supply, demand and resupply rate of a new product all start at 50
+    table_->insert(slot_, product, price, 50, 50, 50);
+    if (aggregates_ != nullptr) {
+        aggregates_->addRow(product, price, 50, 50);
     }
-    return prices; // Return the vector of product prices
 }
 
 void Business::addProduct(const std::string& product, double price) {
-    if (products_.find(product) != products_.end()) {
-        std::cout << "Product already exists in the business." << std::endl;
-        return; // Product already exists, do not add it again
+    addProduct(ProductCatalog::global().intern(product), price);
+}
+
+void Business::removeProduct(ProductId product) {
+    std::size_t row = table_->find(slot_, product);
+    if (row != ProductTable::NPOS) {
+        if (aggregates_ != nullptr) {
+            std::size_t i = row - table_->offset(slot_);
+            aggregates_->removeRow(product, table_->prices(slot_)[i], table_->supply(slot_)[i],
+                                   table_->demand(slot_)[i]);
+        }
+        table_->erase(slot_, row); // Remove the product row, the rows behind it move up
     }
-    products_[product] = price;             // Add the product and its price to the business
-    initialProductPrices_[product] = price; // Set the initial product price
-    supply_[product] = 50;                  // Initialize the supply of the product to 50
-    demand_[product] = 50;                  // Initialize the demand of the product to 50
-    resupplyRates_[product] = 50;           // Initialize the resupply rate of the product to 50
 }
 
 void Business::removeProduct(const std::string& product) {
-    products_.erase(product);             // Remove the product from the business
-    initialProductPrices_.erase(product); // Remove the initial product price
-    supply_.erase(product);               // Remove the supply of the product
-    demand_.erase(product);               // Remove the demand of the product
-    resupplyRates_.erase(product);        // Remove the resupply rate of the product
+    removeProduct(ProductCatalog::global().find(product));
 }
 
 void Business::update() {
     // Update cycle for the business
+    updateProducts(updateStock());
+}
 
-    std::random_device rd;                      // Random device for generating random numbers
-    std::mt19937 gen(rd());                     // Mersenne Twister random number generator
-    std::uniform_real_distribution<> dis(0, 1); // Uniform distribution for random numbers
+double Business::updateStock() {
+    RandomStream rng = RandomService::global().stream(RandomDomain::Business, ID); // Stream of this business and tick
 
-    double roll = dis(gen);                  // Generate a random factor
-    double randomFactor = dis(gen) * 10 - 5; // Generate a random factor between -100 and 100
+    double roll = rng.uniform();                  // Generate a random factor
+    double randomFactor = rng.uniform() * 10 - 5; // Generate a random factor between -5 and 5
 
     // update the demand of the stock randomly
     if (roll > 0.2) {
@@ -147,30 +256,53 @@ void Business::update() {
     if (stockDemand_ < 0) {
         stockDemand_ = 0.0;
     }
-
-    // update the product demands
-    for (auto& product : demand_) {
-        product.second += randomFactor * product.second; // Update the product demand with the random factor
+    if (aggregates_ != nullptr) {
+        aggregates_->markStock(handle_);
     }
+    return randomFactor;
+}
 
-    // update the product prices based on demand and supply
-    for (auto it = products_.begin(); it != products_.end(); ++it) {
-        auto demandIt = demand_.find(it->first); // Find the product in the demand map
-        if (demandIt != demand_.end()) {
-            double demand = demandIt->second;        // Get the demand of the product
-            double supply = this->supply(it->first); // Get the supply of the product
-            if (supply > 0) {
-                it->second += (demand - supply) * 0.1; // Update the product price based on demand and supply
-            }
+void Business::updateProducts(double randomFactor) {
+    // Sweep the product columns of the business once: demand, then price, then resupply
+    auto prices = table_->prices(slot_);
+    auto supply = table_->supply(slot_);
+    auto demand = table_->demand(slot_);
+    auto resupplyRates = table_->resupplyRates(slot_);
+    for (std::size_t i = 0; i < prices.size(); ++i) {
+        demand[i] += randomFactor * demand[i]; // Update the product demand with the random factor
+        if (supply[i] > 0) {
+            prices[i] += (demand[i] - supply[i]) * 0.1; // Update the product price based on demand and supply
         }
+        supply[i] += static_cast<int>(resupplyRates[i] * randomFactor); // Resupply the product
+    }
+    if (aggregates_ != nullptr) {
+        aggregates_->markProducts(); // Summed again by the next refresh, cheaper than a delta per row
+    }
+}
+
+OrderBook& Business::orderBook() noexcept {
+    return orderBook_; // Return the order book of the business
+}
+
+std::int64_t Business::sharesOutstanding() const noexcept {
+    return sharesOutstanding_; // Return the number of shares held by NPCs
+}
+
+AuctionResult Business::auction() {
+    // The business buys shares back with its balance only, counting every share at its bid rounded up to the cent
+    Money buyBackPrice = Money::ceil(stockPrice_ * (1.0 - STOCK_SPREAD));
+    std::int64_t buyBack = 0;
+    if (balance_ > Money() && buyBackPrice > Money()) {
+        buyBack = balance_.cents() / buyBackPrice.cents();
     }
 
-    // resupply the products based on the resupply rates and random factor
-    for (auto it = products_.begin(); it != products_.end(); ++it) {
-        auto resupplyIt = resupplyRates_.find(it->first); // Find the product in the resupply rates map
-        if (resupplyIt != resupplyRates_.end()) {
-            double resupplyRate = resupplyIt->second;          // Get the resupply rate of the product
-            supply_[it->first] += static_cast<int>(resupplyRate * randomFactor); // Update the supply of the product
+    AuctionResult result = orderBook_.match(handle_, stockPrice_, STOCK_SPREAD, buyBack);
+    if (result.volume > 0) {
+        stockPrice_ = result.price; // The clearing price feeds back into the stock price; the NPCs settle the money
+        sharesOutstanding_ += result.issued - result.repurchased;
+        if (aggregates_ != nullptr) {
+            aggregates_->markStock(handle_);
         }
     }
-}
\ No newline at end of file
+    return result;
+}
@@ -3,66 +3,146 @@
 #ifndef BUSINESS_H
 #define BUSINESS_H
 
+#include "Handle.h"
+#include "Intent.h"
+#include "Money.h"
+#include "NameTable.h"
+#include "OrderBook.h"
+#include "ProductCatalog.h"
+#include "ProductTable.h"
+
+#include <cstdint>
+#include <span>
 #include <string>
-#include <unordered_map>
-#include <unordered_set>
+#include <string_view>
 #include <vector>
 
+class MarketAggregates;
+
+/**
+ * @class Business
+ * @brief A business selling products and stocks on the market.
+ * The product catalog of the business lives in a ProductTable; the business only keeps its slot in the table.
+ */
 class Business {
   public:
-    explicit Business(std::string name, std::string description = {});
+    static constexpr Money CAPITAL = Money::fromCents(10000 * Money::SCALE); // Default balance of a new business
+
+    explicit Business(std::string_view name, std::string_view description = {},
+                      ProductTable& table = ProductTable::market());
 
-    ~Business() = default;                              // Destructor
-    Business(const Business&) = default;                // Copy constructor
-    Business& operator=(Business&&) noexcept = default; // Move constructor
-    Business& operator=(const Business&) = default;     // Copy assignment operator
+    ~Business();                                    // Destructor
+    Business(const Business& other);                // Copy constructor
+    Business(Business&& other) noexcept;            // Move constructor
+    Business& operator=(Business&& other) noexcept; // Move assignment operator
+    Business& operator=(const Business& other);     // Copy assignment operator
 
-    int* getID() noexcept; // Get the ID of the business
+    int id() const noexcept;                // Get the ID of the business
+    BusinessHandle handle() const noexcept; // Get the handle of the business in its World
 
     double stockPrice() const noexcept;
-    std::string name() const noexcept;
-    std::string description() const noexcept;
+    double stockDemand() const noexcept { return stockDemand_; } // Demand for stocks of the business
+    std::string_view name() const noexcept;        // Valid until the business is renamed or destroyed
+    std::string_view description() const noexcept; // Valid until the description changes or the business is destroyed
     const double initialStockPrice() const noexcept; // Get the initial stock price of the business
 
-    void setDescription(const std::string& description) noexcept;
-    void setName(const std::string& name) noexcept;
+    void setDescription(const std::string& description);
+    void setName(const std::string& name);
 
-    const auto& supply() const;                             // Get supply of the business
-    int supply(const std::string& product) const;           // Get supply of a specific product
-    const auto& demand() const;                             // Get demand of the business
-    const auto& resupplyRates() const;                      // Get resupply rates of the business
-    const auto& InitialProductPrices() const;               // Get initial product prices of the business
-    const auto& products() const;                           // Get products of the business
-    void setSupply(const std::string& product, int amount); // Set supply of the business
+    std::span<const int> supply() const noexcept;                  // Get supply of the business
+    int supply(ProductId product) const;                           // Get supply of a specific product
+    int supply(const std::string& product) const;                  // Get supply of a specific product by name
+    std::span<const double> demand() const noexcept;               // Get demand of the business
+    std::span<const double> resupplyRates() const noexcept;        // Get resupply rates of the business
+    std::span<const double> InitialProductPrices() const noexcept; // Get initial product prices of the business
+    std::span<const ProductId> products() const noexcept;          // Get products of the business
+    std::span<const double> prices() const noexcept;               // Get current product prices of the business
+    void setSupply(ProductId product, int amount);                 // Set supply of the business
+    void setSupply(const std::string& product, int amount);        // Set supply of the business by product name
+
+    double price(ProductId product) const; // Get the current price of a product, 0 if it is not offered
 
     std::vector<std::string> productNames() const; // Get product names of the business
     std::vector<double> productPrices() const;     // Get product prices of the business
 
-    void addBalance(double amount); // Add balance to the business
+    Money balance() const noexcept { return balance_; } // Changed through the Ledger of the World only
+
+    /**
+     * @brief Deliver a product to a buyer; the buyer pays through the Ledger.
+     * @param product The product sold.
+     * @param amount The number of units sold.
+     * @return Filled if the supply covered the amount, otherwise why the sale was refused.
+     */
+    PurchaseResult sellProduct(ProductId product, int amount);
 
-    void addProduct(const std::string& product, double price); // Add a product to the business
-    void removeProduct(const std::string& product);            // Remove a product from the business
+    void addProduct(ProductId product, double price);          // Add a product to the business
+    void addProduct(const std::string& product, double price); // Add a product to the business, interning its name
+    void removeProduct(ProductId product);                     // Remove a product from the business
+    void removeProduct(const std::string& product);            // Remove a product from the business by name
 
     void update(); // Update cycle for the business
 
+    /**
+     * @brief First half of update(): move the stock demand and price.
+     * @return The random factor of the tick, which scales the product columns.
+     */
+    double updateStock();
+
+    /**
+     * @brief Second half of update(): scale the demand of every product, nudge prices and restock.
+     * TickScheduler runs this half for the whole market at once; see ProductTable::update().
+     * @param randomFactor The factor returned by updateStock().
+     */
+    void updateProducts(double randomFactor);
+
+    ProductTable& productTable() const noexcept { return *table_; }   // Table holding the products
+    ProductTable::Slot productSlot() const noexcept { return slot_; } // Block of the business in its table
+
+    OrderBook& orderBook() noexcept;                 // Get the order book of the business's stock
+    std::int64_t sharesOutstanding() const noexcept; // Get the number of shares held by NPCs
+
+    /**
+     * @brief Match the stock orders submitted during the tick.
+     * The business quotes STOCK_SPREAD around its stock price, issuing new shares and buying shares back with its
+     * balance. The clearing price becomes the new stock price. The business is the counterparty of every fill:
+     * buyers pay it and it pays sellers the clearing price rounded to the cent, when the NPCs settle.
+     * @return The outcome of the auction; the execution reports are available from orderBook().reports().
+     */
+    AuctionResult auction();
+
   private:
-    const double INITIAL_STOCK_PRICE = 100.0; // Initial stock price of the business
-    double stockPrice_ = INITIAL_STOCK_PRICE; // Current stock price of the business
-    std::string name_;
-    std::string description_;
-    int score_ = 0;            // Score of the business
-    double balance_ = 10000.0; // Balance of the business
-    double stockDemand_ = 1.0; // Demand for stocks of the business
+    friend class World;                       // Assigns handle_ and aggregates_
+    friend class Ledger;                      // Moves money in and out of balance_
+    friend class Snapshot;                    // Saves and restores the state of the business
+    template <class T> friend class SlotPool; // Builds restored businesses in place
 
-    int ID;
+    // Restored business: adopts the ID saved in a snapshot instead of allocating a new one
+    Business(std::string_view name, std::string_view description, ProductTable& table, int id);
 
-    static std::unordered_set<int> usedIDs_; // Set of used IDs for businesses
+    static constexpr double STOCK_SPREAD = 0.02;         // Relative distance of the quotes from the stock price
+    static constexpr double INITIAL_STOCK_PRICE = 100.0; // Initial stock price of every business
 
-    std::unordered_map<std::string, double> initialProductPrices_; // product prices of the business
-    std::unordered_map<std::string, double> products_;             // Stock prices of the business
-    std::unordered_map<std::string, int> supply_;                  // Supply of the business
-    std::unordered_map<std::string, double> demand_;               // Demand of the business
-    std::unordered_map<std::string, double> resupplyRates_;        // Stocks of the business
+    // Hot state, touched by every tick; see the memory budget below the class
+    double stockPrice_ = INITIAL_STOCK_PRICE; // Current stock price of the business
+    double stockDemand_ = 1.0;                // Demand for stocks of the business
+    Money balance_;                           // Balance of the business, funded by the World that creates it
+    std::int64_t sharesOutstanding_ = 0;      // Shares issued minus shares bought back
+    ProductTable* table_;                     // Table holding the products of the business
+    ProductTable::Slot slot_;                 // Block of the business in the product table
+    int ID;                                   // Handed out by BusinessIdAllocator, unique within the run
+    BusinessHandle handle_;                   // Set by the World that owns the business
+    MarketAggregates* aggregates_ = nullptr;  // Totals of the World that owns the business, told about every change
+    OrderBook orderBook_;                     // Stock orders waiting for the next auction
+
+    // Cold state, only read for display and snapshots
+    NameId name_ = EMPTY_NAME;        // In NameTable::global()
+    NameId description_ = EMPTY_NAME; // In NameTable::global()
+    int score_ = 0;                   // Score of the business
 };
 
+// Memory budget of a business on 64-bit targets with three-pointer vectors; its products live in the ProductTable,
+// 40 bytes per row. See "Memory" in the README before growing it
+static_assert(sizeof(void*) != 8 || sizeof(std::vector<int>) != 24 || sizeof(Business) <= 160,
+              "Business outgrew its memory budget");
+
 #endif // BUSINESS_H
\ No newline at end of file
@@ -0,0 +1,30 @@
+#include "BusinessIdAllocator.h"
+#include "Random.h"
+
+#include <stdexcept>
+
+namespace {
+
+// Residues modulo 30 of the numbers sharing no factor with 30; ID_COUNT = 2^8 * 3^2 * 5^8 has no other prime factor
+constexpr std::uint64_t COPRIME_RESIDUES[8] = {1, 7, 11, 13, 17, 19, 23, 29};
+
+} // namespace
+
+BusinessIdAllocator& BusinessIdAllocator::global() {
+    static BusinessIdAllocator allocator; // Shared by every business of the process
+    return allocator;
+}
+
+int BusinessIdAllocator::allocate() {
+    std::uint64_t n = next_.fetch_add(1, std::memory_order_relaxed);
+    if (n >= ID_COUNT) {
+        throw std::overflow_error("Every nine-digit business ID was handed out");
+    }
+
+    // n -> (a * n + b) mod ID_COUNT is a bijection when a is coprime with ID_COUNT; a and b come from the seed
+    RandomStream rng = RandomService::global().stream(RandomDomain::BusinessId, 0, 0);
+    std::uint64_t draw = rng.next() % ID_COUNT;
+    std::uint64_t a = draw - draw % 30 + COPRIME_RESIDUES[draw % 8];
+    std::uint64_t b = rng.next() % ID_COUNT;
+    return FIRST_ID + static_cast<int>((a * n + b) % ID_COUNT); // a * n < 2^60, no overflow
+}
@@ -0,0 +1,44 @@
+#pragma once
+#ifndef BUSINESS_ID_ALLOCATOR_H
+#define BUSINESS_ID_ALLOCATOR_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @class BusinessIdAllocator
+ * @brief Hands out the nine-digit IDs of businesses.
+ * The n-th ID is an affine permutation of n over the nine-digit numbers, keyed by the run seed. IDs look random,
+ * never collide, and cost an atomic increment and a multiplication: there is no set of used IDs to search and no
+ * retry loop, so businesses can be created from any thread. IDs of destroyed businesses are retired, never reused.
+ */
+class BusinessIdAllocator {
+  public:
+    static constexpr int FIRST_ID = 100000000;           // Smallest nine-digit ID
+    static constexpr std::uint64_t ID_COUNT = 900000000; // Nine-digit IDs available
+
+    /**
+     * @brief Get the allocator shared by the whole simulation.
+     */
+    static BusinessIdAllocator& global();
+
+    /**
+     * @brief Hand out the next ID. Safe to call from several threads at once.
+     * @return A nine-digit ID no other business of the run had.
+     * @throws std::overflow_error once every nine-digit ID was handed out.
+     */
+    int allocate();
+
+    std::uint64_t allocated() const noexcept { return next_; } // Number of IDs handed out so far
+
+    /**
+     * @brief Continue after the IDs handed out by a saved run, which must have used the current seed.
+     * @param allocated The number of IDs the saved run handed out.
+     */
+    void restore(std::uint64_t allocated) noexcept { next_ = allocated; }
+
+  private:
+    std::atomic<std::uint64_t> next_ = 0; // Position of the next ID in the permutation
+};
+
+#endif // BUSINESS_ID_ALLOCATOR_H
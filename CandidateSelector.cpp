@@ -0,0 +1,100 @@
+#include "CandidateSelector.h"
+#include "World.h"
+
+#include <algorithm>
+#include <cmath>
+
+void CandidateSelector::prepare(const World& world) {
+    const SlotPool<Business>& businesses = world.businesses();
+    live_.clear();
+    for (std::uint32_t i = 0; i < businesses.slots(); ++i) {
+        if (businesses.at(i) != nullptr) {
+            live_.push_back({i, 1.0});
+        }
+    }
+    bounded_ = mode_ != CandidateMode::All && count_ != 0 && count_ < live_.size();
+    tick_ = RandomService::global().tick();
+    if (!bounded_) {
+        return; // Every business, each standing for itself
+    }
+
+    double even = static_cast<double>(live_.size()) / count_; // Weight of a business picked with probability 1/n
+    if (mode_ == CandidateMode::Segment) {
+        for (Candidate& candidate : live_) {
+            candidate.weight = even; // Segments start at hashed positions, so every business is covered evenly
+        }
+        return;
+    }
+
+    std::vector<double> weights(live_.size());
+    for (std::size_t i = 0; i < live_.size(); ++i) {
+        const Business& business = *businesses.at(live_[i].business);
+        double weight = mode_ == CandidateMode::Price ? business.stockPrice() : business.stockDemand();
+        weights[i] = std::isfinite(weight) && weight > 0 ? weight : 0.0; // Exploded or worthless stocks
+    }
+    buildAliasTable(weights);
+}
+
+std::span<const Candidate> CandidateSelector::select(std::uint64_t npc, RandomStream& rng,
+                                                     std::vector<Candidate>& scratch) const {
+    if (!bounded_) {
+        return live_;
+    }
+    scratch.clear();
+    std::size_t size = live_.size();
+    if (mode_ == CandidateMode::Segment) {
+        std::size_t start = (RandomStream::mix(npc) + tick_ * count_) % size; // Moves on by a window per tick
+        for (std::size_t i = 0; i < count_; ++i) {
+            scratch.push_back(live_[(start + i) % size]);
+        }
+        return scratch;
+    }
+    for (std::size_t i = 0; i < count_; ++i) {
+        double u = rng.uniform() * size; // Whole part picks the column, the fraction decides between it and its alias
+        std::size_t column = std::min(static_cast<std::size_t>(u), size - 1);
+        scratch.push_back(live_[u - column < accept_[column] ? column : alias_[column]]);
+    }
+    return scratch;
+}
+
+void CandidateSelector::buildAliasTable(std::span<const double> weights) {
+    // Vose's alias method over the probabilities mixed with an even share
+    std::size_t size = weights.size();
+    double total = 0;
+    for (double weight : weights) {
+        total += weight;
+    }
+    double uniformShare = std::isfinite(total) && total > 0 ? UNIFORM_SHARE : 1.0; // Even draws if no weight is usable
+
+    std::vector<double> scaled(size); // Probability times size, 1 on average
+    std::vector<std::uint32_t> small;
+    std::vector<std::uint32_t> large;
+    for (std::size_t i = 0; i < size; ++i) {
+        double probability = uniformShare / size;
+        if (uniformShare < 1.0) {
+            probability += (1.0 - uniformShare) * weights[i] / total;
+        }
+        live_[i].weight = 1.0 / (count_ * probability);
+        scaled[i] = probability * size;
+        (scaled[i] < 1.0 ? small : large).push_back(static_cast<std::uint32_t>(i));
+    }
+
+    accept_.assign(size, 1.0);
+    alias_.resize(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        alias_[i] = static_cast<std::uint32_t>(i);
+    }
+    while (!small.empty() && !large.empty()) {
+        std::uint32_t less = small.back();
+        std::uint32_t more = large.back();
+        small.pop_back();
+        accept_[less] = scaled[less];
+        alias_[less] = more;
+        scaled[more] -= 1.0 - scaled[less]; // The large column gives up what fills the small one
+        if (scaled[more] < 1.0) {
+            large.pop_back();
+            small.push_back(more);
+        }
+    }
+    // Columns left on either list are full up to rounding and keep themselves
+}
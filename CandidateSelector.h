@@ -0,0 +1,88 @@
+#pragma once
+#ifndef CANDIDATE_SELECTOR_H
+#define CANDIDATE_SELECTOR_H
+
+#include "Random.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class World;
+
+/**
+ * @brief How the businesses an NPC considers during a tick are chosen.
+ */
+enum class CandidateMode {
+    All,     // Every business of the market
+    Price,   // Businesses drawn with a probability that grows with their stock price
+    Demand,  // Businesses drawn with a probability that grows with their stock demand
+    Segment, // A window of neighbouring businesses, drifting through the market every tick
+};
+
+/**
+ * @struct Candidate
+ * @brief A business an NPC considers during a tick.
+ */
+struct Candidate {
+    std::uint32_t business; // Slot of the business
+    double weight;          // Number of businesses the draw stands for, 1 / (count x selection probability)
+};
+
+/**
+ * @class CandidateSelector
+ * @brief Bounds the businesses every NPC considers per tick, making a tick O(NPCs x count) instead of
+ * O(NPCs x businesses).
+ *
+ * prepare() builds the tables of the tick once, then select() hands every NPC `count` candidates in O(count).
+ * Weighted modes draw with replacement from an alias table; a tenth of every probability is spread evenly, so each
+ * business keeps a chance to be picked. Every candidate carries the inverse of its expected number of draws, and
+ * NPCs scale their purchases by it, so the units every business sells match the unbounded market on average.
+ */
+class CandidateSelector {
+  public:
+    CandidateSelector() = default; // Every business, like the unbounded market
+
+    /**
+     * @brief Create a selector.
+     * @param mode How candidates are chosen.
+     * @param count The number of candidates per NPC and tick; 0, or a count covering the market, means all.
+     */
+    CandidateSelector(CandidateMode mode, std::size_t count) noexcept : mode_(mode), count_(count) {}
+
+    CandidateMode mode() const noexcept { return mode_; }
+    std::size_t count() const noexcept { return count_; }
+
+    /**
+     * @brief Build the tables of the tick. Call it once the businesses are updated, before any select().
+     * @param world The market the NPCs choose from.
+     */
+    void prepare(const World& world);
+
+    /**
+     * @brief Get the candidates of an NPC. Safe to call from several threads at once.
+     * @param npc The ID of the NPC, which places its segment.
+     * @param rng The random stream of the NPC, drawn from by the weighted modes.
+     * @param scratch Storage for the candidates, reused across calls.
+     * @return The candidates, valid until the next prepare() or call with the same scratch.
+     */
+    std::span<const Candidate> select(std::uint64_t npc, RandomStream& rng, std::vector<Candidate>& scratch) const;
+
+  private:
+    static constexpr double UNIFORM_SHARE = 0.1; // Share of the probability spread evenly over every business
+
+    void buildAliasTable(std::span<const double> weights);
+
+    CandidateMode mode_ = CandidateMode::All;
+    std::size_t count_ = 0;
+    bool bounded_ = false;        // Whether select() samples instead of returning every business
+    std::uint64_t tick_ = 0;      // Tick prepared, which moves the segments
+    std::vector<Candidate> live_; // Every live business in slot order, with its weight for the tick
+
+    // Alias table over live_: column i is kept with probability accept_[i], otherwise alias_[i] is taken
+    std::vector<double> accept_;
+    std::vector<std::uint32_t> alias_;
+};
+
+#endif // CANDIDATE_SELECTOR_H
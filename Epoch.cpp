@@ -0,0 +1,45 @@
+#include "Epoch.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+void EpochDomain::Guard::release() noexcept {
+    if (slot_ != nullptr) {
+        slot_->store(IDLE, std::memory_order_release);
+        slot_ = nullptr;
+    }
+}
+
+EpochDomain::Guard EpochDomain::pin() noexcept {
+    // Start at a slot of the thread's own, so concurrent readers rarely contend for the same slot
+    std::size_t start = std::hash<std::thread::id>{}(std::this_thread::get_id()) % READER_SLOTS;
+    while (true) {
+        for (std::size_t i = 0; i < READER_SLOTS; ++i) {
+            Slot& slot = slots_[(start + i) % READER_SLOTS];
+            std::uint64_t expected = IDLE;
+            // Sequentially consistent: the writer either sees this pin or the reader sees what it unlinked
+            if (slot.pinned.load(std::memory_order_relaxed) == IDLE &&
+                slot.pinned.compare_exchange_strong(expected, epoch_.load())) {
+                return Guard(&slot.pinned);
+            }
+        }
+        std::this_thread::yield(); // Every slot is pinned
+    }
+}
+
+std::uint64_t EpochDomain::retire() noexcept {
+    return epoch_.fetch_add(1);
+}
+
+bool EpochDomain::safe(std::uint64_t epoch) const noexcept {
+    for (const Slot& slot : slots_) {
+        std::uint64_t pinned = slot.pinned.load();
+        if (pinned != IDLE && pinned <= epoch) {
+            return false; // Pinned before the objects of the epoch were unlinked
+        }
+    }
+    return true;
+}
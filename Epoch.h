@@ -0,0 +1,82 @@
+#pragma once
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/**
+ * @class EpochDomain
+ * @brief Epoch-based reclamation: lets readers use shared objects without locks while a writer replaces them.
+ *
+ * A reader pins the current epoch in one of READER_SLOTS slots before it loads a shared pointer, and unpins it when
+ * it is done. The writer unlinks an object (e.g. swaps in a new version), then calls retire(), which ends the
+ * current epoch and returns the epoch the object belongs to. Once safe() holds for that epoch, no reader can still
+ * see the object and it can be freed or reused. Pinning and unpinning are one atomic exchange each; a reader only
+ * waits when every slot is pinned at once.
+ */
+class EpochDomain {
+  public:
+    static constexpr std::size_t READER_SLOTS = 64; // Readers that can be pinned at the same time
+
+    /**
+     * @class Guard
+     * @brief A pinned epoch; objects the reader loads while it lives are not reclaimed.
+     */
+    class Guard {
+      public:
+        Guard() noexcept = default;
+        Guard(Guard&& other) noexcept : slot_(std::exchange(other.slot_, nullptr)) {}
+        Guard& operator=(Guard&& other) noexcept {
+            if (this != &other) {
+                release();
+                slot_ = std::exchange(other.slot_, nullptr);
+            }
+            return *this;
+        }
+        ~Guard() { release(); }
+
+        void release() noexcept; // Unpin early
+
+      private:
+        friend class EpochDomain;
+        explicit Guard(std::atomic<std::uint64_t>* slot) noexcept : slot_(slot) {}
+
+        std::atomic<std::uint64_t>* slot_ = nullptr;
+    };
+
+    EpochDomain() = default;
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    /**
+     * @brief Pin the current epoch; load shared pointers only after this returns.
+     */
+    Guard pin() noexcept;
+
+    /**
+     * @brief End the current epoch, after unlinking objects from the readers' view.
+     * @return The epoch the objects unlinked before the call belong to.
+     */
+    std::uint64_t retire() noexcept;
+
+    /**
+     * @brief Check whether no reader can still see the objects of an epoch.
+     */
+    bool safe(std::uint64_t epoch) const noexcept;
+
+  private:
+    static constexpr std::uint64_t IDLE = 0; // Value of a slot no reader pinned
+
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> pinned{IDLE}; // Epoch pinned by the reader holding the slot
+    };
+
+    std::atomic<std::uint64_t> epoch_{1}; // Current epoch, never IDLE
+    std::array<Slot, READER_SLOTS> slots_;
+};
+
+#endif // EPOCH_H
@@ -0,0 +1,284 @@
+#include "EventLog.h"
+#include "Random.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Header at the start of every log file.
+ */
+struct FileHeader {
+    char magic[8] = {'E', 'C', 'O', 'E', 'V', 'L', 'O', 'G'};
+    std::uint32_t version = 1;
+    std::uint32_t recordSize = sizeof(EventRecord); // Lets the decoder reject files written with another layout
+};
+
+const char* reasonText(RejectReason reason) {
+    switch (reason) {
+    case RejectReason::NotEnoughBalance:
+        return "not enough balance";
+    case RejectReason::NoStocks:
+        return "owns no stocks";
+    case RejectReason::NotEnoughStocks:
+        return "does not own enough stocks";
+    case RejectReason::NotAvailable:
+        return "product not available";
+    case RejectReason::NotEnoughSupply:
+        return "not enough supply";
+    case RejectReason::ProductExists:
+        return "product already exists";
+    case RejectReason::BusinessUnderfunded:
+        return "not enough balance to create a business";
+    default:
+        return "rejected";
+    }
+}
+
+} // namespace
+
+void EventRecord::setText(std::string_view name) noexcept {
+    std::size_t length = std::min(name.size(), text.size() - 1); // Keep room for the terminator
+    std::memcpy(text.data(), name.data(), length);
+    text[length] = '\0';
+}
+
+EventLog& EventLog::global() {
+    static EventLog log; // Shared by every thread of the process
+    return log;
+}
+
+EventLog::~EventLog() {
+    close();
+}
+
+bool EventLog::open(const std::string& path, EventLevel level) {
+    close();
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false; // Cannot create the log file
+    }
+    FileHeader header;
+    std::fwrite(&header, sizeof(header), 1, file);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        file_ = file;
+        stopping_ = false;
+        namedProducts_.clear();
+    }
+    writer_ = std::thread(&EventLog::writerLoop, this);
+    setLevel(level);
+    return true;
+}
+
+void EventLog::close() {
+    setLevel(EventLevel::Off); // Stop recording before the writer goes away
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (file_ == nullptr) {
+            return; // Not open
+        }
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    writer_.join();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (drain()) {
+        // Write what was recorded while the writer was stopping
+    }
+    std::fclose(file_);
+    file_ = nullptr;
+}
+
+void EventLog::push(EventRecord record) {
+    record.tick = RandomService::global().tick();
+
+    Ring* ring = this->ring();
+    std::uint64_t head = ring->head.load(std::memory_order_relaxed);
+    while (head - ring->tail.load(std::memory_order_acquire) == RING_SIZE) {
+        wake_.notify_one(); // The ring is full, let the writer catch up
+        std::this_thread::yield();
+    }
+    ring->records[head & (RING_SIZE - 1)] = record;
+    ring->head.store(head + 1, std::memory_order_release); // Publish the record to the writer
+}
+
+EventLog::Ring* EventLog::ring() {
+    thread_local Ring* ring = nullptr; // Ring of the calling thread, registered on its first event
+    if (ring == nullptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rings_.push_back(std::make_unique<Ring>());
+        ring = rings_.back().get();
+    }
+    return ring;
+}
+
+void EventLog::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (!drain()) {
+            wake_.wait_for(lock, std::chrono::milliseconds(5)); // Nothing to write, poll again shortly
+        }
+    }
+}
+
+bool EventLog::drain() {
+    // Called with mutex_ held
+    bool wrote = false;
+    for (auto& ring : rings_) {
+        std::uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        std::uint64_t head = ring->head.load(std::memory_order_acquire);
+        while (tail != head) {
+            std::size_t begin = tail & (RING_SIZE - 1);
+            std::size_t count = std::min<std::uint64_t>(head - tail, RING_SIZE - begin); // Up to the wrap-around
+            write(ring->records.data() + begin, count);
+            tail += count;
+        }
+        if (ring->tail.load(std::memory_order_relaxed) != tail) {
+            ring->tail.store(tail, std::memory_order_release); // Hand the slots back to the producer
+            wrote = true;
+        }
+    }
+    return wrote;
+}
+
+void EventLog::write(const EventRecord* records, std::size_t count) {
+    // Name every product before its first use, so the decoder does not need the catalog of the run
+    for (std::size_t i = 0; i < count; ++i) {
+        ProductId product = records[i].product;
+        if (product == INVALID_PRODUCT) {
+            continue;
+        }
+        if (product >= namedProducts_.size()) {
+            namedProducts_.resize(product + 1, false);
+        }
+        if (!namedProducts_[product]) {
+            namedProducts_[product] = true;
+            EventRecord named;
+            named.kind = EventKind::ProductNamed;
+            named.level = EventLevel::Warning;
+            named.product = product;
+            named.tick = records[i].tick;
+            named.setText(ProductCatalog::global().name(product));
+            std::fwrite(&named, sizeof(named), 1, file_);
+        }
+    }
+    std::fwrite(records, sizeof(EventRecord), count, file_);
+}
+
+bool EventLog::decode(const std::string& path, std::ostream& out) {
+    std::ifstream in(path, std::ios::binary);
+    FileHeader header;
+    FileHeader expected;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version ||
+        header.recordSize != expected.recordSize) {
+        return false; // Not an event log, or written by an incompatible version
+    }
+
+    std::vector<EventRecord> records;
+    EventRecord record;
+    while (in.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+        records.push_back(record);
+    }
+
+    // First pass: collect the names, which may be drained after the events that use them
+    std::unordered_map<std::uint32_t, std::string> businesses;
+    std::unordered_map<std::uint64_t, std::string> npcs;
+    std::unordered_map<ProductId, std::string> products;
+    for (const auto& event : records) {
+        switch (event.kind) {
+        case EventKind::BusinessOpened:
+            businesses[event.business] = event.text.data();
+            break;
+        case EventKind::NpcCreated:
+            npcs[event.actor] = event.text.data();
+            break;
+        case EventKind::ProductNamed:
+            products[event.product] = event.text.data();
+            break;
+        default:
+            break;
+        }
+    }
+    auto business = [&](std::uint32_t id) {
+        auto it = businesses.find(id);
+        return it != businesses.end() ? it->second : (id == 0 ? "a closed business" : "Business#" + std::to_string(id));
+    };
+    auto npc = [&](std::uint64_t id) {
+        auto it = npcs.find(id);
+        return it != npcs.end() ? it->second : "Npc#" + std::to_string(id);
+    };
+    auto product = [&](ProductId id) {
+        auto it = products.find(id);
+        return it != products.end() ? it->second : "Product#" + std::to_string(id);
+    };
+
+    // Second pass: print in tick order; within a tick, records of one thread keep their order
+    std::stable_sort(records.begin(), records.end(),
+                     [](const EventRecord& a, const EventRecord& b) { return a.tick < b.tick; });
+    for (const auto& event : records) {
+        out << "[" << event.tick << "] ";
+        switch (event.kind) {
+        case EventKind::BusinessOpened:
+            out << "Business " << event.text.data() << " opened";
+            break;
+        case EventKind::BusinessClosed:
+            out << "Business " << business(event.business) << " closed";
+            break;
+        case EventKind::NpcCreated:
+            out << "Npc " << event.text.data() << " created";
+            break;
+        case EventKind::ProductNamed:
+            out << "Product " << event.text.data() << " listed";
+            break;
+        case EventKind::StockBought:
+            out << npc(event.actor) << " bought " << event.amount << " stocks of " << business(event.business)
+                << " at " << event.price;
+            break;
+        case EventKind::StockSold:
+            out << npc(event.actor) << " sold " << event.amount << " stocks of " << business(event.business)
+                << " at " << event.price;
+            break;
+        case EventKind::StockPriceDecreased:
+            out << "Stock price of " << business(event.business) << " has decreased to " << event.price;
+            break;
+        case EventKind::PositionClosed:
+            out << npc(event.actor) << " has no more stocks of " << business(event.business) << " left";
+            break;
+        case EventKind::PositionWrittenOff:
+            out << npc(event.actor) << " wrote off " << event.amount << " stocks of " << business(event.business);
+            break;
+        case EventKind::ProductBought:
+            out << npc(event.actor) << " bought " << event.amount << " of " << product(event.product) << " from "
+                << business(event.business) << " for " << event.price;
+            break;
+        case EventKind::Rejected:
+            out << (event.actor != 0 || event.reason != RejectReason::ProductExists ? npc(event.actor) + ": " : "")
+                << reasonText(event.reason);
+            if (event.product != INVALID_PRODUCT) {
+                out << ", " << event.amount << " of " << product(event.product);
+            } else if (event.amount != 0) {
+                out << ", " << event.amount << " stocks";
+            }
+            if (event.business != 0) {
+                out << " at " << business(event.business);
+            }
+            break;
+        default:
+            out << "unknown event " << static_cast<int>(event.kind);
+            break;
+        }
+        out << "\n";
+    }
+    return true;
+}
@@ -0,0 +1,173 @@
+#pragma once
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include "ProductCatalog.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Verbosity levels of the event log; an event is recorded if its level is at most the level of the log.
+ */
+enum class EventLevel : std::uint8_t {
+    Off = 0,     // Nothing is recorded
+    Warning = 1, // Entities opening and closing, written-off positions
+    Info = 2,    // Trades and purchases
+    Debug = 3,   // Rejected orders and purchases, price warnings
+};
+
+/**
+ * @brief Kinds of records in the event log.
+ */
+enum class EventKind : std::uint8_t {
+    BusinessOpened = 0,      // text: business name
+    BusinessClosed = 1,      //
+    NpcCreated = 2,          // text: NPC name
+    ProductNamed = 3,        // text: product name, written by the writer thread before the first use of a product
+    StockBought = 4,         // amount shares at price
+    StockSold = 5,           // amount shares at price
+    StockPriceDecreased = 6, // price: current stock price
+    PositionClosed = 7,      // The NPC sold its last share of the business
+    PositionWrittenOff = 8,  // The business of the position was closed
+    ProductBought = 9,       // amount units of product for price in total
+    Rejected = 10,           // reason: why the order, purchase or product was rejected
+};
+
+/**
+ * @brief Reasons attached to EventKind::Rejected records.
+ */
+enum class RejectReason : std::uint8_t {
+    None = 0,
+    NotEnoughBalance = 1,    // The NPC cannot afford the order or purchase
+    NoStocks = 2,            // The NPC does not own stocks of the business
+    NotEnoughStocks = 3,     // The NPC owns fewer stocks than it tried to sell
+    NotAvailable = 4,        // The business does not sell the product
+    NotEnoughSupply = 5,     // The business does not have enough units in stock
+    ProductExists = 6,       // The business already sells the product
+    BusinessUnderfunded = 7, // The NPC founded a business without the recommended balance
+};
+
+/**
+ * @struct EventRecord
+ * @brief Fixed-size binary record of the event log, written to the file as is.
+ */
+struct EventRecord {
+    EventKind kind = EventKind::Rejected;
+    RejectReason reason = RejectReason::None;
+    EventLevel level = EventLevel::Off;   // Set by EventLog::emit
+    std::uint8_t reserved = 0;            // Padding, always 0
+    std::uint32_t business = 0;           // ID of the business, 0 if none
+    std::uint64_t actor = 0;              // Creation number of the NPC, unused by business events
+    ProductId product = INVALID_PRODUCT;  // Product, INVALID_PRODUCT if none
+    std::int32_t amount = 0;              // Shares or units
+    double price = 0;                     // Price per share, or total cost of a purchase
+    std::uint64_t tick = 0;               // Set by EventLog::emit
+    std::array<char, 24> text = {};       // NUL-terminated name, truncated to fit
+
+    /**
+     * @brief Copy a name into the text field, truncating it if needed.
+     */
+    void setText(std::string_view name) noexcept;
+};
+
+static_assert(sizeof(EventRecord) == 64, "EventRecord is written to the log file as is");
+
+/**
+ * @class EventLog
+ * @brief Asynchronous binary log of trading events.
+ * Every producing thread appends fixed-size records to its own single-producer ring buffer, without locks or
+ * formatting. A background thread drains the rings to the log file. Checking a disabled level is one relaxed atomic
+ * load, so call sites cost close to nothing when the log is off. Use decode() to turn a log file back into text.
+ */
+class EventLog {
+  public:
+    /**
+     * @brief Get the log shared by the whole simulation.
+     */
+    static EventLog& global();
+
+    ~EventLog();
+
+    /**
+     * @brief Start writing records to a file, replacing it; a log that is already open is closed first.
+     * @param path The path of the log file.
+     * @param level The highest level to record.
+     * @return false if the file cannot be opened.
+     */
+    bool open(const std::string& path, EventLevel level);
+
+    /**
+     * @brief Write every pending record and close the file. Nothing is recorded until the log is opened again.
+     */
+    void close();
+
+    void setLevel(EventLevel level) noexcept { level_.store(level, std::memory_order_relaxed); } // Change verbosity
+    EventLevel level() const noexcept { return level_.load(std::memory_order_relaxed); }        // Get verbosity
+
+    /**
+     * @brief Check whether events of a level are recorded.
+     */
+    static bool enabled(EventLevel level) noexcept {
+        return level <= level_.load(std::memory_order_relaxed) && level != EventLevel::Off;
+    }
+
+    /**
+     * @brief Record an event if its level is enabled; the tick is taken from the RandomService.
+     */
+    static void emit(EventLevel level, EventRecord record) {
+        if (enabled(level)) {
+            record.level = level;
+            global().push(record);
+        }
+    }
+
+    /**
+     * @brief Convert a binary log file to text, one event per line ordered by tick.
+     * @param path The path of the log file.
+     * @param out The stream to write the text to.
+     * @return false if the file cannot be read or is not an event log.
+     */
+    static bool decode(const std::string& path, std::ostream& out);
+
+  private:
+    static constexpr std::size_t RING_SIZE = 4096; // Records per producer thread, a power of two
+
+    struct Ring {
+        std::array<EventRecord, RING_SIZE> records;
+        alignas(64) std::atomic<std::uint64_t> head = 0; // Next record to write, owned by the producer
+        alignas(64) std::atomic<std::uint64_t> tail = 0; // Next record to drain, owned by the writer thread
+    };
+
+    EventLog() = default;
+
+    void push(EventRecord record); // Append to the calling thread's ring
+    Ring* ring();                  // Get or register the calling thread's ring
+    void writerLoop();             // Body of the writer thread
+    bool drain();                  // Write every available record of every ring, returns false if none was
+    void write(const EventRecord* records, std::size_t count);
+
+    static inline std::atomic<EventLevel> level_ = EventLevel::Off; // Static so enabled() is a single load
+
+    std::mutex mutex_;                        // Guards rings_, file_ and stopping_
+    std::vector<std::unique_ptr<Ring>> rings_; // One per thread that ever recorded an event
+    std::condition_variable wake_;             // Signals the writer that a ring fills up or the log closes
+    std::thread writer_;
+    bool stopping_ = false;
+
+    std::FILE* file_ = nullptr;
+    std::vector<bool> namedProducts_; // Products whose ProductNamed record was written to the current file
+};
+
+#endif // EVENT_LOG_H
@@ -0,0 +1,39 @@
+#pragma once
+#ifndef HANDLE_H
+#define HANDLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/**
+ * @struct Handle
+ * @brief Stable reference to an object stored in a SlotPool.
+ * The index names the slot and the generation tells apart the successive objects living in that slot, so a handle
+ * to a destroyed object is detected as stale instead of reaching whatever reuses the slot.
+ */
+template <class T> struct Handle {
+    static constexpr std::uint32_t NO_INDEX = static_cast<std::uint32_t>(-1);
+
+    std::uint32_t index = NO_INDEX; // Slot of the object
+    std::uint32_t generation = 0;   // Generation of the slot when the object was created
+
+    bool isNull() const noexcept { return index == NO_INDEX; } // True for a default-constructed handle
+
+    std::uint64_t bits() const noexcept { return (static_cast<std::uint64_t>(generation) << 32) | index; }
+
+    friend bool operator==(Handle a, Handle b) noexcept { return a.index == b.index && a.generation == b.generation; }
+    friend bool operator!=(Handle a, Handle b) noexcept { return !(a == b); }
+};
+
+template <class T> struct std::hash<Handle<T>> {
+    std::size_t operator()(Handle<T> handle) const noexcept { return std::hash<std::uint64_t>{}(handle.bits()); }
+};
+
+class Business;
+class Npc;
+
+using BusinessHandle = Handle<Business>; // Handle to a business of the World
+using NpcHandle = Handle<Npc>;           // Handle to an NPC of the World
+
+#endif // HANDLE_H
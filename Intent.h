@@ -0,0 +1,76 @@
+#pragma once
+#ifndef INTENT_H
+#define INTENT_H
+
+#include "Handle.h"
+#include "Ledger.h"
+#include "Money.h"
+#include "ProductCatalog.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Outcome of a product purchase once the business has processed it.
+ */
+enum class PurchaseResult : std::uint8_t {
+    Pending,         // Not committed yet
+    Filled,          // The business delivered the product
+    NotAvailable,    // The business has no supply of the product
+    NotEnoughSupply, // The business has less supply than requested
+};
+
+/**
+ * @struct PurchaseIntent
+ * @brief A product purchase decided by an NPC and committed later by the business.
+ * The NPC reserves the cost from its balance when it decides and pays it when it settles a filled purchase.
+ */
+struct PurchaseIntent {
+    std::uint32_t business;                          // Slot of the business in the World
+    ProductId product;                               // Product to buy
+    int amount;                                      // Units to buy
+    Money cost;                                      // Money reserved from the NPC's balance
+    PurchaseResult result = PurchaseResult::Pending; // Set when the business commits the purchase
+};
+
+/**
+ * @brief Side of a stock order.
+ */
+enum class OrderSide : std::uint8_t {
+    Bid, // Buy shares
+    Ask, // Sell shares
+};
+
+/**
+ * @struct StockOrder
+ * @brief A limit order decided by an NPC and submitted to the order book of the business afterwards.
+ * Bids reserve quantity * limit, rounded up to the cent, from the NPC's balance and asks reserve the shares from its
+ * portfolio.
+ */
+struct StockOrder {
+    BusinessHandle business; // Business whose shares are traded
+    OrderSide side;          // Buy or sell
+    int quantity;            // Shares to trade
+    double limit;            // Highest price paid for a bid, lowest price accepted for an ask
+};
+
+/**
+ * @struct IntentBuffer
+ * @brief Storage the NPCs deciding on one thread record their purchases, stock orders and transfers in.
+ * NPCs keep nothing of a tick themselves: the caller lends them a buffer, and clears and reuses it every tick, so
+ * its capacity follows the busiest tick of the thread rather than growing with every NPC. The records of one
+ * decision are contiguous as long as the NPCs sharing a buffer decide one after the other.
+ */
+struct IntentBuffer {
+    std::vector<PurchaseIntent> purchases; // Product purchases waiting to be committed and settled
+    std::vector<StockOrder> orders;        // Stock orders waiting to be submitted
+    std::vector<JournalEntry> journal;     // Transfers waiting for the ledger
+
+    void clear() noexcept {
+        purchases.clear();
+        orders.clear();
+        journal.clear();
+    }
+};
+
+#endif // INTENT_H
@@ -0,0 +1,143 @@
+#include "Ledger.h"
+#include "Metrics.h"
+#include "World.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+void Ledger::transfer(const JournalEntry& entry) {
+    Money* from = find(entry.from);
+    Money* to = find(entry.to);
+    *(from != nullptr ? from : &system_) -= entry.amount;
+    *(to != nullptr ? to : &system_) += entry.amount;
+    Metrics::count(Counter::Transfers);
+}
+
+void Ledger::transfer(std::span<const JournalEntry> entries) {
+    for (const JournalEntry& entry : entries) {
+        transfer(entry);
+    }
+}
+
+void Ledger::post(std::span<const JournalEntry> entries) {
+    batch_.insert(batch_.end(), entries.begin(), entries.end());
+}
+
+std::size_t Ledger::apply() {
+    // Counting sort of both legs of every entry by account, then one read and one write per account
+    const std::size_t accounts = 1 + 2 * std::size_t{world_->npcs().slots()} + world_->businesses().slots();
+    start_.assign(accounts + 1, 0);
+    for (const JournalEntry& entry : batch_) {
+        ++start_[index(entry.from) + 1];
+        ++start_[index(entry.to) + 1];
+    }
+    for (std::size_t a = 0; a < accounts; ++a) {
+        start_[a + 1] += start_[a]; // Prefix sum: counts become start offsets
+    }
+
+    postings_.resize(2 * batch_.size());
+    cursor_.assign(start_.begin(), start_.end() - 1);
+    for (const JournalEntry& entry : batch_) {
+        std::size_t from = index(entry.from);
+        std::size_t to = index(entry.to);
+        postings_[cursor_[from]++] = -entry.amount;
+        postings_[cursor_[to]++] = entry.amount;
+    }
+
+    for (std::size_t a = 0; a < accounts; ++a) {
+        if (start_[a] == start_[a + 1]) {
+            continue; // No posting for this account
+        }
+        Money sum;
+        for (std::size_t p = start_[a]; p < start_[a + 1]; ++p) {
+            sum += postings_[p];
+        }
+        *atIndex(a) += sum;
+    }
+
+    std::size_t applied = batch_.size();
+    batch_.clear();
+    Metrics::count(Counter::Transfers, applied);
+    return applied;
+}
+
+LedgerAudit Ledger::audit() const {
+    LedgerAudit audit;
+    const SlotPool<Npc>& npcs = world_->npcs();
+    for (std::uint32_t n = 0; n < npcs.slots(); ++n) {
+        if (const Npc* npc = npcs.at(n)) {
+            audit.supply += npc->balance_ + npc->savingsAccount_;
+            audit.overdrawn += (npc->balance_ < Money()) + (npc->savingsAccount_ < Money());
+        }
+    }
+    const SlotPool<Business>& businesses = world_->businesses();
+    for (std::uint32_t b = 0; b < businesses.slots(); ++b) {
+        if (const Business* business = businesses.at(b)) {
+            audit.supply += business->balance_;
+            audit.overdrawn += business->balance_ < Money();
+        }
+    }
+    audit.total = audit.supply + system_;
+    return audit;
+}
+
+void Ledger::rebuild() {
+    system_ = Money();
+    system_ = -audit().supply;
+}
+
+Money* Ledger::find(Account account) noexcept {
+    switch (account.kind) {
+    case AccountKind::Npc:
+    case AccountKind::Savings: {
+        SlotPool<Npc>& npcs = world_->npcs();
+        Npc* npc = account.slot < npcs.slots() ? npcs.at(account.slot) : nullptr;
+        if (npc == nullptr) {
+            return nullptr; // Destroyed NPC
+        }
+        return account.kind == AccountKind::Npc ? &npc->balance_ : &npc->savingsAccount_;
+    }
+    case AccountKind::Business: {
+        SlotPool<Business>& businesses = world_->businesses();
+        Business* business = account.slot < businesses.slots() ? businesses.at(account.slot) : nullptr;
+        return business != nullptr ? &business->balance_ : nullptr;
+    }
+    default:
+        return &system_;
+    }
+}
+
+std::size_t Ledger::index(Account account) const noexcept {
+    const SlotPool<Npc>& npcs = world_->npcs();
+    const SlotPool<Business>& businesses = world_->businesses();
+    switch (account.kind) {
+    case AccountKind::Npc:
+        return account.slot < npcs.slots() && npcs.at(account.slot) != nullptr ? 1 + account.slot : 0;
+    case AccountKind::Savings:
+        return account.slot < npcs.slots() && npcs.at(account.slot) != nullptr
+                   ? 1 + std::size_t{npcs.slots()} + account.slot
+                   : 0;
+    case AccountKind::Business:
+        return account.slot < businesses.slots() && businesses.at(account.slot) != nullptr
+                   ? 1 + 2 * std::size_t{npcs.slots()} + account.slot
+                   : 0;
+    default:
+        return 0; // The system account, also standing in for accounts whose owner is gone
+    }
+}
+
+Money* Ledger::atIndex(std::size_t index) noexcept {
+    const std::size_t npcSlots = world_->npcs().slots();
+    if (index == 0) {
+        return &system_;
+    }
+    if (index <= npcSlots) {
+        return find(Account::npc(static_cast<std::uint32_t>(index - 1)));
+    }
+    if (index <= 2 * npcSlots) {
+        return find(Account::savings(static_cast<std::uint32_t>(index - 1 - npcSlots)));
+    }
+    return find(Account::business(static_cast<std::uint32_t>(index - 1 - 2 * npcSlots)));
+}
@@ -0,0 +1,138 @@
+#pragma once
+#ifndef LEDGER_H
+#define LEDGER_H
+
+#include "Money.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class World;
+
+/**
+ * @brief Kind of a ledger account; every NPC and business slot of a World has its own accounts.
+ */
+enum class AccountKind : std::uint8_t {
+    System,   // Source of new money and sink of liquidated money; its balance is minus the money supply
+    Npc,      // Balance of an NPC
+    Savings,  // Savings account of an NPC
+    Business, // Balance of a business
+};
+
+/**
+ * @struct Account
+ * @brief An account of a ledger: its kind and the slot of its owner in the World.
+ */
+struct Account {
+    AccountKind kind = AccountKind::System;
+    std::uint32_t slot = 0; // Slot of the NPC or business, 0 for the system account
+
+    static constexpr Account system() noexcept { return {AccountKind::System, 0}; }
+    static constexpr Account npc(std::uint32_t slot) noexcept { return {AccountKind::Npc, slot}; }
+    static constexpr Account savings(std::uint32_t slot) noexcept { return {AccountKind::Savings, slot}; }
+    static constexpr Account business(std::uint32_t slot) noexcept { return {AccountKind::Business, slot}; }
+};
+
+/**
+ * @brief Why money moved.
+ */
+enum class TransferKind : std::uint8_t {
+    Endowment,   // Starting balance of a new NPC
+    Capital,     // Starting balance of a new business
+    Purchase,    // Product bought by an NPC
+    StockTrade,  // Shares bought from or sold to the business, which is the counterparty of its own auction
+    Interest,    // Savings interest
+    Liquidation, // Balance of a closed business or a destroyed NPC
+};
+
+/**
+ * @struct JournalEntry
+ * @brief A transfer of money between two accounts.
+ */
+struct JournalEntry {
+    Account from;
+    Account to;
+    Money amount;
+    TransferKind kind;
+};
+
+/**
+ * @struct LedgerAudit
+ * @brief Result of an audit: money is conserved when the accounts, the system account included, sum to zero.
+ */
+struct LedgerAudit {
+    Money total;               // Sum of every account, 0 unless money appeared or vanished
+    Money supply;              // Money held by NPCs and businesses
+    std::size_t overdrawn = 0; // NPC and business accounts below zero
+
+    bool balanced() const noexcept { return total == Money() && overdrawn == 0; }
+};
+
+/**
+ * @class Ledger
+ * @brief Double-entry ledger of the money of a World: every balance changes through a journal entry.
+ *
+ * During a tick, entries are posted to a batch and applied at once by apply(): the postings of the batch are
+ * counting-sorted by account, so every account is read and written once, in slot order. Outside of ticks,
+ * transfer() applies entries right away. A debit the account does not cover is applied anyway and shows up in the
+ * next audit; entries for an account whose owner no longer exists go to the system account instead, so money is
+ * never lost.
+ *
+ * The ledger is owned by its World and must only be used by one thread at a time.
+ */
+class Ledger {
+  public:
+    explicit Ledger(World& world) noexcept : world_(&world) {}
+    Ledger(const Ledger&) = delete;
+    Ledger& operator=(const Ledger&) = delete;
+
+    /**
+     * @brief Apply entries right away, in order.
+     */
+    void transfer(const JournalEntry& entry);
+    void transfer(std::span<const JournalEntry> entries);
+
+    /**
+     * @brief Add entries to the batch of the next apply().
+     */
+    void post(std::span<const JournalEntry> entries);
+    std::size_t pending() const noexcept { return batch_.size(); } // Entries waiting for apply()
+
+    /**
+     * @brief Apply the batch, account by account.
+     * @return The number of entries applied.
+     */
+    std::size_t apply();
+
+    /**
+     * @brief Sum every account of the World, checking that money is conserved.
+     */
+    LedgerAudit audit() const;
+
+    /**
+     * @brief Get the money held by NPCs and businesses: what the system account issued minus what it took back.
+     */
+    Money supply() const noexcept { return -system_; }
+
+    /**
+     * @brief Set the system account so that the current balances of the World are conserved.
+     * Used after balances were restored directly, e.g. from a snapshot.
+     */
+    void rebuild();
+
+  private:
+    Money* find(Account account) noexcept;             // nullptr if the owner of the account does not exist
+    std::size_t index(Account account) const noexcept; // Dense index: system, NPCs, savings, then businesses
+    Money* atIndex(std::size_t index) noexcept;        // Account of a dense index
+
+    World* world_;
+    Money system_;                    // Minus the money supply
+    std::vector<JournalEntry> batch_; // Entries posted since the last apply()
+    std::vector<Money> postings_;     // Both legs of every entry of the batch, grouped by account
+    std::vector<std::size_t> start_;  // First posting of every account in postings_
+    std::vector<std::size_t> cursor_; // Write cursors of the grouping pass
+};
+
+#endif // LEDGER_H
@@ -1,42 +1,215 @@
-#include "Business.h"
-#include "Npc.h"
+#include "EventLog.h"
+#include "Metrics.h"
+#include "Random.h"
+#include "ShardedSimulation.h"
+#include "Simulation.h"
+#include "TimeSeries.h"
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <iostream>
+#include <mutex>
 #include <random>
 #include <string>
+#include <thread>
 #include <vector>
 
-int main() {
-    std::random_device rd;                       // Random device for generating random numbers
-    std::mt19937 gen(rd());                      // Mersenne Twister random number generator
-    std::uniform_int_distribution<> dis(10, 60); // Uniform distribution for random numbers
+namespace {
 
-    int length = dis(gen); // Generate a random length for the string
+void printUsage() {
+    std::cout << "Usage: SimulatedEconomy [options]\n"
+                 "  --businesses N    initial businesses (default 100)\n"
+                 "  --npcs N          initial NPCs (default 1000)\n"
+                 "  --products N      products per initial business (default 8)\n"
+                 "  --warmup N        ticks run before measuring (default 10)\n"
+                 "  --ticks N         measured steady-state ticks (default 100)\n"
+                 "  --seed N          run seed (default: random)\n"
+                 "  --threads N       threads running ticks, 0 for all (default 0; per shard with --shards)\n"
+                 "  --shards N        split the NPCs over N worker processes, 0 runs in this process (default 0);\n"
+                 "                    not with --restore, --checkpoint, --series, --log-level, --publish-every or\n"
+                 "                    --watch\n"
+                 "  --mode fixed|ramp fixed population, or one business and NPC added per tick (default fixed)\n"
+                 "  --candidates N    businesses every NPC considers per tick, 0 for all (default 0)\n"
+                 "  --selection S     price, demand or segment: how candidates are chosen (default price)\n"
+                 "  --scheduling S    ticks: update everything every tick; events: only entities that are due\n"
+                 "                    (default ticks)\n"
+                 "  --strategies L    NPC strategies as name:weight pairs, e.g. speculator:3,investor:1,consumer:1;\n"
+                 "                    speculator, investor or consumer (default speculator)\n"
+                 "  --log FILE        event log file (default events.bin)\n"
+                 "  --log-level L     off, warning, info or debug (default off)\n"
+                 "  --checkpoint FILE write a snapshot of the world to FILE\n"
+                 "  --checkpoint-every N  ticks between snapshots, 0 for one at the end (default 0)\n"
+                 "  --series FILE     record the market state of every tick to FILE\n"
+                 "  --metrics FILE    write tick phase times and event counters to FILE, as JSON if it ends in .json,\n"
+                 "                    else in the Prometheus text format\n"
+                 "  --metrics-every N ticks between metrics files, 0 for one at the end (default 0)\n"
+                 "  --publish-every N publish a view of the market for concurrent queries every N ticks, 0 for none\n"
+                 "                    (default 0)\n"
+                 "  --watch SECONDS   print the top businesses and richest NPC every SECONDS while running, from a\n"
+                 "                    query thread (default 0: off)\n"
+                 "  --restore FILE    resume from a snapshot instead of creating a population\n"
+                 "  --scenario FILE   create the population from a scenario file instead of --businesses, --npcs and\n"
+                 "                    --products\n"
+                 "  --config FILE     read name=value options from a file\n"
+                 "  --decode FILE     print a recorded event log as text and exit\n"
+                 "  --decode-series FILE  print a recorded time series as CSV and exit\n";
+}
+
+// Print the latest published view, as any client of the query service would read it
+void printView(const WorldView& view) {
+    std::cout << "[tick " << view.tick() << "] " << view.businesses().size() << " businesses, " << view.npcs().size()
+              << " NPCs; top stocks:";
+    for (const BusinessSummary& business : view.topBusinesses(3)) {
+        std::cout << " " << business.id << " @ " << business.stockPrice;
+    }
+    std::vector<NpcSummary> richest = view.richestNpcs(1);
+    if (!richest.empty()) {
+        std::cout << "; richest NPC " << richest[0].id << " with " << richest[0].balance.toDouble();
+    }
+    std::cout << std::endl;
+}
+
+void printScenarioError(const Scenario& scenario, const std::string& path) {
+    std::cerr << "Cannot load the scenario " << path;
+    if (scenario.errorLine() != 0) {
+        std::cerr << ": invalid line " << scenario.errorLine();
+    }
+    std::cerr << "." << std::endl;
+}
 
-    std::vector<Business*> businesses; // Vector to store pointers to Business objects
-    std::vector<Npc*> npcs;            // Vector to store pointers to Npc objects
+void printSummary(const SimulationSummary& summary, const SimulationConfig& config) {
+    if (summary.setupSeconds > 0) {
+        std::cout << "Setup: " << summary.setupSeconds << " s" << std::endl;
+    }
+    std::cout << "Ticks: " << summary.ticks << " in " << summary.seconds << " s (after " << config.warmupTicks
+              << " warm-up ticks)\n"
+              << "Population: " << summary.businesses << " businesses, " << summary.npcs << " NPCs\n"
+              << "Ticks/sec: " << summary.ticksPerSecond() << "\n"
+              << "Entity updates/sec: " << summary.entityUpdatesPerSecond() << "\n"
+              << "Trades/sec: " << summary.tradesPerSecond() << " (" << summary.sharesTraded << " shares traded)\n"
+              << "Market cap: " << summary.marketCap << ", mean stock price " << summary.meanStockPrice
+              << ", top business " << summary.topBusiness << "\n"
+              << "Money supply: " << summary.moneySupply << " (" << summary.unbalancedTicks
+              << " ticks failed the ledger audit)" << std::endl;
+}
+
+// Run the world over worker processes; forked before this process starts any thread
+int runSharded(const SimulationConfig& config) {
+    if (const char* option = ShardedSimulation::unsupportedOption(config)) {
+        std::cerr << "--" << option << " cannot be used with --shards." << std::endl;
+        return 1;
+    }
+    Scenario scenario; // Every worker loads it again; check it once here
+    if (!config.scenarioPath.empty() && !scenario.load(config.scenarioPath)) {
+        printScenarioError(scenario, config.scenarioPath);
+        return 1;
+    }
+    std::cout << "Seed: " << RandomService::global().seed() << "\n"
+              << "Shards: " << config.shards << std::endl;
+
+    SimulationSummary summary;
+    if (!ShardedSimulation(config).run(summary)) {
+        std::cerr << "The sharded run failed: a worker failed, or this platform cannot fork workers." << std::endl;
+        return 1;
+    }
+    printSummary(summary, config);
+    return 0;
+}
 
-    for (int i = 0; i < length; ++i) {
-        // TODO: add core loop logic here
-        Business* business = new Business("Business" + std::to_string(i));
-        businesses.push_back(business); // Add the business to the vector
-        Npc* npc = new Npc("Npc" + std::to_string(i));
-        npcs.push_back(npc); // Add the npc to the vector
+} // namespace
 
-        for (auto& business : businesses) {
-            business->update(); // Update the business
+int main(int argc, char* argv[]) {
+    SimulationConfig config;
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option == "--help" || option == "-h") {
+            printUsage();
+            return 0;
         }
+        if (option.rfind("--", 0) != 0 || i + 1 == argc) {
+            std::cerr << "Invalid argument " << option << ", see --help." << std::endl;
+            return 1;
+        }
+        std::string name = option.substr(2);
+        std::string value = argv[++i];
+        if (name == "decode") {
+            return EventLog::decode(value, std::cout) ? 0 : 1;
+        }
+        if (name == "decode-series") {
+            return TimeSeriesRecorder::decode(value, std::cout) ? 0 : 1;
+        }
+        if (name == "config" ? !config.load(value) : !config.set(name, value)) {
+            std::cerr << "Invalid option " << option << " " << value << ", see --help." << std::endl;
+            return 1;
+        }
+    }
+
+    if (config.watchSeconds > 0 && config.publishEvery == 0) {
+        config.publishEvery = 1; // Watching needs published views
+    }
 
-        for (auto& npc : npcs) {
-            npc->update(businesses); // Update the NPC with the list of businesses
+    // The run seed comes from the options, or from the random device when none is given
+    std::uint64_t seed = config.hasSeed ? config.seed : std::random_device{}();
+    RandomService::global().seed(seed);
+    if (config.shards != 0) {
+        return runSharded(config);
+    }
+
+    Simulation simulation(config);
+    if (!config.restorePath.empty()) {
+        if (!simulation.restore(config.restorePath)) {
+            std::cerr << "Cannot restore the snapshot " << config.restorePath << "." << std::endl;
+            return 1;
         }
+        std::cout << "Restored " << config.restorePath << " at tick " << simulation.nextTick() << std::endl;
+    } else if (!config.scenarioPath.empty() && !simulation.loadScenario(config.scenarioPath)) {
+        printScenarioError(simulation.scenario(), config.scenarioPath);
+        return 1;
+    }
+    std::cout << "Seed: " << RandomService::global().seed() << std::endl; // Print the seed so the run can be reproduced
+
+    if (config.logLevel != EventLevel::Off && !EventLog::global().open(config.logPath, config.logLevel)) {
+        std::cerr << "Cannot open " << config.logPath << ", events are not recorded." << std::endl;
     }
 
-    for (auto& business : businesses) {
-        delete business; // Delete the business object
+    // Watch the market from another thread while the simulation runs
+    std::mutex watchMutex;
+    std::condition_variable watchDone;
+    bool finished = false;
+    std::thread watcher;
+    if (config.watchSeconds > 0) {
+        watcher = std::thread([&] {
+            std::uint64_t printed = UINT64_MAX;
+            std::unique_lock<std::mutex> lock(watchMutex);
+            std::chrono::duration<double> period(config.watchSeconds);
+            while (!watchDone.wait_for(lock, period, [&] { return finished; })) {
+                QueryService::View view = simulation.queries().read();
+                if (view && view->tick() != printed) {
+                    printed = view->tick();
+                    printView(*view);
+                }
+            }
+        });
     }
-    for (auto& npc : npcs) {
-        delete npc; // Delete the npc object
+
+    SimulationSummary summary = simulation.run();
+    if (watcher.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(watchMutex);
+            finished = true;
+        }
+        watchDone.notify_one();
+        watcher.join();
+    }
+    EventLog::global().close(); // Write the events that are still buffered
+
+    printSummary(summary, config);
+    if (Metrics::COMPILED) {
+        MetricsSnapshot metrics = Metrics::global().snapshot();
+        const LatencyHistogram& ticks = metrics.phase(Phase::Tick);
+        std::cout << "Tick latency: p50 " << ticks.percentile(50) * 1e-6 << " ms, p99 " << ticks.percentile(99) * 1e-6
+                  << " ms, max " << ticks.max() * 1e-6 << " ms" << std::endl;
     }
     return 0; // Return success
 }
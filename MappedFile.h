@@ -0,0 +1,44 @@
+#pragma once
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @class MappedFile
+ * @brief Read-only memory mapping of a whole file.
+ * The pages are loaded by the OS on first access, so opening a large file costs no reads up front.
+ */
+class MappedFile {
+  public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Map a file, unmapping the previous one.
+     * @param path The path of the file.
+     * @return false if the file cannot be opened or mapped.
+     */
+    bool open(const std::string& path);
+
+    void close(); // Unmap the file
+
+    const std::byte* data() const noexcept { return data_; } // Start of the mapping, page aligned
+    std::size_t size() const noexcept { return size_; }      // Size of the file in bytes
+
+  private:
+    const std::byte* data_ = nullptr;
+    std::size_t size_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;    // HANDLE of the file
+    void* mapping_ = nullptr; // HANDLE of the file mapping
+#else
+    int fd_ = -1;
+#endif
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,292 @@
+#include "MarketAggregates.h"
+#include "World.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <span>
+
+const ProductAggregate& MarketAggregates::product(ProductId product) const noexcept {
+    static const ProductAggregate none;
+    return product < products_.size() ? products_[product] : none;
+}
+
+BusinessHandle MarketAggregates::top() const noexcept {
+    if (heap_.empty()) {
+        return {};
+    }
+    return {heap_.front(), generations_[heap_.front()]};
+}
+
+std::vector<BusinessHandle> MarketAggregates::top(std::size_t count) const {
+    // Walk the heap best-first: the next best business is always a child of one already taken
+    std::vector<BusinessHandle> result;
+    std::vector<std::size_t> frontier; // Heap positions whose parent was taken
+    auto worse = [this](std::size_t a, std::size_t b) { return before(heap_[b], heap_[a]); };
+    if (!heap_.empty()) {
+        frontier.push_back(0);
+    }
+    while (!frontier.empty() && result.size() < count) {
+        std::pop_heap(frontier.begin(), frontier.end(), worse);
+        std::size_t position = frontier.back();
+        frontier.pop_back();
+        result.push_back({heap_[position], generations_[heap_[position]]});
+        for (std::size_t child = 2 * position + 1; child <= 2 * position + 2 && child < heap_.size(); ++child) {
+            frontier.push_back(child);
+            std::push_heap(frontier.begin(), frontier.end(), worse);
+        }
+    }
+    return result;
+}
+
+void MarketAggregates::addRow(ProductId product, double price, int supply, double demand) {
+    if (product == INVALID_PRODUCT) {
+        return; // Rows of unknown products are not offered to anyone
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    ProductAggregate& totals = row(product);
+    ++totals.sellers;
+    totals.supply += supply;
+    totals.demand += demand;
+    totals.priceSum += price;
+}
+
+void MarketAggregates::removeRow(ProductId product, double price, int supply, double demand) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (product >= products_.size()) {
+        return;
+    }
+    ProductAggregate& totals = products_[product];
+    --totals.sellers;
+    totals.supply -= supply;
+    totals.demand -= demand;
+    totals.priceSum -= price;
+}
+
+void MarketAggregates::addSupply(ProductId product, std::int64_t delta) noexcept {
+    if (product < products_.size()) {
+        std::atomic_ref<std::int64_t>(products_[product].supply).fetch_add(delta, std::memory_order_relaxed);
+    }
+}
+
+void MarketAggregates::markStock(BusinessHandle business) noexcept {
+    std::uint32_t slot = business.index;
+    if (slot >= marked_.size() || marked_[slot]) {
+        return; // Not indexed, or already waiting for the next refresh()
+    }
+    marked_[slot] = 1; // Only the thread updating the business writes its flag
+    marks_[markCount_.fetch_add(1, std::memory_order_relaxed)] = slot;
+}
+
+void MarketAggregates::addBusiness(const Business& business) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::uint32_t slot = business.handle().index;
+    resizeSlots(slot + 1);
+    generations_[slot] = business.handle().generation;
+    prices_[slot] = business.stockPrice();
+    shares_[slot] = business.sharesOutstanding();
+    stockPriceSum_ += prices_[slot];
+    marketCap_ += prices_[slot] * shares_[slot];
+    heap_.push_back(slot);
+    siftUp(heap_.size() - 1);
+
+    auto products = business.products();
+    for (std::size_t i = 0; i < products.size(); ++i) {
+        if (products[i] != INVALID_PRODUCT) {
+            ProductAggregate& totals = row(products[i]);
+            ++totals.sellers;
+            totals.supply += business.supply()[i];
+            totals.demand += business.demand()[i];
+            totals.priceSum += business.prices()[i];
+        }
+    }
+}
+
+void MarketAggregates::removeBusiness(const Business& business) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::uint32_t slot = business.handle().index;
+    if (slot >= position_.size() || position_[slot] == NOT_INDEXED) {
+        return;
+    }
+    // Take back what the business contributed, which may predate moves still waiting for refresh()
+    stockPriceSum_ -= prices_[slot];
+    marketCap_ -= prices_[slot] * shares_[slot];
+    std::size_t position = position_[slot];
+    std::uint32_t last = heap_.back();
+    heap_.pop_back();
+    position_[slot] = NOT_INDEXED;
+    if (last != slot) {
+        place(position, last);
+        siftUp(position);
+        siftDown(position_[last]);
+    }
+
+    auto products = business.products();
+    for (std::size_t i = 0; i < products.size(); ++i) {
+        if (products[i] < products_.size()) {
+            ProductAggregate& totals = products_[products[i]];
+            --totals.sellers;
+            totals.supply -= business.supply()[i];
+            totals.demand -= business.demand()[i];
+            totals.priceSum -= business.prices()[i];
+        }
+    }
+}
+
+void MarketAggregates::refresh(const World& world) {
+    if (productsStale_.exchange(false, std::memory_order_relaxed)) {
+        rebuildProducts(world); // A sweep rewrote the rows, one pass over the columns beats per-row deltas
+    }
+
+    std::span<std::uint32_t> marks(marks_.data(), markCount_.exchange(0, std::memory_order_relaxed));
+    for (std::uint32_t slot : marks) {
+        marked_[slot] = 0;
+    }
+    if (marks.size() * 4 > heap_.size()) {
+        rebuildStocks(world); // Most of the market moved: heapify instead of sifting every business
+        return;
+    }
+    std::sort(marks.begin(), marks.end()); // Slot order keeps the running sums independent of the thread count
+    const SlotPool<Business>& businesses = world.businesses();
+    for (std::uint32_t slot : marks) {
+        const Business* business = businesses.at(slot);
+        if (business != nullptr && position_[slot] != NOT_INDEXED) {
+            setStock(slot, business->stockPrice(), business->sharesOutstanding());
+        }
+    }
+    if (!std::isfinite(stockPriceSum_) || !std::isfinite(marketCap_)) {
+        rebuildStocks(world); // An infinite price poisons the running sums until it is summed from scratch
+    }
+}
+
+void MarketAggregates::rebuild(const World& world) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    productsStale_.store(false, std::memory_order_relaxed);
+    markCount_.store(0, std::memory_order_relaxed);
+    std::fill(marked_.begin(), marked_.end(), 0);
+    rebuildProducts(world);
+    rebuildStocks(world);
+}
+
+ProductAggregate& MarketAggregates::row(ProductId product) {
+    if (product >= products_.size()) {
+        products_.resize(product + 1);
+    }
+    return products_[product];
+}
+
+void MarketAggregates::resizeSlots(std::uint32_t slots) {
+    if (slots <= position_.size()) {
+        return;
+    }
+    position_.resize(slots, NOT_INDEXED);
+    generations_.resize(slots);
+    prices_.resize(slots);
+    shares_.resize(slots);
+    marked_.resize(slots);
+    marks_.resize(slots); // Every slot is marked at most once between refreshes
+}
+
+void MarketAggregates::rebuildProducts(const World& world) {
+    std::fill(products_.begin(), products_.end(), ProductAggregate{});
+    const SlotPool<Business>& businesses = world.businesses();
+    for (std::uint32_t slot = 0; slot < businesses.slots(); ++slot) {
+        const Business* business = businesses.at(slot);
+        if (business == nullptr) {
+            continue;
+        }
+        auto products = business->products();
+        auto supply = business->supply();
+        auto demand = business->demand();
+        auto prices = business->prices();
+        for (std::size_t i = 0; i < products.size(); ++i) {
+            if (products[i] != INVALID_PRODUCT) {
+                ProductAggregate& totals = row(products[i]);
+                ++totals.sellers;
+                totals.supply += supply[i];
+                totals.demand += demand[i];
+                totals.priceSum += prices[i];
+            }
+        }
+    }
+}
+
+void MarketAggregates::rebuildStocks(const World& world) {
+    const SlotPool<Business>& businesses = world.businesses();
+    resizeSlots(businesses.slots());
+    stockPriceSum_ = 0;
+    marketCap_ = 0;
+    heap_.clear();
+    for (std::uint32_t slot = 0; slot < businesses.slots(); ++slot) {
+        const Business* business = businesses.at(slot);
+        if (business == nullptr) {
+            position_[slot] = NOT_INDEXED;
+            continue;
+        }
+        generations_[slot] = business->handle().generation;
+        prices_[slot] = business->stockPrice();
+        shares_[slot] = business->sharesOutstanding();
+        stockPriceSum_ += prices_[slot];
+        marketCap_ += prices_[slot] * shares_[slot];
+        position_[slot] = static_cast<std::uint32_t>(heap_.size());
+        heap_.push_back(slot);
+    }
+    for (std::size_t position = heap_.size() / 2; position-- > 0;) {
+        siftDown(position);
+    }
+}
+
+void MarketAggregates::setStock(std::uint32_t slot, double price, std::int64_t shares) {
+    stockPriceSum_ += price - prices_[slot];
+    marketCap_ += price * shares - prices_[slot] * shares_[slot];
+    prices_[slot] = price;
+    shares_[slot] = shares;
+    siftUp(position_[slot]);
+    siftDown(position_[slot]);
+}
+
+bool MarketAggregates::before(std::uint32_t a, std::uint32_t b) const noexcept {
+    double priceA = prices_[a];
+    double priceB = prices_[b];
+    bool nanA = std::isnan(priceA);
+    bool nanB = std::isnan(priceB);
+    if (nanA != nanB) {
+        return nanB; // NaN ranks below every price
+    }
+    if (!nanA && priceA != priceB) {
+        return priceA > priceB;
+    }
+    return a < b;
+}
+
+void MarketAggregates::siftUp(std::size_t position) noexcept {
+    std::uint32_t slot = heap_[position];
+    while (position > 0) {
+        std::size_t parent = (position - 1) / 2;
+        if (!before(slot, heap_[parent])) {
+            break;
+        }
+        place(position, heap_[parent]);
+        position = parent;
+    }
+    place(position, slot);
+}
+
+void MarketAggregates::siftDown(std::size_t position) noexcept {
+    std::uint32_t slot = heap_[position];
+    for (;;) {
+        std::size_t child = 2 * position + 1;
+        if (child >= heap_.size()) {
+            break;
+        }
+        if (child + 1 < heap_.size() && before(heap_[child + 1], heap_[child])) {
+            ++child;
+        }
+        if (!before(heap_[child], slot)) {
+            break;
+        }
+        place(position, heap_[child]);
+        position = child;
+    }
+    place(position, slot);
+}
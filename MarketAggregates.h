@@ -0,0 +1,126 @@
+#pragma once
+#ifndef MARKET_AGGREGATES_H
+#define MARKET_AGGREGATES_H
+
+#include "Handle.h"
+#include "ProductCatalog.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+class Business;
+class World;
+
+/**
+ * @struct ProductAggregate
+ * @brief Totals of one product over every business offering it.
+ */
+struct ProductAggregate {
+    std::uint32_t sellers = 0; // Businesses offering the product
+    alignas(std::atomic_ref<std::int64_t>::required_alignment) std::int64_t supply = 0; // Units in stock, all sellers
+    double demand = 0;   // Sum of the demand of every seller
+    double priceSum = 0; // Sum of the prices of every seller
+
+    double meanPrice() const noexcept { return sellers != 0 ? priceSum / sellers : 0.0; }
+    double meanDemand() const noexcept { return sellers != 0 ? demand / sellers : 0.0; }
+};
+
+/**
+ * @class MarketAggregates
+ * @brief Market-wide totals and indices of a World, kept up to date as the businesses change.
+ *
+ * Per-product totals, the market cap and a max-heap of the businesses by stock price answer questions about the
+ * whole market in O(1) (O(k log k) for the top k) instead of a scan over every business.
+ *
+ * Point changes are applied as they happen: supply changes are atomic and exact, so purchases may commit from
+ * several threads; adding and removing products and businesses goes through a mutex. Changes that rewrite a
+ * business wholesale only mark it: stock moves mark the business and product sweeps mark the product totals as
+ * stale. Nothing in a tick reads the aggregates, so the marks pile up until a reader calls refresh(), which folds
+ * them in once, in slot order, so the totals do not depend on the number of threads: by moving the marked
+ * businesses in the stock index, or by summing the market again when most of it moved.
+ */
+class MarketAggregates {
+  public:
+    /**
+     * @brief Get the totals of a product.
+     * @return The totals, all zero for a product no business offers.
+     */
+    const ProductAggregate& product(ProductId product) const noexcept;
+
+    std::size_t businesses() const noexcept { return heap_.size(); } // Businesses in the index
+    double stockPriceSum() const noexcept { return stockPriceSum_; }
+    double meanStockPrice() const noexcept { return heap_.empty() ? 0.0 : stockPriceSum_ / heap_.size(); }
+    double marketCap() const noexcept { return marketCap_; } // Sum of stock price times shares outstanding
+
+    /**
+     * @brief Get the business with the highest stock price.
+     * @return Its handle, or a null handle for an empty market.
+     */
+    BusinessHandle top() const noexcept;
+
+    /**
+     * @brief Get the businesses with the highest stock prices, highest first.
+     * Ties go to the lower slot; NaN prices rank last.
+     * @param count The number of businesses to return, at most.
+     */
+    std::vector<BusinessHandle> top(std::size_t count) const;
+
+    // Hooks of Business and World. Products are only added and removed outside of phases that commit purchases,
+    // since addRow() may grow the totals addSupply() updates without the lock
+    void addRow(ProductId product, double price, int supply, double demand);    // A business added a product
+    void removeRow(ProductId product, double price, int supply, double demand); // A business removed a product
+    void addSupply(ProductId product, std::int64_t delta) noexcept; // Thread-safe while no product is added
+    void markStock(BusinessHandle business) noexcept; // Stock price or shares moved, by the thread owning it
+    void markProducts() noexcept { productsStale_.store(true, std::memory_order_relaxed); } // Rows rewritten
+    void addBusiness(const Business& business);    // A business joined the world
+    void removeBusiness(const Business& business); // A business is about to leave the world
+
+    /**
+     * @brief Fold in the marked changes. Must not run concurrently with anything writing the world.
+     * @param world The world the aggregates belong to.
+     */
+    void refresh(const World& world);
+
+    /**
+     * @brief Recompute everything from the businesses of a world, e.g. after restoring a snapshot.
+     */
+    void rebuild(const World& world);
+
+  private:
+    static constexpr std::uint32_t NOT_INDEXED = static_cast<std::uint32_t>(-1); // Position of a free slot
+
+    ProductAggregate& row(ProductId product); // Totals of a product, growing the table for new IDs
+    void resizeSlots(std::uint32_t slots);
+    void rebuildProducts(const World& world);
+    void rebuildStocks(const World& world);
+    void setStock(std::uint32_t slot, double price, std::int64_t shares); // Cached values and heap position
+
+    // Heap over slots: higher stock price first, then lower slot
+    bool before(std::uint32_t a, std::uint32_t b) const noexcept;
+    void siftUp(std::size_t position) noexcept;
+    void siftDown(std::size_t position) noexcept;
+    void place(std::size_t position, std::uint32_t slot) noexcept {
+        heap_[position] = slot;
+        position_[slot] = static_cast<std::uint32_t>(position);
+    }
+
+    std::vector<ProductAggregate> products_;  // Totals by product ID
+    std::atomic<bool> productsStale_ = false; // Set when product rows were rewritten in bulk
+
+    double stockPriceSum_ = 0;
+    double marketCap_ = 0;
+    std::vector<std::uint32_t> heap_;        // Slots of the indexed businesses, as a binary max-heap
+    std::vector<std::uint32_t> position_;    // Position of every slot in heap_, NOT_INDEXED if free
+    std::vector<std::uint32_t> generations_; // Generation of the business indexed in every slot
+    std::vector<double> prices_;             // Stock price every slot contributes
+    std::vector<std::int64_t> shares_;       // Shares outstanding every slot contributes
+    std::vector<std::uint8_t> marked_;       // Whether every slot is in marks_
+    std::vector<std::uint32_t> marks_;       // Slots marked since the last refresh(), first markCount_ entries
+    std::atomic<std::size_t> markCount_ = 0;
+    std::mutex mutex_; // Serializes the structural hooks
+};
+
+#endif // MARKET_AGGREGATES_H
@@ -0,0 +1,255 @@
+#include "Metrics.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace {
+
+constexpr double QUANTILES[] = {0.5, 0.9, 0.99, 0.999, 1.0}; // Quantiles written for every phase
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+const char* counterName(Counter counter) noexcept {
+    switch (counter) {
+    case Counter::PurchasesFilled:
+        return "purchases_filled";
+    case Counter::PurchasesNoBalance:
+        return "purchases_no_balance";
+    case Counter::PurchasesNoSupply:
+        return "purchases_no_supply";
+    case Counter::PurchasesNotAvailable:
+        return "purchases_not_available";
+    case Counter::StockBids:
+        return "stock_bids";
+    case Counter::StockAsks:
+        return "stock_asks";
+    case Counter::StockNoBalance:
+        return "stock_no_balance";
+    case Counter::StockNoShares:
+        return "stock_no_shares";
+    case Counter::StockFills:
+        return "stock_fills";
+    case Counter::SharesTraded:
+        return "shares_traded";
+    case Counter::BusinessesCreated:
+        return "businesses_created";
+    case Counter::BusinessesClosed:
+        return "businesses_closed";
+    case Counter::NpcsCreated:
+        return "npcs_created";
+    case Counter::BusinessUpdates:
+        return "business_updates";
+    case Counter::NpcUpdates:
+        return "npc_updates";
+    case Counter::Transfers:
+        return "transfers";
+    default:
+        return "unknown";
+    }
+}
+
+const char* sectionName(Section section) noexcept {
+    switch (section) {
+    case Section::NpcStocks:
+        return "npc_stocks";
+    case Section::NpcProducts:
+        return "npc_products";
+    default:
+        return "unknown";
+    }
+}
+
+const char* phaseName(Phase phase) noexcept {
+    switch (phase) {
+    case Phase::Businesses:
+        return "businesses";
+    case Phase::Decide:
+        return "decide";
+    case Phase::Purchases:
+        return "purchases";
+    case Phase::Orders:
+        return "orders";
+    case Phase::Auctions:
+        return "auctions";
+    case Phase::Settle:
+        return "settle";
+    case Phase::Ledger:
+        return "ledger";
+    case Phase::Restructure:
+        return "restructure";
+    case Phase::Tick:
+        return "tick";
+    default:
+        return "unknown";
+    }
+}
+
+void LatencyHistogram::record(std::uint64_t nanos) noexcept {
+    ++buckets_[bucket(nanos)];
+    ++count_;
+    sum_ += nanos;
+    min_ = std::min(min_, nanos);
+    max_ = std::max(max_, nanos);
+}
+
+void LatencyHistogram::clear() noexcept {
+    *this = LatencyHistogram();
+}
+
+std::uint64_t LatencyHistogram::percentile(double percent) const noexcept {
+    if (count_ == 0) {
+        return 0;
+    }
+    double rank = std::ceil(std::clamp(percent, 0.0, 100.0) / 100.0 * count_);
+    std::uint64_t target = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(rank));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets_[i];
+        if (seen >= target) {
+            return std::min(highest(i), max_);
+        }
+    }
+    return max_;
+}
+
+std::size_t LatencyHistogram::bucket(std::uint64_t nanos) noexcept {
+    if (nanos < SUB_BUCKETS) {
+        return static_cast<std::size_t>(nanos); // Exact
+    }
+    unsigned exponent = static_cast<unsigned>(std::bit_width(nanos)) - 1;   // At least SUB_BITS
+    std::uint64_t mantissa = nanos >> (exponent - SUB_BITS);                // Leading SUB_BITS + 1 bits
+    return (exponent - SUB_BITS + 1) * SUB_BUCKETS + static_cast<std::size_t>(mantissa - SUB_BUCKETS);
+}
+
+std::uint64_t LatencyHistogram::highest(std::size_t bucket) noexcept {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    unsigned shift = static_cast<unsigned>(bucket / SUB_BUCKETS) - 1; // exponent - SUB_BITS
+    std::uint64_t mantissa = SUB_BUCKETS + bucket % SUB_BUCKETS;
+    return (mantissa << shift) + ((std::uint64_t{1} << shift) - 1);
+}
+
+void MetricsSnapshot::writePrometheus(std::ostream& out) const {
+    for (std::size_t c = 0; c < COUNTER_COUNT; ++c) {
+        const char* name = counterName(static_cast<Counter>(c));
+        out << "# TYPE ecosim_" << name << "_total counter\n"
+            << "ecosim_" << name << "_total " << counters[c] << "\n";
+    }
+
+    out << "# HELP ecosim_section_seconds_total Time spent in code sections, summed over the threads.\n"
+        << "# TYPE ecosim_section_seconds_total counter\n";
+    for (std::size_t s = 0; s < SECTION_COUNT; ++s) {
+        out << "ecosim_section_seconds_total{section=\"" << sectionName(static_cast<Section>(s)) << "\"} "
+            << sectionNanos[s] * 1e-9 << "\n";
+    }
+
+    out << "# HELP ecosim_phase_seconds Wall time of the phases of every tick.\n"
+        << "# TYPE ecosim_phase_seconds summary\n";
+    for (std::size_t p = 0; p < PHASE_COUNT; ++p) {
+        const char* name = phaseName(static_cast<Phase>(p));
+        for (double quantile : QUANTILES) {
+            out << "ecosim_phase_seconds{phase=\"" << name << "\",quantile=\"" << quantile << "\"} "
+                << phases[p].percentile(quantile * 100) * 1e-9 << "\n";
+        }
+        out << "ecosim_phase_seconds_sum{phase=\"" << name << "\"} " << phases[p].sum() * 1e-9 << "\n"
+            << "ecosim_phase_seconds_count{phase=\"" << name << "\"} " << phases[p].count() << "\n";
+    }
+}
+
+void MetricsSnapshot::writeJson(std::ostream& out) const {
+    out << "{\n  \"ticks\": " << ticks() << ",\n  \"counters\": {";
+    for (std::size_t c = 0; c < COUNTER_COUNT; ++c) {
+        out << (c != 0 ? ", " : "") << "\"" << counterName(static_cast<Counter>(c)) << "\": " << counters[c];
+    }
+    out << "},\n  \"section_seconds\": {";
+    for (std::size_t s = 0; s < SECTION_COUNT; ++s) {
+        out << (s != 0 ? ", " : "") << "\"" << sectionName(static_cast<Section>(s)) << "\": " << sectionNanos[s] * 1e-9;
+    }
+    out << "},\n  \"phases\": {\n";
+    for (std::size_t p = 0; p < PHASE_COUNT; ++p) {
+        const LatencyHistogram& histogram = phases[p];
+        out << "    \"" << phaseName(static_cast<Phase>(p)) << "\": {\"count\": " << histogram.count()
+            << ", \"mean_ns\": " << histogram.mean() << ", \"min_ns\": " << histogram.min()
+            << ", \"p50_ns\": " << histogram.percentile(50) << ", \"p90_ns\": " << histogram.percentile(90)
+            << ", \"p99_ns\": " << histogram.percentile(99) << ", \"p999_ns\": " << histogram.percentile(99.9)
+            << ", \"max_ns\": " << histogram.max() << "}" << (p + 1 < PHASE_COUNT ? "," : "") << "\n";
+    }
+    out << "  }\n}\n";
+}
+
+Metrics& Metrics::global() {
+    static Metrics metrics;
+    return metrics;
+}
+
+void Metrics::record(Phase phase, std::uint64_t nanos) noexcept {
+    phases_[static_cast<std::size_t>(phase)].record(nanos);
+}
+
+MetricsSnapshot Metrics::snapshot() const {
+    MetricsSnapshot snapshot;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& block : blocks_) {
+        for (std::size_t c = 0; c < COUNTER_COUNT; ++c) {
+            snapshot.counters[c] += block->counters[c].load(std::memory_order_relaxed);
+        }
+        for (std::size_t s = 0; s < SECTION_COUNT; ++s) {
+            snapshot.sectionNanos[s] += block->sections[s].load(std::memory_order_relaxed);
+        }
+    }
+    snapshot.phases = phases_;
+    return snapshot;
+}
+
+void Metrics::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& block : blocks_) {
+        for (auto& counter : block->counters) {
+            counter.store(0, std::memory_order_relaxed);
+        }
+        for (auto& section : block->sections) {
+            section.store(0, std::memory_order_relaxed);
+        }
+    }
+    for (LatencyHistogram& phase : phases_) {
+        phase.clear();
+    }
+}
+
+bool Metrics::write(const std::string& path) const {
+    MetricsSnapshot metrics = snapshot();
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary);
+        if (!out) {
+            return false; // Cannot create the file
+        }
+        if (endsWith(path, ".json")) {
+            metrics.writeJson(out);
+        } else {
+            metrics.writePrometheus(out);
+        }
+        if (!out.flush()) {
+            return false; // Disk full or similar
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error); // Replaces the previous file in one step
+    return !error;
+}
+
+Metrics::Block& Metrics::registerThread() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    blocks_.push_back(std::make_unique<Block>());
+    local_ = blocks_.back().get();
+    return *local_;
+}
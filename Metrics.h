@@ -0,0 +1,290 @@
+#pragma once
+#ifndef METRICS_H
+#define METRICS_H
+
+#ifndef ECOSIM_METRICS
+#define ECOSIM_METRICS 1 // Build the profiler; define it to 0 to compile every probe out
+#endif
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Events counted by every thread.
+ */
+enum class Counter : std::uint8_t {
+    PurchasesFilled,       // Product purchases delivered
+    PurchasesNoBalance,    // Product purchases the NPC could not afford
+    PurchasesNoSupply,     // Product purchases the business could not deliver in full
+    PurchasesNotAvailable, // Product purchases of a product the business does not sell
+    StockBids,             // Stock buy orders placed (Npc::buyStock)
+    StockAsks,             // Stock sell orders placed (Npc::sellStock)
+    StockNoBalance,        // Stock buy orders the NPC could not afford
+    StockNoShares,         // Stock sell orders for more shares than the NPC holds
+    StockFills,            // Stock orders filled, at least partially
+    SharesTraded,          // Shares that changed hands
+    BusinessesCreated,     // Businesses added to a world
+    BusinessesClosed,      // Businesses removed from a world
+    NpcsCreated,           // NPCs added to a world
+    BusinessUpdates,       // Businesses updated by ticks
+    NpcUpdates,            // NPCs updated by ticks
+    Transfers,             // Journal entries applied by ledgers
+    Count,
+};
+
+/**
+ * @brief Code sections timed on every thread; their times add up over the threads running them.
+ */
+enum class Section : std::uint8_t {
+    NpcStocks,   // Npc::decide: the loops over held and candidate stocks
+    NpcProducts, // Npc::decide: the loop over candidate products
+    Count,
+};
+
+/**
+ * @brief Phases of a tick, timed on the thread running the tick; see TickScheduler.
+ */
+enum class Phase : std::uint8_t {
+    Businesses,  // 1: business updates, market aggregates and candidate tables
+    Decide,      // 2: NPC decisions
+    Purchases,   // 3: businesses commit the product purchases
+    Orders,      // 3: stock orders enter the order books
+    Auctions,    // 4: call auctions
+    Settle,      // 5: NPCs settle their purchases and orders
+    Ledger,      // 5: the journal of the tick is applied and audited
+    Restructure, // 6: businesses founded and closed
+    Tick,        // The whole tick
+    Count,
+};
+
+constexpr std::size_t COUNTER_COUNT = static_cast<std::size_t>(Counter::Count);
+constexpr std::size_t SECTION_COUNT = static_cast<std::size_t>(Section::Count);
+constexpr std::size_t PHASE_COUNT = static_cast<std::size_t>(Phase::Count);
+
+const char* counterName(Counter counter) noexcept; // snake_case name used in the metrics files
+const char* sectionName(Section section) noexcept;
+const char* phaseName(Phase phase) noexcept;
+
+/**
+ * @class LatencyHistogram
+ * @brief Log-linear histogram of durations in nanoseconds, in the manner of HDR histograms.
+ *
+ * Every power of two is split into 32 buckets, so a recorded value is known within 3% across the whole range of
+ * 64-bit values, at a fixed 15 KB and O(1) per record.
+ */
+class LatencyHistogram {
+  public:
+    void record(std::uint64_t nanos) noexcept;
+    void clear() noexcept;
+
+    std::uint64_t count() const noexcept { return count_; }
+    std::uint64_t sum() const noexcept { return sum_; } // Total of every recorded value
+    std::uint64_t min() const noexcept { return count_ != 0 ? min_ : 0; }
+    std::uint64_t max() const noexcept { return max_; }
+    double mean() const noexcept { return count_ != 0 ? static_cast<double>(sum_) / count_ : 0.0; }
+
+    /**
+     * @brief Get a percentile of the recorded values.
+     * @param percent The percentile, from 0 to 100.
+     * @return The highest value of the bucket holding the percentile, capped by max(); 0 if nothing was recorded.
+     */
+    std::uint64_t percentile(double percent) const noexcept;
+
+  private:
+    static constexpr unsigned SUB_BITS = 5;                                   // log2 of the buckets per power of two
+    static constexpr std::size_t SUB_BUCKETS = std::size_t{1} << SUB_BITS;
+    static constexpr std::size_t BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS; // Exact below 32, then 59 powers
+
+    static std::size_t bucket(std::uint64_t nanos) noexcept;
+    static std::uint64_t highest(std::size_t bucket) noexcept; // Highest value falling into a bucket
+
+    std::array<std::uint64_t, BUCKETS> buckets_ = {};
+    std::uint64_t count_ = 0;
+    std::uint64_t sum_ = 0;
+    std::uint64_t min_ = UINT64_MAX;
+    std::uint64_t max_ = 0;
+};
+
+/**
+ * @struct MetricsSnapshot
+ * @brief Copy of every metric at one point of a run.
+ */
+struct MetricsSnapshot {
+    std::array<std::uint64_t, COUNTER_COUNT> counters = {};
+    std::array<std::uint64_t, SECTION_COUNT> sectionNanos = {}; // Summed over the threads
+    std::array<LatencyHistogram, PHASE_COUNT> phases;           // One duration per tick
+
+    std::uint64_t counter(Counter counter) const noexcept { return counters[static_cast<std::size_t>(counter)]; }
+    double sectionSeconds(Section section) const noexcept {
+        return sectionNanos[static_cast<std::size_t>(section)] * 1e-9;
+    }
+    const LatencyHistogram& phase(Phase phase) const noexcept { return phases[static_cast<std::size_t>(phase)]; }
+    std::uint64_t ticks() const noexcept { return phase(Phase::Tick).count(); }
+
+    void writePrometheus(std::ostream& out) const; // Prometheus text exposition format
+    void writeJson(std::ostream& out) const;
+};
+
+/**
+ * @class Metrics
+ * @brief Low-overhead profiler of the simulation: event counters, section timers and tick phase histograms.
+ *
+ * Counters and section times are kept per thread, in blocks registered on first use, so a probe is a thread-local
+ * load and a relaxed store with no contention; snapshot() adds the blocks up. Phase durations are recorded once per
+ * tick by the thread running it. Probes compile to nothing when ECOSIM_METRICS is 0.
+ */
+class Metrics {
+  public:
+    static constexpr bool COMPILED = ECOSIM_METRICS != 0; // Whether the probes are built
+
+    /**
+     * @brief Get the metrics shared by the whole simulation.
+     */
+    static Metrics& global();
+
+    /**
+     * @brief Count events on the calling thread.
+     */
+    static void count(Counter counter, std::uint64_t amount = 1) noexcept {
+#if ECOSIM_METRICS
+        add(local().counters[static_cast<std::size_t>(counter)], amount);
+#else
+        (void)counter;
+        (void)amount;
+#endif
+    }
+
+    /**
+     * @brief Add time to a section on the calling thread; see SectionTimer.
+     */
+    static void time(Section section, std::uint64_t nanos) noexcept {
+#if ECOSIM_METRICS
+        add(local().sections[static_cast<std::size_t>(section)], nanos);
+#else
+        (void)section;
+        (void)nanos;
+#endif
+    }
+
+    /**
+     * @brief Record the duration of a tick phase. Not thread-safe with snapshot(); see PhaseTimer.
+     */
+    void record(Phase phase, std::uint64_t nanos) noexcept;
+
+    /**
+     * @brief Get every metric. Call it between ticks, from the thread running them.
+     */
+    MetricsSnapshot snapshot() const;
+
+    /**
+     * @brief Zero every metric, e.g. after the warm-up. Call it between ticks, from the thread running them.
+     */
+    void reset();
+
+    /**
+     * @brief Write a snapshot to a file, replacing it at once so readers never see a partial file.
+     * @param path The path of the file; files ending in .json get JSON, others the Prometheus text format.
+     * @return false if the file cannot be written.
+     */
+    bool write(const std::string& path) const;
+
+    static std::uint64_t now() noexcept { // Monotonic clock of the timers, in nanoseconds
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+                .count());
+    }
+
+  private:
+    struct alignas(64) Block {
+        std::array<std::atomic<std::uint64_t>, COUNTER_COUNT> counters = {};
+        std::array<std::atomic<std::uint64_t>, SECTION_COUNT> sections = {};
+    };
+
+    Metrics() = default;
+
+    static void add(std::atomic<std::uint64_t>& value, std::uint64_t amount) noexcept {
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed); // Only writer
+    }
+    static Block& local() noexcept {
+        return local_ != nullptr ? *local_ : global().registerThread();
+    }
+    Block& registerThread(); // Create the block of the calling thread
+
+    static inline thread_local Block* local_ = nullptr; // Block of the calling thread
+
+    mutable std::mutex mutex_;                   // Guards blocks_
+    std::vector<std::unique_ptr<Block>> blocks_; // One per thread that ever counted, kept for the whole run
+    std::array<LatencyHistogram, PHASE_COUNT> phases_;
+};
+
+/**
+ * @class SectionTimer
+ * @brief Adds the time from its construction to its destruction to a section of the calling thread.
+ */
+class SectionTimer {
+  public:
+#if ECOSIM_METRICS
+    explicit SectionTimer(Section section) noexcept : section_(section), start_(Metrics::now()) {}
+    ~SectionTimer() { stop(); }
+
+    void stop() noexcept { // End the measurement before the end of the scope
+        if (running_) {
+            Metrics::time(section_, Metrics::now() - start_);
+            running_ = false;
+        }
+    }
+#else
+    explicit SectionTimer(Section) noexcept {}
+    void stop() noexcept {}
+#endif
+    SectionTimer(const SectionTimer&) = delete;
+    SectionTimer& operator=(const SectionTimer&) = delete;
+
+#if ECOSIM_METRICS
+  private:
+    Section section_;
+    std::uint64_t start_;
+    bool running_ = true;
+#endif
+};
+
+/**
+ * @class PhaseTimer
+ * @brief Records the time from its construction to its destruction as one duration of a tick phase.
+ */
+class PhaseTimer {
+  public:
+#if ECOSIM_METRICS
+    explicit PhaseTimer(Phase phase) noexcept : phase_(phase), start_(Metrics::now()) {}
+    ~PhaseTimer() { stop(); }
+
+    void stop() noexcept { // End the measurement before the end of the scope
+        if (running_) {
+            Metrics::global().record(phase_, Metrics::now() - start_);
+            running_ = false;
+        }
+    }
+#else
+    explicit PhaseTimer(Phase) noexcept {}
+    void stop() noexcept {}
+#endif
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+#if ECOSIM_METRICS
+  private:
+    Phase phase_;
+    std::uint64_t start_;
+    bool running_ = true;
+#endif
+};
+
+#endif // METRICS_H
@@ -0,0 +1,69 @@
+#pragma once
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <cmath>
+#include <compare>
+#include <cstdint>
+
+/**
+ * @class Money
+ * @brief Amount of money in fixed point: a signed 64-bit count of cents.
+ *
+ * Sums of Money are exact and do not depend on the order they are added in, so balances come out bit-identical
+ * whatever the number of threads. Prices stay doubles; an amount computed from a price is rounded to the cent once,
+ * when it becomes Money. Conversions saturate at LIMIT cents, far beyond any amount in circulation, so that adding
+ * converted amounts cannot overflow.
+ */
+class Money {
+  public:
+    static constexpr std::int64_t SCALE = 100;                   // Cents per unit
+    static constexpr std::int64_t LIMIT = std::int64_t{1} << 52; // Largest convertible amount in cents
+
+    constexpr Money() noexcept = default;
+
+    static constexpr Money fromCents(std::int64_t cents) noexcept { return Money(cents); }
+
+    /**
+     * @brief Convert an amount to the nearest cent; NaN converts to zero.
+     */
+    static Money fromDouble(double amount) noexcept { return convert(std::nearbyint(amount * SCALE)); }
+
+    /**
+     * @brief Convert an amount to the cent at or above it, e.g. to reserve enough for a price.
+     */
+    static Money ceil(double amount) noexcept { return convert(std::ceil(amount * SCALE)); }
+
+    constexpr std::int64_t cents() const noexcept { return cents_; }
+    constexpr double toDouble() const noexcept { return static_cast<double>(cents_) / SCALE; }
+
+    constexpr Money operator-() const noexcept { return Money(-cents_); }
+    constexpr Money operator+(Money other) const noexcept { return Money(cents_ + other.cents_); }
+    constexpr Money operator-(Money other) const noexcept { return Money(cents_ - other.cents_); }
+    constexpr Money operator*(std::int64_t count) const noexcept { return Money(cents_ * count); } // E.g. shares
+    constexpr Money& operator+=(Money other) noexcept {
+        cents_ += other.cents_;
+        return *this;
+    }
+    constexpr Money& operator-=(Money other) noexcept {
+        cents_ -= other.cents_;
+        return *this;
+    }
+
+    constexpr auto operator<=>(const Money&) const noexcept = default;
+
+  private:
+    constexpr explicit Money(std::int64_t cents) noexcept : cents_(cents) {}
+
+    static Money convert(double cents) noexcept {
+        if (!(cents == cents)) {
+            return Money(); // NaN
+        }
+        double limit = static_cast<double>(LIMIT);
+        return Money(static_cast<std::int64_t>(cents < -limit ? -limit : cents > limit ? limit : cents));
+    }
+
+    std::int64_t cents_ = 0;
+};
+
+#endif // MONEY_H
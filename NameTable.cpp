@@ -0,0 +1,112 @@
+#include "NameTable.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+
+NameTable& NameTable::global() {
+    static NameTable table;
+    return table;
+}
+
+NameId NameTable::add(std::string_view name) {
+    if (name.empty()) {
+        return EMPTY_NAME;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    NameId id;
+    if (!freeIds_.empty()) {
+        id = freeIds_.back();
+        freeIds_.pop_back();
+    } else {
+        if (nextId_ == 0) {
+            throw std::overflow_error("NameTable: every NameId is in use");
+        }
+        id = nextId_++; // Wraps to 0 once every ID was handed out
+        if ((id & (PAGE_SIZE - 1)) == 0 || ownedPages_.empty()) {
+            ownedPages_.emplace_back(new Entry[PAGE_SIZE]);
+            pages_[id >> PAGE_SHIFT].store(ownedPages_.back().get(), std::memory_order_release);
+        }
+    }
+    Entry* page = pages_[id >> PAGE_SHIFT].load(std::memory_order_relaxed);
+    page[id & (PAGE_SIZE - 1)] = {store(name), static_cast<std::uint32_t>(name.size())};
+    ++live_;
+    return id;
+}
+
+void NameTable::assign(NameId& id, std::string_view name) {
+    if (id == EMPTY_NAME || name.empty()) {
+        release(id);
+        id = add(name);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry& entry = pages_[id >> PAGE_SHIFT].load(std::memory_order_relaxed)[id & (PAGE_SIZE - 1)];
+    if (entry.length != name.size()) {
+        recycle(entry);
+        entry = {store(name), static_cast<std::uint32_t>(name.size())};
+    } else {
+        std::memcpy(const_cast<char*>(entry.data), name.data(), name.size()); // Same length: rewrite in place
+    }
+}
+
+void NameTable::release(NameId id) {
+    if (id == EMPTY_NAME) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry& entry = pages_[id >> PAGE_SHIFT].load(std::memory_order_relaxed)[id & (PAGE_SIZE - 1)];
+    recycle(entry);
+    entry = {};
+    freeIds_.push_back(id);
+    --live_;
+}
+
+std::size_t NameTable::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return live_;
+}
+
+std::size_t NameTable::bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t freeBlocks = 0;
+    for (const auto& [length, blocks] : freeBlocks_) {
+        freeBlocks += blocks.capacity() * sizeof(const char*);
+    }
+    return arenaBytes_ + ownedPages_.size() * PAGE_SIZE * sizeof(Entry) + freeIds_.capacity() * sizeof(NameId) +
+           freeBlocks;
+}
+
+const char* NameTable::store(std::string_view name) {
+    char* block;
+    auto reusable = freeBlocks_.find(static_cast<std::uint32_t>(name.size()));
+    if (reusable != freeBlocks_.end() && !reusable->second.empty()) {
+        block = const_cast<char*>(reusable->second.back());
+        reusable->second.pop_back();
+    } else if (name.size() > CHUNK_SIZE / 4) {
+        chunks_.emplace_back(new char[name.size()]); // Long names get a chunk of their own
+        arenaBytes_ += name.size();
+        block = chunks_.back().get();
+    } else {
+        if (current_ == nullptr || chunkUsed_ + name.size() > CHUNK_SIZE) {
+            chunks_.emplace_back(new char[CHUNK_SIZE]);
+            arenaBytes_ += CHUNK_SIZE;
+            current_ = chunks_.back().get();
+            chunkUsed_ = 0;
+        }
+        block = current_ + chunkUsed_;
+        chunkUsed_ += name.size();
+    }
+    std::memcpy(block, name.data(), name.size());
+    return block;
+}
+
+void NameTable::recycle(const Entry& entry) {
+    if (entry.length != 0) {
+        freeBlocks_[entry.length].push_back(entry.data);
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+#ifndef NAME_TABLE_H
+#define NAME_TABLE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using NameId = std::uint32_t; // Compact identifier of a name stored in a NameTable
+
+constexpr NameId EMPTY_NAME = 0; // Identifier of the empty name, which takes no storage
+
+/**
+ * @class NameTable
+ * @brief Cold side table holding the names and descriptions of entities, out of the entities themselves.
+ *
+ * An entity keeps a 4-byte NameId instead of a 32-byte string. The characters live in an arena of fixed chunks that
+ * never move, so name() can hand out string_views. Released blocks are reused by the next name of the same length,
+ * which matches how generated names recur; the arena only grows with the names alive at the peak.
+ *
+ * Adding and releasing names is thread-safe. get() takes no lock and may run while other threads add names; a
+ * view stays valid until its name is released or reassigned.
+ */
+class NameTable {
+  public:
+    /**
+     * @brief Get the table shared by the whole simulation.
+     */
+    static NameTable& global();
+
+    NameTable() = default;
+    NameTable(const NameTable&) = delete;
+    NameTable& operator=(const NameTable&) = delete;
+
+    /**
+     * @brief Store a name.
+     * @return The ID of the name; EMPTY_NAME for an empty name.
+     */
+    NameId add(std::string_view name);
+
+    /**
+     * @brief Replace a name, keeping its ID when it has one.
+     * @param id The ID to update; EMPTY_NAME is replaced by a new ID.
+     * @param name The new name.
+     */
+    void assign(NameId& id, std::string_view name);
+
+    /**
+     * @brief Release a name; its ID and characters are reused by later names. EMPTY_NAME is ignored.
+     */
+    void release(NameId id);
+
+    /**
+     * @brief Get a name.
+     */
+    std::string_view get(NameId id) const noexcept {
+        if (id == EMPTY_NAME) {
+            return {};
+        }
+        const Entry& entry = pages_[id >> PAGE_SHIFT].load(std::memory_order_acquire)[id & (PAGE_SIZE - 1)];
+        return {entry.data, entry.length};
+    }
+
+    std::size_t size() const;  // Number of names alive
+    std::size_t bytes() const; // Memory held by the table, arena and entries included
+
+  private:
+    static constexpr std::uint32_t PAGE_SHIFT = 16; // 65536 entries per page
+    static constexpr std::uint32_t PAGE_SIZE = 1u << PAGE_SHIFT;
+    static constexpr std::size_t MAX_PAGES = 1u << (32 - PAGE_SHIFT); // Enough pages for every NameId
+    static constexpr std::size_t CHUNK_SIZE = 1 << 16;                // Arena bytes per chunk
+
+    struct Entry {
+        const char* data = nullptr;
+        std::uint32_t length = 0;
+    };
+
+    const char* store(std::string_view name); // Copy the characters into a free block or the arena
+    void recycle(const Entry& entry);         // Hand the block of an entry to the free lists
+
+    mutable std::mutex mutex_;                                               // Guards everything but the reads of get()
+    std::array<std::atomic<Entry*>, MAX_PAGES> pages_{};                     // Entries by ID, pages never move
+    std::vector<std::unique_ptr<Entry[]>> ownedPages_;                       // Storage of the pages
+    std::uint32_t nextId_ = 1;                                               // Next new ID, 0 is EMPTY_NAME
+    std::vector<NameId> freeIds_;                                            // Released IDs
+    std::vector<std::unique_ptr<char[]>> chunks_;                            // Arena, chunks never move
+    char* current_ = nullptr;                                                // Chunk short names are appended to
+    std::size_t chunkUsed_ = 0;                                              // Bytes used in current_
+    std::size_t arenaBytes_ = 0;                                             // Bytes of every chunk
+    std::unordered_map<std::uint32_t, std::vector<const char*>> freeBlocks_; // Released blocks, by length
+    std::size_t live_ = 0;                                                   // Names alive
+};
+
+#endif // NAME_TABLE_H
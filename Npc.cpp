@@ -1,219 +1,436 @@
 #include "Npc.h"
-#include <iostream>
+#include "EventLog.h"
+#include "Metrics.h"
+#include "Random.h"
+#include "World.h"
 
+#include <algorithm>
 #include <cmath>
-#include <random>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string_view>
 
-Npc::Npc(std::string name) : balance_(0), score_(0), name_(name), INTEREST_RATE(0.05) {
-    // Initialize the Npc with a name and default values for balance and score
-    balance_ = 10000;    // Set initial balance to 10,000
-    score_ = 0;          // Set initial score to 0
-    savingsAccount_ = 0; // Initialize savings account to 0
+std::atomic<std::uint64_t> Npc::created_ = 0; // Number of NPCs created so far
+
+Npc::Npc(std::string_view name) : id_(created_++), name_(NameTable::global().add(name)) {
+    // Initialize the Npc with a name and default values for balance and score; the World pays the endowment in
+    // through the ledger
 }
 
+Npc::Npc(std::string_view name, std::uint64_t id) : id_(id), name_(NameTable::global().add(name)) {}
+
 Npc::~Npc() {
-    // Destructor
-    // Clean up any resources if needed
-    for (auto& business : ownedBusinesses_) {
-        delete business; // Delete the business object
-    }
-    ownedBusinesses_.clear(); // Clear the vector of owned businesses
+    NameTable::global().release(name_);
 }
 
 void Npc::setName(const std::string& name) {
-    this->name_ = name;
+    NameTable::global().assign(name_, name);
+}
+
+std::string_view Npc::name() const {
+    return NameTable::global().get(name_);
+}
+
+std::uint64_t Npc::id() const {
+    return id_;
 }
 
-std::string Npc::name() const {
-    return name_;
+NpcHandle Npc::handle() const {
+    return handle_;
 }
 
 int Npc::score() const {
     return score_;
 }
 
-int Npc::buyStock(Business* business, int amount) {
-    double stockPrice = business->stockPrice();
-    if (amount * stockPrice > balance_) {
-        std::cout << "Not enough balance to buy " << amount << " stocks of " << business->name() << std::endl;
+int Npc::buyStock(const Business* business, int amount, std::vector<StockOrder>& orders) {
+    return buyStock(business, amount, business->stockPrice(), orders);
+}
+
+int Npc::buyStock(const Business* business, int amount, double limit, std::vector<StockOrder>& orders) {
+    // Checked in double first, which rules out costs beyond the range of Money, then exactly in cents
+    if (!(amount * limit <= available().toDouble()) || Money::ceil(limit) * amount > available()) {
+        EventLog::emit(EventLevel::Debug, {.kind = EventKind::Rejected, .reason = RejectReason::NotEnoughBalance,
+                                           .business = static_cast<std::uint32_t>(business->id()), .actor = id_,
+                                           .amount = amount, .price = limit});
+        Metrics::count(Counter::StockNoBalance);
         return -1; // Not enough balance
     }
-    if (stocks_.find(business) == stocks_.end()) {
-        stocks_[business] = amount; // Initialize if not already present
-    }
-    // Create a copy of the business
-    stocks_[business] += amount; // Increase the amount of stocks owned
 
-    buyStockPrices_[business] = stockPrice; // Store the price at which the stock was bought
-
-    balance_ -= amount * stockPrice;
+    reserved_ += Money::ceil(limit) * amount; // Reserve the cost at the limit, settle() pays the fill and releases it
+    orders.push_back({business->handle(), OrderSide::Bid, amount, limit});
+    Metrics::count(Counter::StockBids);
+    return amount; // Amount of stocks ordered
+}
 
-    score_ += (int)(2 * (sqrt(stockPrice) * log2(amount)));
-    std::cout << "Bought " << amount << " stocks of " << business->name() << std::endl;
-    return amount; // Amount of stocks bought
+int Npc::sellStock(const Business* business, int amount, std::vector<StockOrder>& orders) {
+    return sellStock(business, amount, business->stockPrice(), orders);
 }
 
-int Npc::sellStock(Business* business, int amount) {
-    double stockPrice = business->stockPrice();
-    if (stocks_.find(business) == stocks_.end()) {
-        std::cout << "You don't own any stocks of " << business->name() << std::endl;
+int Npc::sellStock(const Business* business, int amount, double limit, std::vector<StockOrder>& orders) {
+    Holding* holding = portfolio_.find(business->handle());
+    if (holding == nullptr || holding->shares == 0) {
+        EventLog::emit(EventLevel::Debug, {.kind = EventKind::Rejected, .reason = RejectReason::NoStocks,
+                                           .business = static_cast<std::uint32_t>(business->id()), .actor = id_,
+                                           .amount = amount, .price = limit});
+        Metrics::count(Counter::StockNoShares);
         return 0; // No stocks to sell
     }
-    if (stocks_[business] < amount) {
-        std::cout << "You don't own enough stocks of " << business->name() << std::endl;
+    if (holding->shares < amount) {
+        EventLog::emit(EventLevel::Debug, {.kind = EventKind::Rejected, .reason = RejectReason::NotEnoughStocks,
+                                           .business = static_cast<std::uint32_t>(business->id()), .actor = id_,
+                                           .amount = amount, .price = limit});
+        Metrics::count(Counter::StockNoShares);
         return 0; // Not enough stocks to sell
     }
-    stocks_[business] -= amount;
-    balance_ += amount * stockPrice;
 
-    score_ += (int)(2 * (sqrt(stockPrice) * log2(amount)));
+    holding->shares -= amount; // Reserve the stocks, settle() returns what the order did not sell
+    orders.push_back({business->handle(), OrderSide::Ask, amount, limit});
+    Metrics::count(Counter::StockAsks);
+    return amount; // Amount of stocks ordered
+}
 
-    std::cout << "Sold " << amount << " stocks of " << business->name() << std::endl;
+void Npc::settle(const World& world, const StockFill& fill, std::vector<JournalEntry>& journal) {
+    BusinessHandle business = fill.business;
+    Money payment = Money::fromDouble(fill.price) * fill.filled; // The same price in cents for every fill
+    if (fill.side == OrderSide::Bid) {
+        reserved_ -= Money::ceil(fill.limit) * fill.ordered; // Release the reservation of buyStock()
+        if (fill.filled == 0) {
+            return;
+        }
+        journal.push_back({Account::npc(handle_.index), Account::business(business.index), payment,
+                           TransferKind::StockTrade});
+        Holding& holding = portfolio_.insert(business);
+        holding.shares += fill.filled;  // Increase the amount of stocks owned
+        holding.costBasis = fill.price; // Store the price at which the stock was bought
+        Metrics::count(Counter::StockFills);
+        Metrics::count(Counter::SharesTraded, fill.filled); // Counted on the buying side only
+
+        score_ += (int)(2 * (sqrt(fill.price) * log2(fill.filled)));
+        EventLog::emit(EventLevel::Info, {.kind = EventKind::StockBought,
+                                          .business = static_cast<std::uint32_t>(world.business(business)->id()),
+                                          .actor = id_, .amount = fill.filled, .price = fill.price});
+        return;
+    }
 
-    if (business->stockPrice() < business->initialStockPrice()) {
-        std::cout << "Stock price of " << business->name() << " has decreased." << std::endl;
+    if (fill.filled > 0) {
+        journal.push_back({Account::business(business.index), Account::npc(handle_.index), payment,
+                           TransferKind::StockTrade});
     }
+    Holding& holding = portfolio_.insert(business); // Kept by sellStock() while the order was pending
+    holding.shares += fill.ordered - fill.filled;   // Return the stocks that did not sell
+    if (fill.filled == 0) {
+        return;
+    }
+
+    score_ += (int)(2 * (sqrt(fill.price) * log2(fill.filled)));
+    Metrics::count(Counter::StockFills);
 
-    if (stocks_[business] == 0) {
-        stocks_.erase(business); // Remove business from stocks if no stocks left
-        std::cout << "No more stocks of " << business->name() << " left." << std::endl;
+    const Business* sold = world.business(business);
+    std::uint32_t soldId = static_cast<std::uint32_t>(sold->id());
+    EventLog::emit(EventLevel::Info, {.kind = EventKind::StockSold, .business = soldId, .actor = id_,
+                                      .amount = fill.filled, .price = fill.price});
+
+    if (sold->stockPrice() < sold->initialStockPrice()) {
+        EventLog::emit(EventLevel::Debug, {.kind = EventKind::StockPriceDecreased, .business = soldId, .actor = id_,
+                                           .price = sold->stockPrice()});
     }
 
-    return amount; // Amount of stocks sold
+    if (holding.shares == 0) {
+        EventLog::emit(EventLevel::Info, {.kind = EventKind::PositionClosed, .business = soldId, .actor = id_});
+    }
 }
 
-double Npc::buy(Business& business, std::string& product, int amount) {
-    if (business.supply(product) == 0) {
-        std::cout << "Product not available in the business." << std::endl;
+double Npc::buy(World& world, Business& business, ProductId product, int amount) {
+    int supply = business.supply(product); // Look the product up once, the checks work on this value
+    if (supply == 0) {
+        EventLog::emit(EventLevel::Debug, {.kind = EventKind::Rejected, .reason = RejectReason::NotAvailable,
+                                           .business = static_cast<std::uint32_t>(business.id()), .actor = id_,
+                                           .product = product, .amount = amount});
+        Metrics::count(Counter::PurchasesNotAvailable);
         return -1; // Product not available
     }
 
-    if (business.supply(product) < amount) {
-        std::cout << "Not enough supply " << product << " in the business." << std::endl;
+    if (supply < amount) {
+        EventLog::emit(EventLevel::Debug, {.kind = EventKind::Rejected, .reason = RejectReason::NotEnoughSupply,
+                                           .business = static_cast<std::uint32_t>(business.id()), .actor = id_,
+                                           .product = product, .amount = amount});
+        Metrics::count(Counter::PurchasesNoSupply);
         return 0; // Not enough supply
     }
 
-    if (amount * business.supply(product) > balance_) {
-        std::cout << "Not enough balance to buy " << amount << " of " << product << std::endl;
+    Money cost = Money::fromDouble(amount * std::max(business.price(product), 0.0)); // At the current product price
+    if (cost > available()) {
+        EventLog::emit(EventLevel::Debug, {.kind = EventKind::Rejected, .reason = RejectReason::NotEnoughBalance,
+                                           .business = static_cast<std::uint32_t>(business.id()), .actor = id_,
+                                           .product = product, .amount = amount, .price = cost.toDouble()});
+        Metrics::count(Counter::PurchasesNoBalance);
         return -2; // Not enough balance
     }
 
-    balance_ -= business.supply(product) * amount; // Deduct the cost from the Npc's balance
+    business.sellProduct(product, amount); // Reduce the supply
+    world.ledger().transfer({Account::npc(handle_.index), Account::business(business.handle().index), cost,
+                             TransferKind::Purchase}); // Pay the business
+    Metrics::count(Counter::PurchasesFilled);
 
-    business.setSupply(product, business.supply(product) - amount); // Reduce the supply in the business
-    business.addBalance(amount * business.supply(product));         // Add the cost to the business balance
+    EventLog::emit(EventLevel::Info, {.kind = EventKind::ProductBought,
+                                      .business = static_cast<std::uint32_t>(business.id()), .actor = id_,
+                                      .product = product, .amount = amount, .price = cost.toDouble()});
 
-    std::cout << "Bought " << amount << " of " << product << " from " << business.name() << std::endl;
-
-    score_ += amount * business.supply(product); // Increase the score by the amount of product
-    return amount * business.supply(product);    // Return the total cost of the purchase
+    score_ += static_cast<int>(cost.toDouble()); // Increase the score by the value of the purchase
+    return cost.toDouble();                      // Return the total cost of the purchase
 }
 
-void Npc::setBalance(int balance) {
-    this->balance_ = balance;
+double Npc::buy(World& world, Business& business, const std::string& product, int amount) {
+    return buy(world, business, ProductCatalog::global().find(product), amount);
 }
 
-double Npc::balance() const {
+Money Npc::balance() const {
     return balance_;
 } // Get the current balance of the Npc
 
-double Npc::savingsAccount() const {
+Money Npc::savingsAccount() const {
     return savingsAccount_; // Get the savings account balance
 }
 
-std::vector<std::string> Npc::getBusinessNames() const {
+std::vector<std::string> Npc::getBusinessNames(const World& world) const {
     std::vector<std::string> businessNames;
 
-    for (const auto& business : ownedBusinesses_) {
-        businessNames.push_back(business->name());
+    for (const auto& owned : owned()) {
+        if (const Business* business = world.business(owned.business)) {
+            businessNames.emplace_back(business->name());
+        }
     }
 
     return businessNames;
 }
 
-Business* Npc::getBusiness(const std::string& name) const {
-    for (const auto business : ownedBusinesses_) {
-        if (business->name() == name) {
-            return business; // Return the business if found
+BusinessHandle Npc::getBusiness(const World& world, const std::string& name) const {
+    std::size_t nameHash = std::hash<std::string>{}(name);
+    std::span<const OwnedBusiness> businesses = owned();
+    auto range = std::equal_range(businesses.begin(), businesses.end(), OwnedBusiness{nameHash});
+    for (auto it = range.first; it != range.second; ++it) {
+        const Business* business = world.business(it->business);
+        if (business != nullptr && business->name() == name) {
+            return it->business; // Return the business if found
+        }
+    }
+    for (const auto& owned : businesses) {
+        const Business* business = world.business(owned.business);
+        if (business != nullptr && business->name() == name) {
+            return owned.business; // Renamed since it was founded
         }
     }
-    return nullptr; // Business not found
+    return {}; // Business not found
 }
 
-Business* Npc::createBusiness(std::string& name) {
-    if (!(balance_ > 10000)) {
-        std::cout << "Not enough balance to create a business." << std::endl;
-        // Return the first business if not enough balance
+BusinessHandle Npc::createBusiness(World& world, const std::string& name) {
+    if (!(balance_ > ENDOWMENT)) {
+        EventLog::emit(EventLevel::Debug,
+                       {.kind = EventKind::Rejected, .reason = RejectReason::BusinessUnderfunded, .actor = id_});
     }
-    Business* business = new Business(name); // Create a new business object
-    ownedBusinesses_.push_back(business);    // Add to the Npc's list of businesses
-    Business& returnBus = *business;
-    // Return the created business
-    return &returnBus;
+    BusinessHandle business = world.createBusiness(name); // Create the business in the world
+    OwnedBusiness owned{std::hash<std::string>{}(name), business};
+    std::vector<OwnedBusiness>& businesses = ownedList();
+    businesses.insert(std::upper_bound(businesses.begin(), businesses.end(), owned),
+                      owned); // Add to the Npc's list of businesses, after those of the same name
+    return business;
 }
 
-void Npc::update(std::vector<Business*>& businesses) {
-    // Update cycle for the Npc
-    // This function can be used to update the Npc's state, such as balance, score, etc.
+std::span<const Npc::OwnedBusiness> Npc::owned() const noexcept {
+    if (owned_ == nullptr) {
+        return {};
+    }
+    return *owned_;
+}
 
-    savingsAccount_ += savingsAccount_ * INTEREST_RATE; // Update savings account with interest
+std::vector<Npc::OwnedBusiness>& Npc::ownedList() {
+    if (owned_ == nullptr) {
+        owned_ = std::make_unique<std::vector<OwnedBusiness>>();
+    }
+    return *owned_;
+}
 
-    std::random_device rd;                          // Random device for generating random numbers
-    std::mt19937 gen(rd());                         // Mersenne Twister random number generator
-    std::uniform_real_distribution<> dis(0.0, 1.0); // Uniform distribution between 0 and 1
+void Npc::update(World& world, const CandidateSelector& candidates) {
+    // Update cycle for the Npc, running the decision and its commit back to back
+    thread_local IntentBuffer intents; // Reused by every NPC updated on this thread
+    intents.clear();
+    decide(world, candidates, intents);
+    for (auto& purchase : intents.purchases) {
+        Business* business = world.businesses().at(purchase.business);
+        purchase.result = business->sellProduct(purchase.product, purchase.amount);
+    }
+    for (const auto& order : intents.orders) {
+        world.business(order.business)->orderBook().submit(order, handle_.index); // Matched by the auction
+    }
+    settle(world, intents.purchases, std::span<const StockFill>{}, intents.journal);
+    world.ledger().transfer(intents.journal); // Serial, so the entries need no batch
+}
 
-    for (auto it = stocks_.begin(); it != stocks_.end(); ++it) {
-        double roll = dis(gen);                           // Generate a random factor
-        double stockPrice = it->first->stockPrice();      // Get the stock price of the business
-        double initialPrice = buyStockPrices_[it->first]; // Get the initial price of the stock
+void Npc::decide(const World& world, const CandidateSelector& candidates, IntentBuffer& intents) {
+    visitStrategy(strategy_, [&](auto strategy) { decide<decltype(strategy)>(world, candidates, intents); });
+}
 
-        /**
-         * @brief rolls for a chance to sell stocks
-         * only sells if the stock price is higher than the initial price
-         * then rolls for a random amount to sell
-         */
-        if (stockPrice > initialPrice && roll > 0.5) {
-            int rollAmount = static_cast<int>(it->second * roll); // Calculate the amount to sell
-            if (rollAmount > 0) {
-                sellStock(it->first, rollAmount); // Sell the stocks based on the random factor
-            }
+template <class Strategy>
+void Npc::decide(const World& world, const CandidateSelector& candidates, IntentBuffer& intents) {
+    using Trading = typename Strategy::Trading;
+    using Purchasing = typename Strategy::Purchasing;
+    using Formation = typename Strategy::Formation;
+
+    // This function updates the Npc's own state (balance, score, savings, stocks) and only reads the businesses
+    reserved_ = Money(); // Every purchase and order of the last tick is settled
+    std::size_t firstPurchase = intents.purchases.size(); // The buffer may hold the decisions of other NPCs
+    std::size_t firstOrder = intents.orders.size();
+
+    Money interest = Money::fromDouble(savingsAccount_.toDouble() * INTEREST_RATE); // Interest on the savings
+    if (interest != Money()) {
+        intents.journal.push_back(
+            {Account::system(), Account::savings(handle_.index), interest, TransferKind::Interest});
+    }
+
+    RandomStream rng = RandomService::global().stream(RandomDomain::Npc, id_); // Stream of this NPC and tick
+    const SlotPool<Business>& businesses = world.businesses();
+
+    SectionTimer stocks(Section::NpcStocks);
+    portfolio_.compact(); // Every order of the last tick is settled: sort in the new positions, drop the closed ones
+
+    for (Holding& holding : portfolio_.holdings()) {
+        const Business* business = world.business(holding.business);
+        if (business == nullptr) {
+            EventLog::emit(EventLevel::Warning, {.kind = EventKind::PositionWrittenOff, .actor = id_,
+                                                 .amount = static_cast<std::int32_t>(holding.shares)});
+            holding.shares = 0; // The business was closed, its handle is stale; the next compact() drops it
+            continue;
+        }
+
+        OrderChoice ask = Trading::ask(rng, holding.shares, business->stockPrice(), holding.costBasis);
+        if (ask.shares > 0) {
+            sellStock(business, ask.shares, ask.limit, intents.orders);
         }
     }
 
-    for (auto& business : businesses) {
-        double roll = dis(gen);                                 // Generate a random factor
-        if (roll > 0.5) {                                       // 50% chance to buy stocks
-            int amount = static_cast<int>(dis(gen) * balance_ / business->stockPrice()); // Random amount to buy (0-10)
-            buyStock(business, amount);                         // Buy the stocks based on the random factor
+    thread_local std::vector<Candidate> scratch; // Reused by every NPC decided on this thread
+    std::span<const Candidate> considered = candidates.select(id_, rng, scratch);
+
+    for (const Candidate& candidate : considered) {
+        const Business* business = businesses.at(candidate.business);
+        OrderChoice bid = Trading::bid(rng, business->stockPrice(), available().toDouble());
+        if (bid.shares > 0) {
+            buyStock(business, bid.shares, bid.limit, intents.orders);
         }
     }
 
-    double roll = dis(gen); // Generate a random factor
-    // 50% chance to buy products from businesses
-    if (roll > 0.5) {
-        for (auto& business : businesses) {
-            int product_num = static_cast<int>(dis(gen) * business->productNames().size()); // Random product number
-            int amount = static_cast<int>(dis(gen) * 10);                               // Random amount to buy (0-10)
+    stocks.stop();
+
+    SectionTimer products(Section::NpcProducts);
+    double roll = rng.uniform(); // Shared by the purchasing and formation decisions
+    if (Purchasing::shops(roll)) {
+        for (const Candidate& candidate : considered) {
+            const Business* business = businesses.at(candidate.business);
+            std::span<const ProductId> products = business->products(); // View of the business's products
+            ProductChoice choice = Purchasing::pick(rng, products.size());
+            int amount = static_cast<int>(std::lround(choice.amount * candidate.weight)); // For every business
 
-            std::string product = business->productNames()[product_num]; // Get the product name
+            if (products.empty()) {
+                continue; // Nothing to buy from this business
+            }
 
-            buy(*business, product, amount); // Buy the product from the business
+            ProductId product = products[choice.product];
+            // Prices do not move until the next tick; products priced at or below zero are free
+            Money cost = Money::fromDouble(amount * std::max(business->price(product), 0.0));
+            if (cost > available()) {
+                EventLog::emit(EventLevel::Debug,
+                               {.kind = EventKind::Rejected, .reason = RejectReason::NotEnoughBalance,
+                                .business = static_cast<std::uint32_t>(business->id()), .actor = id_,
+                                .product = product, .amount = amount, .price = cost.toDouble()});
+                Metrics::count(Counter::PurchasesNoBalance);
+                continue; // Not enough balance
+            }
+
+            reserved_ += cost; // Reserve the cost, settle() pays it if the business delivers
+            intents.purchases.push_back({candidate.business, product, amount, cost});
         }
     }
 
-    if (roll > 0.7) { // 30% chance to create a new business
-        std::string newBusinessName =
-            "Business" + std::to_string(ownedBusinesses_.size() + 1); // Generate a new business name
-        createBusiness(newBusinessName);                              // Create a new business
+    products.stop();
+
+    auto units = [](const PurchaseIntent& purchase) { return purchase.amount != 0; };
+    trading_ = intents.orders.size() != firstOrder ||
+               std::any_of(intents.purchases.begin() + firstPurchase, intents.purchases.end(), units);
+    wantsBusiness_ = Formation::founds(roll); // Created by restructure()
+    businessToSell_ = {};
 
-        businesses.push_back(getBusiness(newBusinessName)); // Add the new business to the list of businesses
+    if (Formation::sells(roll)) {
+        if (owned_ != nullptr && !owned_->empty()) {
+            int business_num = static_cast<int>(rng.uniform() * owned_->size()); // Random business number
+            businessToSell_ = (*owned_)[business_num].business;                  // Closed by restructure()
+            owned_->erase(owned_->begin() + business_num);                       // Remove the business from the list
+        }
     }
+}
 
-    if (roll > 0.9) { // 20% chance to sell a business
-        if (!ownedBusinesses_.empty()) {
-            int business_num = static_cast<int>(dis(gen) * ownedBusinesses_.size()); // Random business number
-            Business* business = ownedBusinesses_[business_num];                     // Get the business
-            ownedBusinesses_.erase(ownedBusinesses_.begin() + business_num); // Remove the business from the 
+// The decision loop of every strategy visitStrategy() reaches, for the schedulers deciding groups of NPCs
+template void Npc::decide<Speculator>(const World&, const CandidateSelector&, IntentBuffer&);
+template void Npc::decide<Investor>(const World&, const CandidateSelector&, IntentBuffer&);
+template void Npc::decide<Consumer>(const World&, const CandidateSelector&, IntentBuffer&);
+
+void Npc::accrueInterest(std::uint64_t ticks, std::vector<JournalEntry>& journal) {
+    if (ticks != 0) {
+        double growth = std::pow(1.0 + INTEREST_RATE, static_cast<double>(ticks)) - 1.0; // Compounded once per tick
+        Money interest = Money::fromDouble(savingsAccount_.toDouble() * growth);
+        if (interest != Money()) {
+            journal.push_back({Account::system(), Account::savings(handle_.index), interest,
+                               TransferKind::Interest});
         }
     }
-}
\ No newline at end of file
+}
+
+void Npc::settle(const World& world, std::span<const PurchaseIntent> purchases, std::span<const StockFill> fills,
+                 std::vector<JournalEntry>& journal) {
+    for (const auto& purchase : purchases) {
+        EventRecord event{.business = static_cast<std::uint32_t>(world.businesses().at(purchase.business)->id()),
+                          .actor = id_, .product = purchase.product, .amount = purchase.amount,
+                          .price = purchase.cost.toDouble()};
+        reserved_ -= purchase.cost; // Release the reservation of decide()
+        switch (purchase.result) {
+        case PurchaseResult::Filled:
+            event.kind = EventKind::ProductBought;
+            EventLog::emit(EventLevel::Info, event);
+            journal.push_back({Account::npc(handle_.index), Account::business(purchase.business), purchase.cost,
+                               TransferKind::Purchase});
+            score_ += static_cast<int>(purchase.cost.toDouble()); // Increase the score by the value of the purchase
+            Metrics::count(Counter::PurchasesFilled);
+            break;
+        case PurchaseResult::NotAvailable:
+            event.reason = RejectReason::NotAvailable;
+            EventLog::emit(EventLevel::Debug, event);
+            Metrics::count(Counter::PurchasesNotAvailable);
+            break;
+        default:
+            event.reason = RejectReason::NotEnoughSupply;
+            EventLog::emit(EventLevel::Debug, event);
+            Metrics::count(Counter::PurchasesNoSupply);
+            break;
+        }
+    }
+
+    for (const auto& fill : fills) {
+        settle(world, fill, journal);
+    }
+}
+
+void Npc::restructure(World& world) {
+    if (!businessToSell_.isNull()) {
+        world.destroyBusiness(businessToSell_); // The sold business closes
+        businessToSell_ = {};
+    }
+    if (wantsBusiness_) {
+        wantsBusiness_ = false;
+        createBusiness(world, newBusinessName());
+    }
+}
+
+std::string Npc::newBusinessName() const {
+    return "Business" + std::to_string(owned().size() + 1); // Numbered after the businesses the NPC owns
+}
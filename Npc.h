@@ -2,9 +2,22 @@
 #ifndef NPC_H
 #define NPC_H
 #include "Business.h"
+#include "CandidateSelector.h"
+#include "Handle.h"
+#include "Intent.h"
+#include "Ledger.h"
+#include "Money.h"
+#include "NpcStrategy.h"
+#include "OrderBook.h"
+#include "Portfolio.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <span>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 
 /**
@@ -13,17 +26,40 @@
  * * The NPC can own businesses, buy and sell stocks, and manage a balance.
  * * The NPC can also buy products from businesses and has a savings account with an interest rate.
  */
+class World;
+
 class Npc {
 public:
-    Npc(std::string name);
+    static constexpr Money ENDOWMENT = Money::fromCents(10000 * Money::SCALE); // Default balance of a new NPC
+
+    Npc(std::string_view name);
+
+    /**
+     * @brief Create an NPC with a given creation number, for worlds holding only part of a population.
+     * The creation counter is not advanced, so a world must create all of its NPCs this way or none.
+     */
+    Npc(std::string_view name, std::uint64_t id);
     ~Npc();
+    Npc(const Npc&) = delete;
+    Npc& operator=(const Npc&) = delete;
 
     /**
      * * @brief Set the name of the NPC.
      * * @param name The name to set for the NPC.
      */
     void setName(const std::string& name);
-    std::string name() const;
+    std::string_view name() const; // Valid until the NPC is renamed or destroyed
+
+    /**
+     * @brief Get the ID of the NPC.
+     * @return The creation number of the NPC, which keys its random stream.
+     */
+    std::uint64_t id() const;
+
+    /**
+     * @brief Get the handle of the NPC in its World.
+     */
+    NpcHandle handle() const;
 
     /**
      * * @brief Get the score of the NPC.
@@ -33,74 +69,232 @@ public:
 
     /**
      * * @brief Get the balance of the NPC.
-     * * @return The balance of the NPC.
+     * * @return The balance of the NPC, including the money reserved by pending purchases and orders.
      */
-    double balance() const;
+    Money balance() const;
+
+    /**
+     * @brief Get the part of the balance not reserved by pending purchases and orders.
+     */
+    Money available() const noexcept { return balance_ - reserved_; }
 
     /**
      * * @brief Get the savings account balance of the NPC.
      * * @return The savings account balance of the NPC.
      */
-    double savingsAccount() const; // Get the savings account balance
+    Money savingsAccount() const; // Get the savings account balance
+    /**
+     * @brief Place a bid for stocks of a business at its current stock price.
+     * * @see buyStock(const Business*, int, double, std::vector<StockOrder>&)
+     */
+    int buyStock(const Business* business, int amount, std::vector<StockOrder>& orders);
+
     /**
-     * @brief Buy stocks from a business.
+     * @brief Place a bid for stocks of a business.
+     * * The cost at the limit price, rounded up to the cent, is reserved from the balance; the order is matched by
+     * the business's auction and settled by settle(const World&, const StockFill&, std::vector<JournalEntry>&).
      * * @param business The business from which to buy stocks.
      * * @param amount The amount of stocks to buy.
-     * * @return The amount of stocks bought.
+     * * @param limit The highest price the NPC pays per stock.
+     * * @param orders Where the order is recorded for submission.
+     * * @return The amount of stocks ordered, or -1 if the balance does not cover the order.
+     */
+    int buyStock(const Business* business, int amount, double limit, std::vector<StockOrder>& orders);
+
+    /**
+     * @brief Place an ask for stocks of a business at its current stock price.
+     * * @see sellStock(const Business*, int, double, std::vector<StockOrder>&)
      */
-    int buyStock(Business* business, int amount);
+    int sellStock(const Business* business, int amount, std::vector<StockOrder>& orders);
 
     /**
-     * @brief Sell stocks of a business.
+     * @brief Place an ask for stocks of a business.
+     * * The stocks are taken out of the portfolio until the order is settled by
+     * settle(const World&, const StockFill&, std::vector<JournalEntry>&).
      * * @param business The business from which to sell stocks.
      * * @param amount The amount of stocks to sell.
-     * * @return The amount of stocks sold.
+     * * @param limit The lowest price the NPC accepts per stock.
+     * * @param orders Where the order is recorded for submission.
+     * * @return The amount of stocks ordered, or 0 if the NPC does not own enough stocks.
+     */
+    int sellStock(const Business* business, int amount, double limit, std::vector<StockOrder>& orders);
+
+    /**
+     * @brief Settle the execution report of a stock order placed by the NPC.
+     * * Filled stocks change hands and the reservation is released; the payment at the clearing price, rounded to
+     * the cent, is posted to the journal.
+     * * @param world The world the business belongs to.
+     * * @param fill The execution report from the business's order book.
+     * * @param journal Where the payment is posted, for the ledger of the world.
      */
-    int sellStock(Business* business, int amount);
+    void settle(const World& world, const StockFill& fill, std::vector<JournalEntry>& journal);
 
     /**
-     * @brief Buy a product from a business.
+     * @brief Buy a product from a business, paying through the ledger of the world right away.
+     * * Products priced at or below zero are free.
+     * * @param world The world the NPC and the business belong to.
      * * @param business The business from which to buy the product.
      * * @param product The product to buy.
      * * @param amount The amount of the product to buy.
-     * * @return The amount of the product bought.
-     * * @note If the product is not available, it returns 0.
-     * @note If the business does not have enough supply, it returns -1.
+     * * @return The total cost of the purchase, charged at the product's current price.
+     * * @note If the product is not available, it returns -1.
+     * @note If the business does not have enough supply, it returns 0.
      * @note If the NPC does not have enough balance, it returns -2.
      */
-    double buy(Business& business, std::string& product, int amount); // Buy a product from a business
+    double buy(World& world, Business& business, ProductId product, int amount); // Buy a product from a business
+
+    /**
+     * @brief Buy a product from a business by name.
+     * * @see buy(World&, Business&, ProductId, int)
+     */
+    double buy(World& world, Business& business, const std::string& product, int amount);
+
+    /**
+     * @brief Get the stock holdings of the NPC.
+     */
+    const Portfolio& portfolio() const noexcept { return portfolio_; }
 
     /**
      * @brief Get the names of all businesses owned by the NPC.
+     * * @param world The world the businesses belong to.
      * * @return A vector of strings containing the names of the businesses.
      */
-    std::vector<std::string> getBusinessNames() const;
+    std::vector<std::string> getBusinessNames(const World& world) const;
     /**
      * @brief Get a business by its name.
+     * * @param world The world the businesses belong to.
      * * @param name The name of the business to get.
-     * * @return A pointer to the business if found, nullptr otherwise.
+     * * @return The handle to the business if found, a null handle otherwise.
      */
-    Business* getBusiness(const std::string& name) const; // Get business by name
+    BusinessHandle getBusiness(const World& world, const std::string& name) const; // Get business by name
     /**
      * @brief Create a new business and add it to the NPC's list of businesses.
+     * * @param world The world to create the business in.
      * * @param name The name of the business to create.
      * * @note This function creates a new business and adds it to the NPC's list of businesses.
      */
-    Business* createBusiness(std::string& name); // Add a business to the Npc
+    BusinessHandle createBusiness(World& world, const std::string& name); // Add a business to the Npc
 
-    void update(std::vector<Business*>& ActiveBusinesses); // update cycle for the Npc
+    /**
+     * @brief Update cycle for the Npc when running outside of a TickScheduler.
+     * * Decides into a buffer of the calling thread, commits the product purchases and submits the stock orders to
+     * the order books of the businesses, tagged with the NPC's slot, and applies the transfers. Stock orders are
+     * matched by Business::auction() at the end of the tick and their reports go to
+     * settle(const World&, const StockFill&, std::vector<JournalEntry>&). Founding and selling businesses is left to
+     * restructure().
+     * * @param world The market.
+     * * @param candidates The selector of the tick, prepared on the same world once for every NPC updated.
+     */
+    void update(World& world, const CandidateSelector& candidates);
+
+    /**
+     * @brief First half of the update cycle: take every decision of the tick without touching any business.
+     * * Savings interest is posted to the journal of the buffer. Product purchases and stock orders are reserved
+     * from the balance and portfolio and appended to the buffer for the businesses to commit. Holdings of businesses
+     * that no longer exist are written off. Only the candidates of the NPC are considered; purchases from a
+     * candidate are scaled by its weight, so the units every business sells match the unbounded market on average.
+     * Stock bids spend a random share of the remaining balance, which bounds them without scaling.
+     * @param world The market, read-only for the whole call.
+     * @param candidates The selector of the tick, prepared on the same world.
+     * @param intents Where the purchases, orders and transfers of the decision are appended.
+     */
+    void decide(const World& world, const CandidateSelector& candidates, IntentBuffer& intents);
+
+    /**
+     * @brief Take the decisions of the tick following a given strategy instead of the NPC's own.
+     * The policies of the strategy are bound at compile time; instantiated in Npc.cpp for every strategy of
+     * visitStrategy(). decide(world, candidates, intents) dispatches here on strategy().
+     * @param world The market, read-only for the whole call.
+     * @param candidates The selector of the tick, prepared on the same world.
+     * @param intents Where the purchases, orders and transfers of the decision are appended.
+     */
+    template <class Strategy>
+    void decide(const World& world, const CandidateSelector& candidates, IntentBuffer& intents);
+
+    /**
+     * @brief Get the strategy the NPC follows; NPCs start as speculators.
+     */
+    StrategyId strategy() const noexcept { return strategy_; }
+    void setStrategy(StrategyId strategy) noexcept { strategy_ = strategy; }
+
+    /**
+     * @brief Post the savings interest of ticks the NPC did not decide in, in closed form.
+     * decide() accrues the interest of its own tick; an event-driven scheduler calls this for the ticks between and
+     * applies the journal before decide(), so that the interest of the decision compounds on it.
+     * @param ticks The number of ticks skipped.
+     * @param journal Where the interest is posted, for the ledger of the world.
+     */
+    void accrueInterest(std::uint64_t ticks, std::vector<JournalEntry>& journal);
+
+    /**
+     * @brief Check whether the last decide() traded: a purchase of some units, a stock order or a holding.
+     * NPCs that did not can be decided less often without missing anything but their random rolls.
+     */
+    bool trading() const noexcept { return trading_ || !portfolio_.empty(); }
+
+    /**
+     * @brief Second half of the update cycle: account for the purchases committed by the businesses.
+     * * Every reservation is released; filled purchases are paid through the journal and add to the score.
+     * Balances only change once the ledger applies the journal.
+     * @param world The market the purchases refer to.
+     * @param purchases The purchases of the NPC's last decide(), with the results the businesses filled in.
+     * @param fills Execution reports of the NPC's stock orders.
+     * @param journal Where the payments are posted, for the ledger of the world.
+     */
+    void settle(const World& world, std::span<const PurchaseIntent> purchases, std::span<const StockFill> fills,
+                std::vector<JournalEntry>& journal);
+
+    /**
+     * @brief Found and close the businesses decided on during decide().
+     * * A sold business is closed and leaves the world; portfolios still holding it notice on their next decide().
+     * * @param world The world to create and destroy businesses in.
+     */
+    void restructure(World& world);
+
+    BusinessHandle businessToSell() const noexcept { return businessToSell_; } // Closed by the next restructure()
+    bool wantsBusiness() const noexcept { return wantsBusiness_; }            // Founds one in the next restructure()
+    std::string newBusinessName() const; // Name of the business the next restructure() founds
 
 private:
-    std::string name_;
-    double balance_;
-    int score_;
-    double savingsAccount_;     // Savings account balance
-    const double INTEREST_RATE; // Interest rate for the savings account
+    friend class World;    // Assigns handle_
+    friend class Ledger;   // Moves money in and out of balance_ and savingsAccount_
+    friend class Snapshot; // Saves and restores the state of the NPC
+
+    static constexpr double INTEREST_RATE = 0.05; // Interest rate for the savings account
+
+    // Business founded by the NPC, indexed by the hash of the name it was founded with
+    struct OwnedBusiness {
+        std::size_t nameHash = 0;
+        BusinessHandle business;
+
+        bool operator<(const OwnedBusiness& other) const noexcept { return nameHash < other.nameHash; }
+    };
 
-    std::vector<Business*> ownedBusinesses_;
-    std::unordered_map<Business*, double> stocks_;         // Business name to amount of stocks
-    std::unordered_map<Business*, double> buyStockPrices_; // price of stocks at the time of purchase
+    std::span<const OwnedBusiness> owned() const noexcept; // Businesses founded and not sold, sorted by name hash
+    std::vector<OwnedBusiness>& ownedList();               // The same, allocated by the first business founded
 
-    void setBalance(int balance);
+    // Hot state, touched by every tick; see the memory budget below the class
+    Money balance_;                                // Funded by the World that creates the NPC
+    Money reserved_;                               // Part of the balance held by the purchases and orders of the tick
+    Money savingsAccount_;                         // Savings account balance
+    int score_ = 0;
+    StrategyId strategy_ = StrategyId::Speculator; // Policies decide() follows
+    bool wantsBusiness_ = false;                   // Set by decide() when the NPC rolled to create a business
+    bool trading_ = false;                         // Whether the last decide() bought some units or placed an order
+    NpcHandle handle_;                             // Set by the World that owns the NPC
+    BusinessHandle businessToSell_;                // Set by decide() when the NPC rolled to sell a business
+    std::uint64_t id_;                             // Creation number of the NPC
+    Portfolio portfolio_;                          // Shares held, with the price they were bought at
+
+    // Cold state: most NPCs never found a business, and the name is only read for display and snapshots
+    std::unique_ptr<std::vector<OwnedBusiness>> owned_; // Sorted by name hash, nullptr until the first business
+    NameId name_ = EMPTY_NAME;                          // In NameTable::global()
+
+    static std::atomic<std::uint64_t> created_; // Number of NPCs created so far
 };
+
+// Memory budget of an NPC on 64-bit targets with three-pointer vectors, excluding what its vectors hold. See
+// "Memory" in the README before growing it
+static_assert(sizeof(void*) != 8 || sizeof(std::vector<int>) != 24 || sizeof(Npc) <= 104,
+              "Npc outgrew its memory budget");
 #endif // Npc_H
@@ -0,0 +1,83 @@
+#include "NpcStrategy.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <string>
+
+const char* strategyName(StrategyId id) noexcept {
+    switch (id) {
+    case StrategyId::Speculator:
+        return "speculator";
+    case StrategyId::Investor:
+        return "investor";
+    case StrategyId::Consumer:
+        return "consumer";
+    default:
+        return "unknown";
+    }
+}
+
+bool parseStrategy(const std::string& name, StrategyId& id) noexcept {
+    for (std::size_t i = 0; i < STRATEGY_COUNT; ++i) {
+        if (name == strategyName(static_cast<StrategyId>(i))) {
+            id = static_cast<StrategyId>(i);
+            return true;
+        }
+    }
+    return false; // Unknown strategy
+}
+
+bool parseStrategies(const std::string& list, std::array<double, STRATEGY_COUNT>& shares) {
+    std::array<double, STRATEGY_COUNT> parsed = {};
+    double total = 0;
+    std::size_t begin = 0;
+    while (begin <= list.size()) {
+        std::size_t end = std::min(list.find(',', begin), list.size());
+        std::string entry = list.substr(begin, end - begin);
+        std::size_t colon = entry.find(':');
+        StrategyId id;
+        if (!parseStrategy(entry.substr(0, colon), id)) {
+            return false; // Unknown strategy
+        }
+        double weight = 1.0;
+        if (colon != std::string::npos) {
+            try {
+                weight = std::stod(entry.substr(colon + 1));
+            } catch (const std::exception&) {
+                return false; // Not a number
+            }
+        }
+        if (!(weight >= 0)) {
+            return false; // Negative or NaN weight
+        }
+        parsed[static_cast<std::size_t>(id)] += weight;
+        total += weight;
+        begin = end + 1;
+    }
+    if (!(total > 0) || !std::isfinite(total)) {
+        return false; // Nobody to follow any strategy
+    }
+    for (double& share : parsed) {
+        share /= total;
+    }
+    shares = parsed;
+    return true;
+}
+
+StrategyId strategyFor(std::uint64_t number, const std::array<double, STRATEGY_COUNT>& shares) noexcept {
+    double position = std::fmod(static_cast<double>(number) * 0.6180339887498949, 1.0);
+    std::size_t last = STRATEGY_COUNT - 1;
+    while (last > 0 && shares[last] == 0) {
+        --last; // Rounding must not hand NPCs to a trailing strategy without a share
+    }
+    std::size_t strategy = 0;
+    double cumulative = shares[0];
+    while (position >= cumulative && strategy < last) {
+        cumulative += shares[++strategy];
+    }
+    return static_cast<StrategyId>(strategy);
+}
@@ -0,0 +1,224 @@
+#pragma once
+#ifndef NPC_STRATEGY_H
+#define NPC_STRATEGY_H
+
+#include "Random.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @file NpcStrategy.h
+ * @brief Behavior of NPCs, split into policies that are composed at compile time.
+ *
+ * Npc::decide<Strategy>() runs the decision loops and asks the policies of its strategy what to do at every step:
+ *  - Trading: whether to sell part of a holding and whether to bid on a candidate business, and at which limit.
+ *  - Purchasing: whether to shop this tick, and which product and how many units to take from a candidate.
+ *  - Formation: whether to found a business or sell one of those the NPC owns.
+ * Policies are stateless structs of static functions, so every call is resolved and inlined at compile time and an
+ * NPC pays no indirect call for its behavior. The scheduler groups NPCs by strategy and decides every group in its
+ * own loop, dispatching on the strategy once per group rather than once per NPC.
+ *
+ * To add a strategy, compose it from policies below, give it a StrategyId and a name, and add it to
+ * visitStrategy(); Npc.cpp instantiates the decision loop for every strategy visitStrategy() can reach.
+ */
+
+/**
+ * @struct OrderChoice
+ * @brief A stock order a trading policy wants placed; no order when shares is 0.
+ */
+struct OrderChoice {
+    int shares = 0;
+    double limit = 0; // Lowest price of an ask, highest price of a bid
+};
+
+/**
+ * @struct ProductChoice
+ * @brief A purchase a purchasing policy wants made from a candidate business.
+ */
+struct ProductChoice {
+    std::size_t product = 0; // Index among the products of the business
+    int amount = 0;          // Units before scaling by the weight of the candidate
+};
+
+// Trading policies
+
+/**
+ * @struct ProfitTaking
+ * @brief Sells part of a holding half of the time once its price is above cost, bids on half of the candidates.
+ */
+struct ProfitTaking {
+    static OrderChoice ask(RandomStream& rng, double shares, double price, double costBasis) noexcept {
+        double roll = rng.uniform();
+        if (price > costBasis && roll > 0.5) {
+            int amount = static_cast<int>(shares * roll);
+            if (amount > 0) {
+                return {amount, std::max(costBasis, price * (1.0 - (roll - 0.5) * 0.2))}; // Up to 10% below market
+            }
+        }
+        return {};
+    }
+
+    static OrderChoice bid(RandomStream& rng, double price, double balance) noexcept {
+        double roll = rng.uniform();
+        if (roll > 0.5) {
+            double limit = price * (1.0 + (roll - 0.5) * 0.2); // Up to 10% above the market
+            double amount = rng.uniform() * balance / limit;   // Random share of the balance
+            if (std::isfinite(limit) && limit > 0 && amount >= 1) {
+                return {static_cast<int>(std::min(amount, 1e9)), limit};
+            }
+        }
+        return {};
+    }
+};
+
+/**
+ * @struct BuyAndHold
+ * @brief Never sells; bids on a quarter of the candidates with a smaller share of the balance.
+ */
+struct BuyAndHold {
+    static OrderChoice ask(RandomStream&, double, double, double) noexcept { return {}; }
+
+    static OrderChoice bid(RandomStream& rng, double price, double balance) noexcept {
+        double roll = rng.uniform();
+        if (roll > 0.75) {
+            double limit = price * (1.0 + (roll - 0.75) * 0.2); // Up to 5% above the market
+            double amount = rng.uniform() * 0.25 * balance / limit;
+            if (std::isfinite(limit) && limit > 0 && amount >= 1) {
+                return {static_cast<int>(std::min(amount, 1e9)), limit};
+            }
+        }
+        return {};
+    }
+};
+
+/**
+ * @struct NoTrading
+ * @brief Stays out of the stock market.
+ */
+struct NoTrading {
+    static OrderChoice ask(RandomStream&, double, double, double) noexcept { return {}; }
+    static OrderChoice bid(RandomStream&, double, double) noexcept { return {}; }
+};
+
+// Purchasing policies
+
+/**
+ * @struct RandomBasket
+ * @brief Shops half of the ticks, taking up to 9 units of a random product from every candidate.
+ */
+struct RandomBasket {
+    static bool shops(double roll) noexcept { return roll > 0.5; }
+
+    static ProductChoice pick(RandomStream& rng, std::size_t products) noexcept {
+        std::size_t product = static_cast<std::size_t>(rng.uniform() * products);
+        int amount = static_cast<int>(rng.uniform() * 10);
+        return {product, amount};
+    }
+};
+
+/**
+ * @struct NoPurchases
+ * @brief Never buys products.
+ */
+struct NoPurchases {
+    static bool shops(double) noexcept { return false; }
+    static ProductChoice pick(RandomStream&, std::size_t) noexcept { return {}; }
+};
+
+// Formation policies, deciding on the same roll as the purchasing policy
+
+/**
+ * @struct Entrepreneur
+ * @brief Founds a business 30% of the ticks and sells one of its businesses 10% of the ticks.
+ */
+struct Entrepreneur {
+    static bool founds(double roll) noexcept { return roll > 0.7; }
+    static bool sells(double roll) noexcept { return roll > 0.9; }
+};
+
+/**
+ * @struct NoFormation
+ * @brief Never founds nor sells businesses.
+ */
+struct NoFormation {
+    static bool founds(double) noexcept { return false; }
+    static bool sells(double) noexcept { return false; }
+};
+
+/**
+ * @struct NpcStrategy
+ * @brief A complete NPC behavior, composed of one policy of every kind.
+ */
+template <class TradingPolicy, class PurchasingPolicy, class FormationPolicy> struct NpcStrategy {
+    using Trading = TradingPolicy;
+    using Purchasing = PurchasingPolicy;
+    using Formation = FormationPolicy;
+};
+
+/**
+ * @brief The strategies NPCs can follow.
+ */
+enum class StrategyId : std::uint8_t {
+    Speculator = 0, // Trades stocks for profit, shops and founds businesses; the original behavior
+    Investor = 1,   // Buys stocks and holds them, shops, founds nothing
+    Consumer = 2,   // Only shops
+    Count,
+};
+
+constexpr std::size_t STRATEGY_COUNT = static_cast<std::size_t>(StrategyId::Count);
+
+struct Speculator : NpcStrategy<ProfitTaking, RandomBasket, Entrepreneur> {};
+struct Investor : NpcStrategy<BuyAndHold, RandomBasket, NoFormation> {};
+struct Consumer : NpcStrategy<NoTrading, RandomBasket, NoFormation> {};
+
+/**
+ * @brief Call a generic visitor with a value of the strategy type of an ID.
+ * @param id The strategy; unknown IDs are visited as Speculator.
+ * @param visitor A callable taking any strategy type, e.g. [&](auto strategy) { ... decltype(strategy) ... }.
+ */
+template <class Visitor> decltype(auto) visitStrategy(StrategyId id, Visitor&& visitor) {
+    switch (id) {
+    case StrategyId::Investor:
+        return visitor(Investor{});
+    case StrategyId::Consumer:
+        return visitor(Consumer{});
+    default:
+        return visitor(Speculator{});
+    }
+}
+
+/**
+ * @brief Get the name of a strategy, as used by the options.
+ */
+const char* strategyName(StrategyId id) noexcept;
+
+/**
+ * @brief Look a strategy up by name.
+ * @return false if no strategy has the name.
+ */
+bool parseStrategy(const std::string& name, StrategyId& id) noexcept;
+
+/**
+ * @brief Parse a strategy mix: comma-separated name:weight pairs, e.g. speculator:3,consumer:1.
+ * A name without a weight counts once; strategies that are not named get no NPC.
+ * @param list The pairs.
+ * @param shares Set to the share of every strategy, summing to 1, if the list is valid.
+ * @return false if a name is unknown, a weight is invalid, or every weight is 0.
+ */
+bool parseStrategies(const std::string& list, std::array<double, STRATEGY_COUNT>& shares);
+
+/**
+ * @brief Get the strategy of an NPC from its creation number and the mix of strategies.
+ * The golden-ratio sequence spreads the strategies evenly over the NPC numbers, so every range of NPCs, and a ramp
+ * that adds them one by one, follows the mix closely.
+ * @param number The creation number of the NPC.
+ * @param shares The share of every strategy, summing to 1.
+ */
+StrategyId strategyFor(std::uint64_t number, const std::array<double, STRATEGY_COUNT>& shares) noexcept;
+
+#endif // NPC_STRATEGY_H
@@ -0,0 +1,124 @@
+#include "OrderBook.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace {
+constexpr std::int64_t UNLIMITED = std::numeric_limits<std::int64_t>::max() / 4; // Issuer supply at its ask quote
+} // namespace
+
+void OrderBook::submit(const StockOrder& order, std::uint64_t owner) {
+    Node node{order.limit, order.quantity, owner};
+    if (order.side == OrderSide::Bid) {
+        bids_.push_back(node);
+    } else {
+        asks_.push_back(node);
+    }
+}
+
+AuctionResult OrderBook::match(BusinessHandle business, double reference, double spread, std::int64_t issuerBid) {
+    reports_.clear();
+    AuctionResult result;
+
+    // Price-time priority: stable sorts keep the submission order within a price
+    std::stable_sort(bids_.begin(), bids_.end(), [](const Node& a, const Node& b) { return a.limit > b.limit; });
+    std::stable_sort(asks_.begin(), asks_.end(), [](const Node& a, const Node& b) { return a.limit < b.limit; });
+    Scratch& scratch = OrderBook::scratch();
+    std::vector<Level>& bidLevels = scratch.bidLevels;
+    std::vector<Level>& askLevels = scratch.askLevels;
+    std::vector<double>& candidates = scratch.candidates;
+    buildLevels(bids_, bidLevels);
+    buildLevels(asks_, askLevels);
+
+    double bidQuote = reference * (1.0 - spread); // Issuer buy-back price
+    double askQuote = reference * (1.0 + spread); // Issuer issuing price
+
+    // The clearing price is always inside the issuer band: outside of it the issuer takes every order
+    candidates.clear();
+    candidates.push_back(bidQuote);
+    candidates.push_back(askQuote);
+    for (const auto& level : bidLevels) {
+        if (level.price > bidQuote && level.price < askQuote) {
+            candidates.push_back(level.price);
+        }
+    }
+    for (const auto& level : askLevels) {
+        if (level.price > bidQuote && level.price < askQuote) {
+            candidates.push_back(level.price);
+        }
+    }
+
+    std::int64_t bestImbalance = 0;
+    for (double price : candidates) {
+        // Shares wanted at this price: bids priced at or above it
+        auto bidEnd = std::partition_point(bidLevels.begin(), bidLevels.end(),
+                                           [price](const Level& level) { return level.price >= price; });
+        std::int64_t demand = bidEnd == bidLevels.begin() ? 0 : (bidEnd - 1)->cumulated;
+        demand += price <= bidQuote ? issuerBid : 0;
+
+        // Shares offered at this price: asks priced at or below it
+        auto askEnd = std::partition_point(askLevels.begin(), askLevels.end(),
+                                           [price](const Level& level) { return level.price <= price; });
+        std::int64_t supply = askEnd == askLevels.begin() ? 0 : (askEnd - 1)->cumulated;
+        supply += price >= askQuote ? UNLIMITED : 0;
+
+        std::int64_t volume = std::min(demand, supply);
+        std::int64_t imbalance = std::max(demand, supply) - volume;
+        // Most volume first, then the smallest imbalance, then the price closest to the reference
+        bool closer = std::abs(price - reference) < std::abs(result.price - reference);
+        bool better = volume > result.volume ||
+                      (volume == result.volume && volume > 0 &&
+                       (imbalance < bestImbalance || (imbalance == bestImbalance && closer)));
+        if (better) {
+            result.volume = volume;
+            result.price = price;
+            bestImbalance = imbalance;
+        }
+    }
+
+    // NPC orders have priority over the issuer's quotes, the issuer takes what is left
+    std::int64_t bought = fill(business, bids_, OrderSide::Bid, result.volume, result.price);
+    std::int64_t sold = fill(business, asks_, OrderSide::Ask, result.volume, result.price);
+    result.repurchased = result.volume - bought;
+    result.issued = result.volume - sold;
+
+    bids_.clear(); // Orders only live for one auction
+    asks_.clear();
+    return result;
+}
+
+OrderBook::Scratch& OrderBook::scratch() {
+    thread_local Scratch scratch; // Books of one thread are matched one after the other
+    return scratch;
+}
+
+void OrderBook::buildLevels(const std::vector<Node>& nodes, std::vector<Level>& levels) {
+    levels.clear();
+    std::int64_t cumulated = 0;
+    for (const auto& node : nodes) {
+        cumulated += node.quantity;
+        if (levels.empty() || levels.back().price != node.limit) {
+            levels.push_back({node.limit, 0, 0}); // Nodes are sorted, so a new price starts a new level
+        }
+        levels.back().quantity += node.quantity;
+        levels.back().cumulated = cumulated;
+    }
+}
+
+std::int64_t OrderBook::fill(BusinessHandle business, const std::vector<Node>& nodes, OrderSide side,
+                             std::int64_t volume, double price) {
+    std::int64_t remaining = volume;
+    for (const auto& node : nodes) {
+        bool crosses = side == OrderSide::Bid ? node.limit >= price : node.limit <= price;
+        int filled = 0;
+        if (crosses && remaining > 0) {
+            filled = static_cast<int>(std::min<std::int64_t>(node.quantity, remaining));
+            remaining -= filled;
+        }
+        reports_.push_back({node.owner, business, side, node.quantity, filled, node.limit, price});
+    }
+    return volume - remaining;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#ifndef ORDER_BOOK_H
+#define ORDER_BOOK_H
+
+#include "Handle.h"
+#include "Intent.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @struct StockFill
+ * @brief Execution report of one order after an auction; every submitted order gets exactly one.
+ */
+struct StockFill {
+    std::uint64_t owner;     // Owner tag given when the order was submitted
+    BusinessHandle business; // Business whose shares were traded
+    OrderSide side;          // Buy or sell
+    int ordered;             // Shares in the order
+    int filled;              // Shares traded, 0 if the order did not execute
+    double limit;            // Limit of the order
+    double price;            // Clearing price the filled shares traded at
+};
+
+/**
+ * @struct AuctionResult
+ * @brief Outcome of a call auction.
+ */
+struct AuctionResult {
+    double price = 0.0;           // Clearing price, only meaningful if volume > 0
+    std::int64_t volume = 0;      // Shares traded
+    std::int64_t issued = 0;      // Shares sold by the issuer
+    std::int64_t repurchased = 0; // Shares bought back by the issuer
+};
+
+/**
+ * @class OrderBook
+ * @brief Limit order book of one business, cleared once per tick by a call auction.
+ *
+ * Orders are collected during the tick in flat node arrays and aggregated into price levels when the auction runs,
+ * so submitting is an append and matching works on contiguous sorted levels. The node and report arrays keep their
+ * capacity between auctions and the level arrays are per-thread scratch, so a warmed-up book does not allocate.
+ *
+ * The issuing business quotes around the reference price: it sells any number of new shares at
+ * reference * (1 + spread) and buys back a limited number at reference * (1 - spread). The clearing price is the
+ * price that trades the most shares, so order imbalance moves it within that band.
+ */
+class OrderBook {
+  public:
+    /**
+     * @brief Add an order to the next auction.
+     * @param order The order to add.
+     * @param owner Tag copied into the execution report of the order.
+     */
+    void submit(const StockOrder& order, std::uint64_t owner);
+
+    std::size_t size() const noexcept { return bids_.size() + asks_.size(); } // Orders waiting for the auction
+
+    /**
+     * @brief Match every submitted order at a single clearing price and empty the book.
+     * @param business The business the book belongs to, copied into the reports.
+     * @param reference The price the issuer quotes around.
+     * @param spread The relative distance of the issuer quotes from the reference price.
+     * @param issuerBid The number of shares the issuer is willing to buy back.
+     * @return The clearing price and the traded volumes.
+     */
+    AuctionResult match(BusinessHandle business, double reference, double spread, std::int64_t issuerBid);
+
+    /**
+     * @brief Get the execution reports of the last auction.
+     */
+    std::span<const StockFill> reports() const noexcept { return reports_; }
+
+  private:
+    struct Node {
+        double limit;        // Limit price of the order
+        int quantity;        // Shares in the order
+        std::uint64_t owner; // Owner tag of the order
+    };
+
+    struct Level {
+        double price;           // Limit price shared by the orders of the level
+        std::int64_t quantity;  // Total shares of the level
+        std::int64_t cumulated; // Shares of this level and of every level priced more aggressively
+    };
+
+    // Arrays only needed while an auction runs, shared by the books of a thread instead of held by every book
+    struct Scratch {
+        std::vector<Level> bidLevels;   // Bid levels, best (highest) price first
+        std::vector<Level> askLevels;   // Ask levels, best (lowest) price first
+        std::vector<double> candidates; // Prices tried as clearing price
+    };
+
+    static Scratch& scratch(); // Scratch of the calling thread
+    static void buildLevels(const std::vector<Node>& nodes, std::vector<Level>& levels);
+    std::int64_t fill(BusinessHandle business, const std::vector<Node>& nodes, OrderSide side, std::int64_t volume,
+                      double price); // Fill the nodes in priority order, return the shares they took
+
+    std::vector<Node> bids_;         // Bids in submission order until the auction sorts them
+    std::vector<Node> asks_;         // Asks in submission order until the auction sorts them
+    std::vector<StockFill> reports_; // Execution reports of the last auction
+};
+
+#endif // ORDER_BOOK_H
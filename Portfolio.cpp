@@ -0,0 +1,59 @@
+#include "Portfolio.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+// Slot first, then generation: a stale holding and one of the business now living in its slot can coexist
+std::uint64_t slotOrder(BusinessHandle business) noexcept {
+    return (static_cast<std::uint64_t>(business.index) << 32) | business.generation;
+}
+
+bool bySlot(const Holding& a, const Holding& b) noexcept {
+    return slotOrder(a.business) < slotOrder(b.business);
+}
+
+} // namespace
+
+Holding* Portfolio::find(BusinessHandle business) noexcept {
+    return const_cast<Holding*>(static_cast<const Portfolio*>(this)->find(business));
+}
+
+const Holding* Portfolio::find(BusinessHandle business) const noexcept {
+    auto end = holdings_.begin() + sorted_;
+    auto before = [](const Holding& holding, std::uint64_t key) { return slotOrder(holding.business) < key; };
+    auto it = std::lower_bound(holdings_.begin(), end, slotOrder(business), before);
+    if (it != end && it->business == business) {
+        return &*it;
+    }
+    for (auto added = end; added != holdings_.end(); ++added) {
+        if (added->business == business) {
+            return &*added; // Inserted since the last compact(), a handful at most
+        }
+    }
+    return nullptr;
+}
+
+Holding& Portfolio::insert(BusinessHandle business) {
+    if (Holding* holding = find(business)) {
+        return *holding;
+    }
+    return holdings_.emplace_back(Holding{business});
+}
+
+void Portfolio::compact() {
+    auto middle = holdings_.begin() + sorted_;
+    if (middle != holdings_.end()) {
+        std::sort(middle, holdings_.end(), bySlot);
+        std::inplace_merge(holdings_.begin(), middle, holdings_.end(), bySlot);
+    }
+    std::erase_if(holdings_, [](const Holding& holding) { return holding.shares == 0; });
+    sorted_ = holdings_.size();
+}
+
+void Portfolio::assign(std::span<const Holding> holdings) {
+    holdings_.assign(holdings.begin(), holdings.end());
+    sorted_ = 0;
+    compact();
+}
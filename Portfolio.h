@@ -0,0 +1,69 @@
+#pragma once
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+
+#include "Handle.h"
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+/**
+ * @struct Holding
+ * @brief Shares of one business held by an NPC.
+ */
+struct Holding {
+    BusinessHandle business;
+    double shares = 0;    // Shares held, without those reserved by pending asks
+    double costBasis = 0; // Price the last shares were bought at
+};
+
+/**
+ * @class Portfolio
+ * @brief Stock holdings of an NPC in one flat array, sorted by business slot.
+ *
+ * Evaluating the whole portfolio is a linear scan and a lookup is a binary search; nothing is hashed. Holdings
+ * created by insert() are appended behind the sorted range and merged into it by compact(), so settling a tick of
+ * fills costs one merge instead of shifting the array for every new position.
+ *
+ * A holding can drop to zero shares while asks reserve them: it keeps its cost basis for the unsold shares that
+ * come back, and the next compact() drops it.
+ */
+class Portfolio {
+  public:
+    std::span<Holding> holdings() noexcept { return holdings_; } // Sorted by business slot after compact()
+    std::span<const Holding> holdings() const noexcept { return holdings_; }
+    std::size_t size() const noexcept { return holdings_.size(); }
+    bool empty() const noexcept { return holdings_.empty(); }
+    void reserve(std::size_t count) { holdings_.reserve(count); }
+
+    /**
+     * @brief Find the holding of a business.
+     * @return The holding, possibly with zero shares, or nullptr if the portfolio has none.
+     */
+    Holding* find(BusinessHandle business) noexcept;
+    const Holding* find(BusinessHandle business) const noexcept;
+
+    /**
+     * @brief Get the holding of a business, adding an empty one if the portfolio has none.
+     * The reference is valid until the next insert() or compact().
+     */
+    Holding& insert(BusinessHandle business);
+
+    /**
+     * @brief Merge the holdings added since the last call into the sorted range and drop the empty ones.
+     * Only call it when no ask is pending, an empty holding may be waiting for unsold shares.
+     */
+    void compact();
+
+    /**
+     * @brief Replace every holding, e.g. with the holdings saved in a snapshot.
+     */
+    void assign(std::span<const Holding> holdings);
+
+  private:
+    std::vector<Holding> holdings_; // Sorted range, then the holdings inserted since the last compact()
+    std::size_t sorted_ = 0;        // Length of the sorted range
+};
+
+#endif // PORTFOLIO_H
@@ -0,0 +1,38 @@
+#include "ProductCatalog.h"
+
+#include <mutex>
+#include <string>
+#include <string_view>
+
+ProductCatalog& ProductCatalog::global() {
+    static ProductCatalog catalog; // Shared by every business of the process
+    return catalog;
+}
+
+ProductId ProductCatalog::intern(std::string_view name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = ids_.find(name);
+    if (it != ids_.end()) {
+        return it->second; // Already interned
+    }
+    ProductId id = static_cast<ProductId>(names_.size());
+    names_.emplace_back(name);
+    ids_.emplace(names_.back(), id); // Key on the stored copy, not on the caller's buffer
+    return id;
+}
+
+ProductId ProductCatalog::find(std::string_view name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = ids_.find(name);
+    return it != ids_.end() ? it->second : INVALID_PRODUCT;
+}
+
+const std::string& ProductCatalog::name(ProductId id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return names_.at(id);
+}
+
+std::size_t ProductCatalog::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return names_.size();
+}
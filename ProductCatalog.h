@@ -0,0 +1,59 @@
+#pragma once
+#ifndef PRODUCT_CATALOG_H
+#define PRODUCT_CATALOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using ProductId = std::uint32_t; // Compact identifier of an interned product name
+
+constexpr ProductId INVALID_PRODUCT = static_cast<ProductId>(-1); // Identifier of a product that was never interned
+
+/**
+ * @class ProductCatalog
+ * @brief Registry interning product names into ProductIds.
+ * Names are interned once when products are created; every hot path afterwards works on the integer IDs and
+ * only goes back to the name for display.
+ */
+class ProductCatalog {
+  public:
+    /**
+     * @brief Get the catalog shared by the whole simulation.
+     */
+    static ProductCatalog& global();
+
+    /**
+     * @brief Get the ID of a product, registering the name if it is new.
+     * @param name The name of the product.
+     * @return The ID of the product.
+     */
+    ProductId intern(std::string_view name);
+
+    /**
+     * @brief Get the ID of a product without registering it.
+     * @param name The name of the product.
+     * @return The ID of the product, or INVALID_PRODUCT if the name was never interned.
+     */
+    ProductId find(std::string_view name) const;
+
+    /**
+     * @brief Get the name of an interned product.
+     * @param id The ID of the product.
+     * @return The name the product was interned with.
+     */
+    const std::string& name(ProductId id) const;
+
+    std::size_t size() const; // Number of interned products
+
+  private:
+    mutable std::mutex mutex_;
+    std::deque<std::string> names_;                       // Interned names by ID, a deque keeps them in place
+    std::unordered_map<std::string_view, ProductId> ids_; // Name to ID, the views point into names_
+};
+
+#endif // PRODUCT_CATALOG_H
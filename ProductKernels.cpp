@@ -0,0 +1,159 @@
+#include "ProductKernels.h"
+
+#include <cstddef>
+
+// Vector kernels are built for x86 with GCC and Clang, which compile them for their instruction set only and pick
+// one at run time, and with MSVC when the build itself targets AVX2 or AVX-512
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PRODUCT_KERNELS_AVX2 1
+#define PRODUCT_KERNELS_AVX512 1
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#if defined(__AVX2__)
+#define PRODUCT_KERNELS_AVX2 1
+#endif
+#if defined(__AVX512F__)
+#define PRODUCT_KERNELS_AVX512 1
+#endif
+#define TARGET_AVX2
+#define TARGET_AVX512
+#endif
+
+#if defined(PRODUCT_KERNELS_AVX2) || defined(PRODUCT_KERNELS_AVX512)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+void updateScalar(const ProductUpdateRows& rows, std::size_t begin) {
+    for (std::size_t i = begin; i < rows.count; ++i) {
+        double factor = rows.factors[i];
+        rows.demand[i] += factor * rows.demand[i];
+        if (rows.supply[i] > 0) {
+            rows.prices[i] += (rows.demand[i] - rows.supply[i]) * 0.1;
+        }
+        rows.supply[i] += static_cast<int>(rows.resupplyRates[i] * factor);
+    }
+}
+
+#if defined(PRODUCT_KERNELS_AVX2)
+TARGET_AVX2 void updateAvx2(const ProductUpdateRows& rows) {
+    const __m256d tenth = _mm256_set1_pd(0.1);
+    const __m128i zero = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 4 <= rows.count; i += 4) {
+        __m256d factor = _mm256_loadu_pd(rows.factors + i);
+        __m256d demand = _mm256_loadu_pd(rows.demand + i);
+        demand = _mm256_add_pd(demand, _mm256_mul_pd(factor, demand));
+        _mm256_storeu_pd(rows.demand + i, demand);
+
+        __m128i supply = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows.supply + i));
+        __m128i inStock = _mm_cmpgt_epi32(supply, zero); // All ones where supply > 0
+        __m256d stocked = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(inStock));
+        __m256d price = _mm256_loadu_pd(rows.prices + i);
+        __m256d excess = _mm256_sub_pd(demand, _mm256_cvtepi32_pd(supply));
+        __m256d nudged = _mm256_add_pd(price, _mm256_mul_pd(excess, tenth));
+        _mm256_storeu_pd(rows.prices + i, _mm256_blendv_pd(price, nudged, stocked));
+
+        // Truncates like static_cast<int>, out-of-range values become INT_MIN in both
+        __m128i restock = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_loadu_pd(rows.resupplyRates + i), factor));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rows.supply + i), _mm_add_epi32(supply, restock));
+    }
+    updateScalar(rows, i); // Rows past the last full vector
+}
+#endif
+
+#if defined(PRODUCT_KERNELS_AVX512)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized" // Raised by the placeholder operand of the conversions
+#endif
+TARGET_AVX512 void updateAvx512(const ProductUpdateRows& rows) {
+    const __m512d tenth = _mm512_set1_pd(0.1);
+    const __m512d zero = _mm512_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 8 <= rows.count; i += 8) {
+        __m512d factor = _mm512_loadu_pd(rows.factors + i);
+        __m512d demand = _mm512_loadu_pd(rows.demand + i);
+        demand = _mm512_add_pd(demand, _mm512_mul_pd(factor, demand));
+        _mm512_storeu_pd(rows.demand + i, demand);
+
+        __m256i supply = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows.supply + i));
+        __m512d units = _mm512_cvtepi32_pd(supply); // Exact, so units > 0 exactly when supply > 0
+        __mmask8 stocked = _mm512_cmp_pd_mask(units, zero, _CMP_GT_OQ);
+        __m512d price = _mm512_loadu_pd(rows.prices + i);
+        price = _mm512_mask_add_pd(price, stocked, price, _mm512_mul_pd(_mm512_sub_pd(demand, units), tenth));
+        _mm512_storeu_pd(rows.prices + i, price);
+
+        __m256i restock = _mm512_cvttpd_epi32(_mm512_mul_pd(_mm512_loadu_pd(rows.resupplyRates + i), factor));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(rows.supply + i), _mm256_add_epi32(supply, restock));
+    }
+    updateScalar(rows, i); // Rows past the last full vector
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+} // namespace
+
+bool simdSupported(SimdLevel level) noexcept {
+    switch (level) {
+    case SimdLevel::Scalar:
+        return true;
+    case SimdLevel::Avx2:
+#if defined(PRODUCT_KERNELS_AVX2) && defined(__GNUC__)
+        return __builtin_cpu_supports("avx2");
+#elif defined(PRODUCT_KERNELS_AVX2)
+        return true; // The build targets AVX2, so does every CPU it runs on
+#else
+        return false;
+#endif
+    case SimdLevel::Avx512:
+#if defined(PRODUCT_KERNELS_AVX512) && defined(__GNUC__)
+        return __builtin_cpu_supports("avx512f");
+#elif defined(PRODUCT_KERNELS_AVX512)
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+SimdLevel bestSimdLevel() noexcept {
+    static const SimdLevel best = simdSupported(SimdLevel::Avx512) ? SimdLevel::Avx512
+                                  : simdSupported(SimdLevel::Avx2) ? SimdLevel::Avx2
+                                                                   : SimdLevel::Scalar;
+    return best;
+}
+
+const char* simdName(SimdLevel level) noexcept {
+    switch (level) {
+    case SimdLevel::Avx2:
+        return "avx2";
+    case SimdLevel::Avx512:
+        return "avx512";
+    default:
+        return "scalar";
+    }
+}
+
+void updateProductRows(const ProductUpdateRows& rows, SimdLevel level) {
+    switch (level) {
+#if defined(PRODUCT_KERNELS_AVX512)
+    case SimdLevel::Avx512:
+        updateAvx512(rows);
+        return;
+#endif
+#if defined(PRODUCT_KERNELS_AVX2)
+    case SimdLevel::Avx2:
+        updateAvx2(rows);
+        return;
+#endif
+    default:
+        updateScalar(rows, 0);
+        return;
+    }
+}
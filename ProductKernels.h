@@ -0,0 +1,51 @@
+#pragma once
+#ifndef PRODUCT_KERNELS_H
+#define PRODUCT_KERNELS_H
+
+#include <cstddef>
+
+/**
+ * @brief Instruction sets the product kernels are written for.
+ */
+enum class SimdLevel {
+    Scalar, // Portable loop, always available
+    Avx2,   // 4 rows per step
+    Avx512, // 8 rows per step
+};
+
+/**
+ * @brief Get the widest instruction set supported by both the build and the running CPU.
+ */
+SimdLevel bestSimdLevel() noexcept;
+
+/**
+ * @brief Check whether the build and the running CPU support an instruction set.
+ */
+bool simdSupported(SimdLevel level) noexcept;
+
+const char* simdName(SimdLevel level) noexcept; // Lower-case name, for reports
+
+/**
+ * @struct ProductUpdateRows
+ * @brief Column pointers over a run of product rows, with the random factor of every row.
+ */
+struct ProductUpdateRows {
+    double* prices;
+    int* supply;
+    double* demand;
+    const double* resupplyRates;
+    const double* factors; // Random factor of the business owning each row
+    std::size_t count;
+};
+
+/**
+ * @brief Product half of the business update cycle over a run of rows.
+ * Every row gets exactly the arithmetic of Business::updateProducts(): demand scaled by the factor, price nudged by
+ * a tenth of the excess demand when the product is in stock, then supply restocked. The vector kernels use the same
+ * operations in the same order, without fused multiply-adds, so every level gives bit-identical results.
+ * @param rows The rows to update.
+ * @param level The instruction set to use; it must be supported.
+ */
+void updateProductRows(const ProductUpdateRows& rows, SimdLevel level);
+
+#endif // PRODUCT_KERNELS_H
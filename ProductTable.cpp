@@ -0,0 +1,177 @@
+#include "ProductTable.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+ProductTable& ProductTable::market() {
+    static ProductTable table; // Shared by every business of the process
+    return table;
+}
+
+ProductTable::Slot ProductTable::allocateSlot() {
+    if (!freeSlots_.empty()) {
+        Slot slot = freeSlots_.back(); // Reuse a released slot, its empty block still sits at a valid offset
+        freeSlots_.pop_back();
+        return slot;
+    }
+    offsets_.push_back(rows()); // New blocks start at the end of the table
+    counts_.push_back(0);
+    return static_cast<Slot>(offsets_.size() - 1);
+}
+
+ProductTable::Slot ProductTable::cloneSlot(Slot source) {
+    Slot slot = allocateSlot();
+    for (std::size_t i = 0; i < counts_[source]; ++i) {
+        std::size_t row = offsets_[source] + i; // Re-read every iteration, inserting may move the source block
+        double initialPrice = initialPrices_[row]; // Read before inserting, the columns may reallocate
+        std::size_t inserted =
+            insert(slot, products_[row], prices_[row], supply_[row], demand_[row], resupplyRates_[row]);
+        initialPrices_[inserted] = initialPrice;
+    }
+    return slot;
+}
+
+void ProductTable::releaseSlot(Slot slot) {
+    std::size_t first = offsets_[slot];
+    std::size_t last = first + counts_[slot];
+
+    products_.erase(products_.begin() + first, products_.begin() + last);
+    prices_.erase(prices_.begin() + first, prices_.begin() + last);
+    initialPrices_.erase(initialPrices_.begin() + first, initialPrices_.begin() + last);
+    supply_.erase(supply_.begin() + first, supply_.begin() + last);
+    demand_.erase(demand_.begin() + first, demand_.begin() + last);
+    resupplyRates_.erase(resupplyRates_.begin() + first, resupplyRates_.begin() + last);
+
+    shiftOffsets(slot, -static_cast<std::ptrdiff_t>(counts_[slot])); // Close the gap left by the block
+    counts_[slot] = 0;
+    freeSlots_.push_back(slot);
+}
+
+std::size_t ProductTable::find(Slot slot, ProductId product) const {
+    std::size_t first = offsets_[slot];
+    std::size_t last = first + counts_[slot];
+    for (std::size_t row = first; row < last; ++row) {
+        if (products_[row] == product) {
+            return row; // Blocks are small, a linear scan over IDs beats hashing here
+        }
+    }
+    return NPOS;
+}
+
+void ProductTable::reserve(std::size_t slots, std::size_t rows) {
+    offsets_.reserve(offsets_.size() + slots);
+    counts_.reserve(counts_.size() + slots);
+    products_.reserve(products_.size() + rows);
+    prices_.reserve(prices_.size() + rows);
+    initialPrices_.reserve(initialPrices_.size() + rows);
+    supply_.reserve(supply_.size() + rows);
+    demand_.reserve(demand_.size() + rows);
+    resupplyRates_.reserve(resupplyRates_.size() + rows);
+}
+
+std::size_t ProductTable::insert(Slot slot, ProductId product, double price, int supply, double demand,
+                                 double resupplyRate) {
+    std::size_t row = offsets_[slot] + counts_[slot]; // Append at the end of the business's block
+
+    products_.insert(products_.begin() + row, product);
+    prices_.insert(prices_.begin() + row, price);
+    initialPrices_.insert(initialPrices_.begin() + row, price);
+    supply_.insert(supply_.begin() + row, supply);
+    demand_.insert(demand_.begin() + row, demand);
+    resupplyRates_.insert(resupplyRates_.begin() + row, resupplyRate);
+
+    ++counts_[slot];
+    shiftOffsets(slot, 1);
+    return row;
+}
+
+void ProductTable::insert(Slot slot, const ProductRows& rows) {
+    std::size_t row = offsets_[slot] + counts_[slot]; // Append at the end of the business's block
+    std::size_t count = rows.products.size();
+
+    products_.insert(products_.begin() + row, rows.products.begin(), rows.products.end());
+    prices_.insert(prices_.begin() + row, rows.prices.begin(), rows.prices.end());
+    initialPrices_.insert(initialPrices_.begin() + row, rows.initialPrices.begin(), rows.initialPrices.end());
+    supply_.insert(supply_.begin() + row, rows.supply.begin(), rows.supply.end());
+    demand_.insert(demand_.begin() + row, rows.demand.begin(), rows.demand.end());
+    resupplyRates_.insert(resupplyRates_.begin() + row, rows.resupplyRates.begin(), rows.resupplyRates.end());
+
+    counts_[slot] += count;
+    shiftOffsets(slot, static_cast<std::ptrdiff_t>(count));
+}
+
+void ProductTable::releaseSlots(std::span<const Slot> slots) {
+    std::vector<bool> released(offsets_.size(), false);
+    for (Slot slot : slots) {
+        released[slot] = true;
+    }
+
+    // Blocks are ordered by slot, so walking the slots moves every kept block forward at most once
+    std::size_t write = 0;
+    for (Slot slot = 0; slot < offsets_.size(); ++slot) {
+        std::size_t count = released[slot] ? 0 : counts_[slot];
+        if (count != 0 && offsets_[slot] != write) {
+            moveRows(products_, offsets_[slot], write, count);
+            moveRows(prices_, offsets_[slot], write, count);
+            moveRows(initialPrices_, offsets_[slot], write, count);
+            moveRows(supply_, offsets_[slot], write, count);
+            moveRows(demand_, offsets_[slot], write, count);
+            moveRows(resupplyRates_, offsets_[slot], write, count);
+        }
+        offsets_[slot] = write;
+        counts_[slot] = count;
+        write += count;
+    }
+
+    products_.resize(write);
+    prices_.resize(write);
+    initialPrices_.resize(write);
+    supply_.resize(write);
+    demand_.resize(write);
+    resupplyRates_.resize(write);
+    freeSlots_.insert(freeSlots_.end(), slots.begin(), slots.end());
+}
+
+template <class T>
+void ProductTable::moveRows(std::vector<T>& column, std::size_t from, std::size_t to, std::size_t count) {
+    std::copy(column.begin() + from, column.begin() + from + count, column.begin() + to); // to < from
+}
+
+void ProductTable::erase(Slot slot, std::size_t row) {
+    products_.erase(products_.begin() + row);
+    prices_.erase(prices_.begin() + row);
+    initialPrices_.erase(initialPrices_.begin() + row);
+    supply_.erase(supply_.begin() + row);
+    demand_.erase(demand_.begin() + row);
+    resupplyRates_.erase(resupplyRates_.begin() + row);
+
+    --counts_[slot];
+    shiftOffsets(slot, -1);
+}
+
+void ProductTable::shiftOffsets(Slot slot, std::ptrdiff_t delta) {
+    for (std::size_t s = slot + 1; s < offsets_.size(); ++s) {
+        offsets_[s] += delta; // Blocks are ordered by slot, so only later slots move
+    }
+}
+
+void ProductTable::update(std::span<const double> factors, Slot begin, Slot end, SimdLevel level) {
+    thread_local std::vector<double> rowFactors; // Factor of every row of a run, reused between calls
+    Slot slot = begin;
+    while (slot < end) {
+        if (std::isnan(factors[slot])) {
+            ++slot; // Not updated by this call
+            continue;
+        }
+        // Gather the longest run of slots to update, their blocks follow each other in the columns
+        std::size_t first = offsets_[slot];
+        rowFactors.clear();
+        for (; slot < end && !std::isnan(factors[slot]); ++slot) {
+            rowFactors.insert(rowFactors.end(), counts_[slot], factors[slot]);
+        }
+        updateProductRows({prices_.data() + first, supply_.data() + first, demand_.data() + first,
+                           resupplyRates_.data() + first, rowFactors.data(), rowFactors.size()},
+                          level);
+    }
+}
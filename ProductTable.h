@@ -0,0 +1,137 @@
+#pragma once
+#ifndef PRODUCT_TABLE_H
+#define PRODUCT_TABLE_H
+
+#include "ProductCatalog.h"
+#include "ProductKernels.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+/**
+ * @struct ProductRows
+ * @brief Column views over a run of product rows, used to copy rows in bulk.
+ */
+struct ProductRows {
+    std::span<const ProductId> products;
+    std::span<const double> prices;
+    std::span<const double> initialPrices;
+    std::span<const int> supply;
+    std::span<const double> demand;
+    std::span<const double> resupplyRates;
+};
+
+/**
+ * @class ProductTable
+ * @brief Market-wide struct-of-arrays store for the products of every business.
+ *
+ * Every (business, product) pair is one row, and each column (price, supply, demand, ...) is a dense array.
+ * Rows of one business are contiguous and the blocks are laid out in slot order, so a business only needs its
+ * slot to find its [offset, offset + count) range. Inserting or erasing a row shifts the rows behind it, which
+ * keeps the table compact; those operations are rare compared to the per-tick column sweeps.
+ */
+class ProductTable {
+  public:
+    using Slot = std::uint32_t;
+
+    static constexpr Slot NO_SLOT = static_cast<Slot>(-1);            // Slot of a business that owns no block
+    static constexpr std::size_t NPOS = static_cast<std::size_t>(-1); // Returned by find() for a missing product
+    static constexpr double SKIP = std::numeric_limits<double>::quiet_NaN(); // Factor of a block update() skips
+
+    /**
+     * @brief Get the table shared by every business of the running market.
+     */
+    static ProductTable& market();
+
+    Slot allocateSlot();         // Reserve an empty block for a new business
+    Slot cloneSlot(Slot source); // Reserve a block holding a copy of another business's rows
+    void releaseSlot(Slot slot); // Remove every row of a business and recycle its slot
+
+    /**
+     * @brief Make room for a number of blocks and rows on top of the existing ones, so bulk loads do not reallocate.
+     */
+    void reserve(std::size_t slots, std::size_t rows);
+
+    /**
+     * @brief Release many slots at once, compacting the table in a single pass instead of once per slot.
+     */
+    void releaseSlots(std::span<const Slot> slots);
+
+    std::size_t offset(Slot slot) const noexcept { return offsets_[slot]; } // First row of a business
+    std::size_t count(Slot slot) const noexcept { return counts_[slot]; }   // Number of rows of a business
+    std::size_t rows() const noexcept { return prices_.size(); }            // Number of rows in the market
+    std::size_t slots() const noexcept { return offsets_.size(); }          // Number of slots ever allocated
+
+    /**
+     * @brief Find the row of a product within the block of a business.
+     * @return The absolute row index, or NPOS if the business does not offer the product.
+     */
+    std::size_t find(Slot slot, ProductId product) const;
+
+    /**
+     * @brief Append a row at the end of the block of a business.
+     * @return The absolute row index of the new product.
+     */
+    std::size_t insert(Slot slot, ProductId product, double price, int supply, double demand, double resupplyRate);
+
+    /**
+     * @brief Append a run of rows at the end of the block of a business; every column must hold the same count.
+     */
+    void insert(Slot slot, const ProductRows& rows);
+
+    /**
+     * @brief Erase a row from the block of a business, shifting the rows behind it.
+     */
+    void erase(Slot slot, std::size_t row);
+
+    /**
+     * @brief Run the product half of the business update over the blocks of a range of slots in one sweep.
+     * Blocks are contiguous in slot order, so the range is a single run of rows for the vector kernel.
+     * @param factors The random factor of every slot, or SKIP for blocks to leave alone.
+     * @param begin The first slot of the range.
+     * @param end One past the last slot of the range.
+     * @param level The instruction set of the kernel.
+     */
+    void update(std::span<const double> factors, Slot begin, Slot end, SimdLevel level);
+
+    // Per-business views over the dense columns
+    std::span<const ProductId> products(Slot slot) const noexcept { return block(products_, slot); }
+    std::span<double> prices(Slot slot) noexcept { return block(prices_, slot); }
+    std::span<const double> prices(Slot slot) const noexcept { return block(prices_, slot); }
+    std::span<const double> initialPrices(Slot slot) const noexcept { return block(initialPrices_, slot); }
+    std::span<int> supply(Slot slot) noexcept { return block(supply_, slot); }
+    std::span<const int> supply(Slot slot) const noexcept { return block(supply_, slot); }
+    std::span<double> demand(Slot slot) noexcept { return block(demand_, slot); }
+    std::span<const double> demand(Slot slot) const noexcept { return block(demand_, slot); }
+    std::span<const double> resupplyRates(Slot slot) const noexcept { return block(resupplyRates_, slot); }
+
+  private:
+    template <class T> void moveRows(std::vector<T>& column, std::size_t from, std::size_t to, std::size_t count);
+    void shiftOffsets(Slot slot, std::ptrdiff_t delta); // Move the blocks of every slot after `slot`
+
+    template <class T> std::span<T> block(std::vector<T>& column, Slot slot) noexcept {
+        return {column.data() + offsets_[slot], counts_[slot]};
+    }
+
+    template <class T> std::span<const T> block(const std::vector<T>& column, Slot slot) const noexcept {
+        return {column.data() + offsets_[slot], counts_[slot]};
+    }
+
+    // Block bookkeeping, indexed by slot
+    std::vector<std::size_t> offsets_; // First row of each slot
+    std::vector<std::size_t> counts_;  // Number of rows of each slot
+    std::vector<Slot> freeSlots_;      // Released slots waiting to be reused
+
+    // Dense columns, indexed by row
+    std::vector<ProductId> products_;   // Interned product names
+    std::vector<double> prices_;        // Current product prices
+    std::vector<double> initialPrices_; // Product prices at the time they were added
+    std::vector<int> supply_;           // Units in stock
+    std::vector<double> demand_;        // Product demand
+    std::vector<double> resupplyRates_; // Units restocked per tick, scaled by the random factor
+};
+
+#endif // PRODUCT_TABLE_H
@@ -0,0 +1,95 @@
+#include "QueryService.h"
+#include "World.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+QueryService::~QueryService() {
+    if (builder_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        captured_.notify_all();
+        builder_.join();
+    }
+    delete current_.load(); // No reader is left, retired and spare views free themselves
+}
+
+void QueryService::publish(const World& world, std::uint64_t tick) {
+    std::unique_ptr<WorldView> view;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!builder_.joinable()) {
+            builder_ = std::thread(&QueryService::builderLoop, this); // Started by the first capture
+        }
+        if (pending_ != nullptr) {
+            view = std::move(pending_); // The builder is behind: overwrite the capture it did not take yet
+        } else if (!spare_.empty()) {
+            view = std::move(spare_.back());
+            spare_.pop_back();
+        }
+    }
+    if (view == nullptr) {
+        view = std::make_unique<WorldView>();
+    }
+
+    view->capture(world, tick); // Outside the lock, the builder keeps running meanwhile
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = std::move(view);
+    }
+    captured_.notify_one();
+}
+
+QueryService::View QueryService::read() const noexcept {
+    EpochDomain::Guard guard = epochs_.pin();
+    const WorldView* view = current_.load(); // After the pin: the builder cannot reclaim it while the guard lives
+    return View(std::move(guard), view);
+}
+
+void QueryService::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    built_.wait(lock, [&] { return pending_ == nullptr && !building_; });
+}
+
+void QueryService::builderLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        captured_.wait(lock, [&] { return pending_ != nullptr || stopping_; });
+        if (pending_ == nullptr) {
+            break; // Stopping and every capture was published
+        }
+        std::unique_ptr<WorldView> view = std::move(pending_);
+        building_ = true;
+        lock.unlock();
+
+        view->index();
+        const WorldView* replaced = current_.exchange(view.release());
+        std::uint64_t epoch = epochs_.retire(); // Readers that pin from now on see the new view
+        if (replaced != nullptr) {
+            retired_.push_back({std::unique_ptr<WorldView>(const_cast<WorldView*>(replaced)), epoch});
+        }
+
+        lock.lock();
+        reclaim();
+        building_ = false;
+        built_.notify_all();
+    }
+}
+
+void QueryService::reclaim() {
+    auto reusable = std::stable_partition(retired_.begin(), retired_.end(), [&](const Retired& retired) {
+        return !epochs_.safe(retired.epoch);
+    });
+    for (auto it = reusable; it != retired_.end(); ++it) {
+        spare_.push_back(std::move(it->view));
+    }
+    retired_.erase(reusable, retired_.end());
+}
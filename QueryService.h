@@ -0,0 +1,102 @@
+#pragma once
+#ifndef QUERY_SERVICE_H
+#define QUERY_SERVICE_H
+
+#include "Epoch.h"
+#include "WorldView.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class World;
+
+/**
+ * @class QueryService
+ * @brief Serves read-only queries on the running simulation from any thread, without locks.
+ *
+ * At a tick boundary the tick loop calls publish(), which copies the market into a WorldView and hands it to a
+ * background thread. The thread builds the indexes of the view and swaps it in as the current view; the tick loop
+ * never waits for it. If the thread falls behind, it skips to the latest captured tick, since queries only want
+ * the latest state.
+ *
+ * Readers call read(), which pins an epoch (EpochDomain) and returns the current view. A view stays valid while its
+ * View is alive, even after newer views are published; replaced views are reused for later captures once no reader
+ * can still see them. Readers must not outlive the service.
+ */
+class QueryService {
+  public:
+    /**
+     * @class View
+     * @brief The view current when read() was called, kept alive while the View lives. Empty before the first
+     * published view.
+     */
+    class View {
+      public:
+        View() = default;
+
+        explicit operator bool() const noexcept { return view_ != nullptr; }
+        const WorldView& operator*() const noexcept { return *view_; }
+        const WorldView* operator->() const noexcept { return view_; }
+
+      private:
+        friend class QueryService;
+        View(EpochDomain::Guard guard, const WorldView* view) noexcept : guard_(std::move(guard)), view_(view) {}
+
+        EpochDomain::Guard guard_;
+        const WorldView* view_ = nullptr;
+    };
+
+    QueryService() = default;
+    ~QueryService();
+
+    QueryService(const QueryService&) = delete;
+    QueryService& operator=(const QueryService&) = delete;
+
+    /**
+     * @brief Capture the market for the readers; called by the tick loop.
+     * @param world The world, at a tick boundary.
+     * @param tick The tick that just ran.
+     */
+    void publish(const World& world, std::uint64_t tick);
+
+    /**
+     * @brief Get the current view; callable from any thread.
+     */
+    View read() const noexcept;
+
+    /**
+     * @brief Wait until the last captured tick is the current view.
+     */
+    void flush();
+
+  private:
+    void builderLoop(); // Body of the builder thread
+    void reclaim();     // Move the retired views no reader can see to spare_
+
+    std::atomic<const WorldView*> current_{nullptr}; // Owned by the service
+    mutable EpochDomain epochs_;
+    std::thread builder_;
+
+    std::mutex mutex_;                               // Guards pending_, spare_, building_ and stopping_
+    std::condition_variable captured_;               // Signals the builder that a view was captured or it stops
+    std::condition_variable built_;                  // Signals flush() that the builder went idle
+    std::unique_ptr<WorldView> pending_;             // Latest captured view, waiting for the builder
+    std::vector<std::unique_ptr<WorldView>> spare_;  // Views ready to be reused
+    bool building_ = false;                          // Whether the builder holds a view it has not published yet
+    bool stopping_ = false;
+
+    // Owned by the builder thread
+    struct Retired {
+        std::unique_ptr<WorldView> view;
+        std::uint64_t epoch; // Epoch the view was replaced in
+    };
+    std::vector<Retired> retired_;
+};
+
+#endif // QUERY_SERVICE_H
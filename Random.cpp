@@ -0,0 +1,6 @@
+#include "Random.h"
+
+RandomService& RandomService::global() {
+    static RandomService service; // Shared by every entity of the process
+    return service;
+}
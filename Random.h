@@ -0,0 +1,108 @@
+#pragma once
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+
+/**
+ * @brief Independent families of random streams, so entity numbers of different kinds never share a stream.
+ */
+enum class RandomDomain : std::uint64_t {
+    World = 0,      // Draws made by the simulation driver
+    BusinessId = 1, // Key of the business ID permutation
+    Business = 2,   // Per-business update streams
+    Npc = 3,        // Per-NPC update streams
+    Scenario = 4,   // Per-entity streams of the world generator
+};
+
+/**
+ * @class RandomStream
+ * @brief Cheap counter-based random stream built on SplitMix64.
+ * A stream is a single 64-bit counter, so creating one per entity per tick costs a few multiplications instead of
+ * an entropy read and a Mersenne Twister seeding.
+ */
+class RandomStream {
+  public:
+    explicit constexpr RandomStream(std::uint64_t key) noexcept : state_(key) {}
+
+    /**
+     * @brief Get the next 64 random bits of the stream.
+     */
+    std::uint64_t next() noexcept {
+        state_ += 0x9E3779B97F4A7C15ull; // Weyl sequence step
+        return mix(state_);
+    }
+
+    /**
+     * @brief Get a uniformly distributed double in [0, 1).
+     */
+    double uniform() noexcept { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+
+    /**
+     * @brief Get a uniformly distributed integer in [low, high].
+     */
+    int uniformInt(int low, int high) noexcept {
+        std::uint64_t range = static_cast<std::uint64_t>(static_cast<std::int64_t>(high) - low) + 1;
+        return static_cast<int>(low + static_cast<std::int64_t>(next() % range));
+    }
+
+    /**
+     * @brief SplitMix64 finalizer, also used to derive stream keys.
+     */
+    static constexpr std::uint64_t mix(std::uint64_t z) noexcept {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+  private:
+    std::uint64_t state_;
+};
+
+/**
+ * @class RandomService
+ * @brief Simulation-wide source of random streams, seeded once per run.
+ * Every stream is a pure function of (seed, domain, entity, tick), so a run is reproducible from its seed and the
+ * draws of an entity do not depend on which thread updates it or in which order.
+ */
+class RandomService {
+  public:
+    /**
+     * @brief Get the service shared by the whole simulation.
+     */
+    static RandomService& global();
+
+    void seed(std::uint64_t seed) noexcept { seed_ = seed; } // Set the run seed
+    std::uint64_t seed() const noexcept { return seed_; }    // Get the run seed
+
+    void setTick(std::uint64_t tick) noexcept { tick_ = tick; } // Set the tick the streams are keyed on
+    std::uint64_t tick() const noexcept { return tick_; }       // Get the current tick
+
+    /**
+     * @brief Get the stream of an entity for the current tick.
+     * @param domain The kind of entity.
+     * @param entity The number of the entity within its domain.
+     */
+    RandomStream stream(RandomDomain domain, std::uint64_t entity) const noexcept {
+        return stream(domain, entity, tick_);
+    }
+
+    /**
+     * @brief Get the stream of an entity for a given tick.
+     * @param domain The kind of entity.
+     * @param entity The number of the entity within its domain.
+     * @param tick The tick the stream belongs to.
+     */
+    RandomStream stream(RandomDomain domain, std::uint64_t entity, std::uint64_t tick) const noexcept {
+        std::uint64_t key = RandomStream::mix(seed_ ^ 0x6A09E667F3BCC909ull);
+        key = RandomStream::mix(key ^ static_cast<std::uint64_t>(domain));
+        key = RandomStream::mix(key ^ entity);
+        return RandomStream(RandomStream::mix(key ^ tick));
+    }
+
+  private:
+    std::uint64_t seed_ = 0; // Run seed
+    std::uint64_t tick_ = 0; // Tick the streams are currently keyed on
+};
+
+#endif // RANDOM_H
@@ -0,0 +1,356 @@
+#include "Scenario.h"
+#include "ProductCatalog.h"
+#include "ProductTable.h"
+#include "Shard.h"
+#include "ThreadPool.h"
+#include "World.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <numbers>
+#include <span>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+std::string trim(const std::string& text) {
+    std::size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) {
+        return {}; // Only whitespace
+    }
+    return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+}
+
+// Standard normal draw (Box-Muller); 1 - uniform() is in (0, 1], so the logarithm is finite
+double standardNormal(RandomStream& rng) noexcept {
+    double radius = std::sqrt(-2.0 * std::log(1.0 - rng.uniform()));
+    return radius * std::cos(2.0 * std::numbers::pi * rng.uniform());
+}
+
+bool parseCount(const std::string& text, std::uint32_t& count) {
+    std::size_t used = 0;
+    unsigned long value = std::stoul(text, &used);
+    if (used != text.size() || text[0] == '-' || value > std::numeric_limits<std::uint32_t>::max()) {
+        return false; // Trailing text, negative or out of range
+    }
+    count = static_cast<std::uint32_t>(value);
+    return true;
+}
+
+} // namespace
+
+double Distribution::sample(RandomStream& rng) const noexcept {
+    switch (kind) {
+    case Kind::Uniform:
+        return a + (b - a) * rng.uniform();
+    case Kind::Normal:
+        return a + b * standardNormal(rng);
+    case Kind::LogNormal:
+        return a * std::exp(b * standardNormal(rng));
+    default:
+        return a;
+    }
+}
+
+bool Distribution::parse(const std::string& text, Distribution& distribution) {
+    std::istringstream in(text);
+    std::string word;
+    in >> word;
+    Distribution parsed;
+    std::size_t parameters = 2;
+    if (word == "fixed") {
+        parameters = 1;
+    } else if (word == "uniform") {
+        parsed.kind = Kind::Uniform;
+    } else if (word == "normal") {
+        parsed.kind = Kind::Normal;
+    } else if (word == "lognormal") {
+        parsed.kind = Kind::LogNormal;
+    } else {
+        in.clear();
+        in.str(text); // A bare number
+        parameters = 1;
+    }
+    if (!(in >> parsed.a) || (parameters == 2 && !(in >> parsed.b)) || !(in >> std::ws).eof()) {
+        return false; // Missing parameter or trailing text
+    }
+    if (!std::isfinite(parsed.a) || !std::isfinite(parsed.b)) {
+        return false;
+    }
+    if ((parsed.kind == Kind::Uniform && parsed.a > parsed.b) || (parsed.kind == Kind::Normal && parsed.b < 0) ||
+        (parsed.kind == Kind::LogNormal && (parsed.a <= 0 || parsed.b < 0))) {
+        return false; // Empty range, negative spread or non-positive median
+    }
+    distribution = parsed;
+    return true;
+}
+
+bool Scenario::load(const std::string& path) {
+    errorLine_ = 0;
+    std::ifstream in(path);
+    if (!in) {
+        return false; // Cannot read the file
+    }
+    *this = Scenario();
+    std::string section;                     // Kind of the current section, empty before the first
+    std::vector<std::size_t> archetypeLines; // Line of every archetype section, to report what is missing
+    std::vector<bool> offersSet;             // Whether every archetype set its offers
+    std::string line;
+    for (std::size_t number = 1; std::getline(in, line); ++number) {
+        errorLine_ = number;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue; // Blank line or comment
+        }
+        if (line.front() == '[') {
+            if (line.back() != ']') {
+                return false;
+            }
+            std::string header = trim(line.substr(1, line.size() - 2));
+            std::size_t space = header.find_first_of(" \t");
+            section = header.substr(0, space);
+            std::string name = space == std::string::npos ? std::string() : trim(header.substr(space));
+            if (section == "product" && !name.empty()) {
+                auto sameName = [&](const ProductSpec& product) { return product.name == name; };
+                if (std::any_of(products.begin(), products.end(), sameName)) {
+                    return false; // Declared twice
+                }
+                products.push_back({.name = name});
+            } else if (section == "archetype" && !name.empty()) {
+                archetypes.push_back({.name = name});
+                archetypeLines.push_back(number);
+                offersSet.push_back(false);
+            } else if (section != "npcs" || !name.empty()) {
+                return false; // Unknown section, or a product or archetype without a name
+            }
+            continue;
+        }
+        std::size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            return false; // Not a name = value line
+        }
+        std::string name = trim(line.substr(0, equals));
+        if (!set(section, name, trim(line.substr(equals + 1)))) {
+            return false;
+        }
+        if (section == "archetype" && name == "offers") {
+            offersSet.back() = true;
+        }
+    }
+
+    for (std::size_t i = 0; i < archetypes.size(); ++i) {
+        ArchetypeSpec& archetype = archetypes[i];
+        errorLine_ = archetypeLines[i];
+        std::uint32_t listed = static_cast<std::uint32_t>(archetype.products.size());
+        if (!offersSet[i]) {
+            archetype.minOffers = archetype.maxOffers = listed; // Every listed product
+        }
+        if (archetype.count != 0 && (listed == 0 || archetype.maxOffers > listed)) {
+            return false; // Nothing to sell, or more offers than products
+        }
+    }
+    if (businesses() > std::numeric_limits<std::uint32_t>::max() || npcs > std::numeric_limits<std::uint32_t>::max()) {
+        errorLine_ = 0;
+        return false; // More entities than a world has slots
+    }
+    errorLine_ = 0;
+    return true;
+}
+
+bool Scenario::set(const std::string& section, const std::string& name, const std::string& value) {
+    try {
+        if (section == "product") {
+            ProductSpec& product = products.back();
+            if (name == "price") {
+                return Distribution::parse(value, product.price);
+            } else if (name == "supply") {
+                return Distribution::parse(value, product.supply);
+            } else if (name == "demand") {
+                return Distribution::parse(value, product.demand);
+            } else if (name == "resupply") {
+                return Distribution::parse(value, product.resupply);
+            }
+        } else if (section == "archetype") {
+            ArchetypeSpec& archetype = archetypes.back();
+            if (name == "count") {
+                return parseCount(value, archetype.count);
+            } else if (name == "capital") {
+                return Distribution::parse(value, archetype.capital);
+            } else if (name == "offers") {
+                std::istringstream in(value);
+                std::string low, high;
+                in >> low >> high;
+                if (!parseCount(low, archetype.minOffers)) {
+                    return false;
+                }
+                if (high.empty()) {
+                    archetype.maxOffers = archetype.minOffers; // A single count
+                    return true;
+                }
+                return parseCount(high, archetype.maxOffers) && archetype.minOffers <= archetype.maxOffers &&
+                       (in >> std::ws).eof();
+            } else if (name == "products") {
+                archetype.products.clear();
+                std::istringstream in(value);
+                std::string entry;
+                while (std::getline(in, entry, ',')) {
+                    entry = trim(entry);
+                    auto it = std::find_if(products.begin(), products.end(), [&](const ProductSpec& product) {
+                        return product.name == entry;
+                    });
+                    if (it == products.end()) {
+                        return false; // Products must be declared before the archetypes selling them
+                    }
+                    std::uint32_t index = static_cast<std::uint32_t>(it - products.begin());
+                    if (std::find(archetype.products.begin(), archetype.products.end(), index) ==
+                        archetype.products.end()) {
+                        archetype.products.push_back(index);
+                    }
+                }
+                return true;
+            }
+        } else if (section == "npcs") {
+            if (name == "count") {
+                std::uint32_t count;
+                if (!parseCount(value, count)) {
+                    return false;
+                }
+                npcs = count;
+                return true;
+            } else if (name == "balance") {
+                return Distribution::parse(value, balance);
+            } else if (name == "strategies") {
+                return parseStrategies(value, strategies);
+            }
+        }
+    } catch (const std::exception&) {
+        return false; // Not a number
+    }
+    return false; // Unknown name, or a line outside of any section
+}
+
+std::uint64_t Scenario::businesses() const noexcept {
+    std::uint64_t total = 0;
+    for (const ArchetypeSpec& archetype : archetypes) {
+        total += archetype.count;
+    }
+    return total;
+}
+
+void Scenario::generate(World& world, ThreadPool& pool, const ShardLink* shard) const {
+    const RandomService& random = RandomService::global();
+    const std::size_t businessCount = businesses();
+    std::vector<ProductId> ids(products.size());
+    for (std::size_t p = 0; p < products.size(); ++p) {
+        ids[p] = ProductCatalog::global().intern(products[p].name);
+    }
+
+    // Businesses are numbered archetype after archetype; the number keys the stream of every business
+    std::vector<std::size_t> archetypeStart(archetypes.size() + 1, 0);
+    for (std::size_t a = 0; a < archetypes.size(); ++a) {
+        archetypeStart[a + 1] = archetypeStart[a] + archetypes[a].count;
+    }
+    auto archetypeOf = [&](std::size_t b) {
+        return static_cast<std::size_t>(std::upper_bound(archetypeStart.begin(), archetypeStart.end(), b) -
+                                        archetypeStart.begin() - 1);
+    };
+
+    // First pass: the number of products of every business, so the rows can be laid out back to back. The streams
+    // are kept, the second pass carries on where they stopped
+    std::vector<RandomStream> streams(businessCount, RandomStream(0));
+    std::vector<std::size_t> rowStart(businessCount + 1, 0);
+    pool.parallelFor(businessCount, 0, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t b = begin; b < end; ++b) {
+            const ArchetypeSpec& archetype = archetypes[archetypeOf(b)];
+            streams[b] = random.stream(RandomDomain::Scenario, b, 0);
+            rowStart[b + 1] = static_cast<std::size_t>(
+                streams[b].uniformInt(static_cast<int>(archetype.minOffers), static_cast<int>(archetype.maxOffers)));
+        }
+    });
+    for (std::size_t b = 0; b < businessCount; ++b) {
+        rowStart[b + 1] += rowStart[b];
+    }
+
+    // Second pass: the products, rows, capital and name of every business, each written to its own range
+    const std::size_t rows = rowStart.back();
+    std::vector<ProductId> rowProducts(rows);
+    std::vector<double> rowPrices(rows);
+    std::vector<int> rowSupply(rows);
+    std::vector<double> rowDemand(rows);
+    std::vector<double> rowResupply(rows);
+    std::vector<Money> capital(businessCount);
+    std::vector<std::string> businessNames(businessCount);
+    pool.parallelFor(businessCount, 0, [&](std::size_t begin, std::size_t end) {
+        std::vector<std::uint32_t> choices; // Products not chosen yet, reused across the chunk
+        for (std::size_t b = begin; b < end; ++b) {
+            std::size_t a = archetypeOf(b);
+            const ArchetypeSpec& archetype = archetypes[a];
+            RandomStream& rng = streams[b];
+            choices.assign(archetype.products.begin(), archetype.products.end());
+            for (std::size_t row = rowStart[b]; row < rowStart[b + 1]; ++row) {
+                // Partial Fisher-Yates shuffle: every product is sold at most once
+                std::size_t taken = row - rowStart[b];
+                std::swap(choices[taken], choices[rng.uniformInt(static_cast<int>(taken),
+                                                                 static_cast<int>(choices.size()) - 1)]);
+                const ProductSpec& product = products[choices[taken]];
+                rowProducts[row] = ids[choices[taken]];
+                rowPrices[row] = std::max(0.01, product.price.sample(rng));
+                double supply = std::nearbyint(product.supply.sample(rng));
+                rowSupply[row] = static_cast<int>(std::clamp(supply, 0.0, double{std::numeric_limits<int>::max()}));
+                rowDemand[row] = std::max(0.0, product.demand.sample(rng));
+                rowResupply[row] = std::max(0.0, product.resupply.sample(rng));
+            }
+            capital[b] = Money::fromDouble(std::max(0.0, archetype.capital.sample(rng)));
+            businessNames[b] = archetype.name + std::to_string(b - archetypeStart[a]);
+        }
+    });
+
+    // NPCs follow the businesses in the stream numbering; a shard only draws every shards-th NPC, from its own
+    const std::size_t first = shard != nullptr ? shard->shard() : 0;
+    const std::size_t stride = shard != nullptr ? shard->shards() : 1;
+    const std::size_t drawn = npcs > first ? (npcs - first + stride - 1) / stride : 0;
+    std::vector<Money> endowment(drawn);
+    std::vector<std::string> npcNames(drawn);
+    pool.parallelFor(drawn, 0, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            std::size_t n = first + i * stride;
+            RandomStream rng = random.stream(RandomDomain::Scenario, businessCount + n, 0);
+            endowment[i] = Money::fromDouble(std::max(0.0, balance.sample(rng)));
+            npcNames[i] = "Npc" + std::to_string(n);
+        }
+    });
+
+    // Creating the entities hands out IDs, slots and ledger accounts in order, which keeps the world independent of
+    // the number of threads; it only moves what was drawn into storage that was sized up front
+    world.reserve(businessCount, drawn);
+    ProductTable::market().reserve(businessCount, rows);
+    for (std::size_t b = 0; b < businessCount; ++b) {
+        Business* business = world.business(
+            world.createBusiness(std::move(businessNames[b]), archetypes[archetypeOf(b)].name, capital[b]));
+        std::size_t first = rowStart[b];
+        std::size_t count = rowStart[b + 1] - first;
+        auto prices = std::span<const double>(rowPrices).subspan(first, count);
+        business->productTable().insert(business->productSlot(),
+                                        {.products = std::span<const ProductId>(rowProducts).subspan(first, count),
+                                         .prices = prices,
+                                         .initialPrices = prices,
+                                         .supply = std::span<const int>(rowSupply).subspan(first, count),
+                                         .demand = std::span<const double>(rowDemand).subspan(first, count),
+                                         .resupplyRates = std::span<const double>(rowResupply).subspan(first, count)});
+    }
+    world.aggregates().rebuild(world); // The rows bypassed Business::addProduct
+    for (std::size_t i = 0; i < drawn; ++i) {
+        std::size_t n = first + i * stride;
+        NpcHandle npc = shard != nullptr ? world.createNpc(std::move(npcNames[i]), endowment[i], n)
+                                         : world.createNpc(std::move(npcNames[i]), endowment[i]);
+        world.npc(npc)->setStrategy(strategyFor(n, strategies));
+    }
+}
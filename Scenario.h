@@ -0,0 +1,124 @@
+#pragma once
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include "NpcStrategy.h"
+#include "Random.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ShardLink;
+class ThreadPool;
+class World;
+
+/**
+ * @struct Distribution
+ * @brief Distribution of a generated value, written "fixed V", "uniform MIN MAX", "normal MEAN SD" or
+ * "lognormal MEDIAN SIGMA" in a scenario; a bare number is fixed.
+ */
+struct Distribution {
+    enum class Kind : std::uint8_t { Fixed, Uniform, Normal, LogNormal };
+
+    Kind kind = Kind::Fixed;
+    double a = 0; // Value, minimum, mean or median
+    double b = 0; // Maximum, standard deviation or sigma
+
+    /**
+     * @brief Draw a value.
+     */
+    double sample(RandomStream& rng) const noexcept;
+
+    /**
+     * @brief Parse a distribution.
+     * @return false if the text is not a valid distribution.
+     */
+    static bool parse(const std::string& text, Distribution& distribution);
+};
+
+/**
+ * @struct ProductSpec
+ * @brief A product of a scenario and the distributions of its starting rows.
+ */
+struct ProductSpec {
+    std::string name;
+    Distribution price{Distribution::Kind::Uniform, 5, 20};
+    Distribution supply{Distribution::Kind::Fixed, 50};
+    Distribution demand{Distribution::Kind::Fixed, 50};
+    Distribution resupply{Distribution::Kind::Fixed, 50};
+};
+
+/**
+ * @struct ArchetypeSpec
+ * @brief A kind of business of a scenario: how many there are, what they may sell, and their capital.
+ */
+struct ArchetypeSpec {
+    std::string name;
+    std::uint32_t count = 0;             // Businesses of the archetype
+    std::vector<std::uint32_t> products; // Products the businesses choose from, indexes into Scenario::products
+    std::uint32_t minOffers = 1;         // Fewest products a business sells
+    std::uint32_t maxOffers = 1;         // Most products a business sells
+    Distribution capital{Distribution::Kind::Fixed, 10000};
+};
+
+/**
+ * @class Scenario
+ * @brief Description of a starting world, loaded from a scenario file and built by generate().
+ *
+ * A scenario file is made of sections of name = value lines; blank lines are skipped and # starts a comment:
+ *
+ *     [product Bread]
+ *     price = uniform 2 5
+ *     supply = fixed 80          # also demand and resupply, all default to 50
+ *
+ *     [archetype Bakery]
+ *     count = 20000
+ *     products = Bread, Cake     # declared above
+ *     offers = 1 2               # products per business, or a single count; all of them by default
+ *     capital = normal 10000 2000
+ *
+ *     [npcs]
+ *     count = 1000000
+ *     balance = lognormal 10000 0.5
+ *     strategies = speculator:3,consumer:1
+ *
+ * Every value is drawn from a stream keyed on the entity's number, so a scenario and a seed give the same world
+ * whatever the number of threads generating it.
+ */
+class Scenario {
+  public:
+    std::vector<ProductSpec> products;
+    std::vector<ArchetypeSpec> archetypes;
+    std::uint64_t npcs = 0;                                 // NPCs created
+    Distribution balance{Distribution::Kind::Fixed, 10000}; // Starting balance of the NPCs
+    std::array<double, STRATEGY_COUNT> strategies = {1.0};  // Share of the NPCs following every strategy
+
+    /**
+     * @brief Load a scenario file.
+     * @param path The path of the scenario file.
+     * @return false if the file cannot be read or is invalid; errorLine() tells where.
+     */
+    bool load(const std::string& path);
+
+    std::size_t errorLine() const noexcept { return errorLine_; } // Line of the last load error, 0 if unreadable
+
+    std::uint64_t businesses() const noexcept; // Businesses created, over every archetype
+
+    /**
+     * @brief Build the scenario into an empty world: draw every entity in parallel, then create them in bulk.
+     * @param world The world, holding no entity yet.
+     * @param pool The threads drawing the entities.
+     * @param shard The shard the world belongs to, which only gets the NPCs it owns; nullptr for a whole world.
+     */
+    void generate(World& world, ThreadPool& pool, const ShardLink* shard = nullptr) const;
+
+  private:
+    bool set(const std::string& section, const std::string& name, const std::string& value); // Set one line
+
+    std::size_t errorLine_ = 0;
+};
+
+#endif // SCENARIO_H
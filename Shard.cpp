@@ -0,0 +1,272 @@
+#include "Shard.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+struct ShardGroup::Control {
+    std::atomic<std::uint32_t> arrived{0};    // Shards waiting in the current allReduce()
+    std::atomic<std::uint32_t> generation{0}; // allReduce() calls completed
+    std::atomic<std::uint32_t> aborted{0};    // Set once a worker failed
+    std::int64_t values[2][MAX_SHARDS] = {};  // Contributions to allReduce(), by generation parity
+    alignas(64) std::byte report[REPORT_BYTES] = {};
+};
+
+struct ShardGroup::Ring {
+    alignas(64) std::atomic<std::uint64_t> head{0}; // Bytes written so far, only advanced by the producer
+    alignas(64) std::atomic<std::uint64_t> tail{0}; // Bytes read so far, only advanced by the consumer
+
+    std::byte* data() noexcept { return reinterpret_cast<std::byte*>(this + 1); }
+
+    // Copy as much as fits, return the number of bytes written
+    std::size_t write(const std::byte* source, std::size_t size, std::size_t capacity) noexcept {
+        std::uint64_t written = head.load(std::memory_order_relaxed);
+        std::uint64_t read = tail.load(std::memory_order_acquire);
+        std::size_t count = static_cast<std::size_t>(std::min<std::uint64_t>(size, capacity - (written - read)));
+        std::size_t at = static_cast<std::size_t>(written % capacity);
+        std::size_t first = std::min(count, capacity - at);
+        std::memcpy(data() + at, source, first);
+        std::memcpy(data(), source + first, count - first); // Wrapped around
+        head.store(written + count, std::memory_order_release);
+        return count;
+    }
+
+    // Copy as much as is available, return the number of bytes read
+    std::size_t read(std::byte* target, std::size_t size, std::size_t capacity) noexcept {
+        std::uint64_t read = tail.load(std::memory_order_relaxed);
+        std::uint64_t written = head.load(std::memory_order_acquire);
+        std::size_t count = static_cast<std::size_t>(std::min<std::uint64_t>(size, written - read));
+        std::size_t at = static_cast<std::size_t>(read % capacity);
+        std::size_t first = std::min(count, capacity - at);
+        std::memcpy(target, data() + at, first);
+        std::memcpy(target + first, data(), count - first);
+        tail.store(read + count, std::memory_order_release);
+        return count;
+    }
+};
+
+ShardGroup::~ShardGroup() {
+#ifndef _WIN32
+    if (region_ != nullptr) {
+        munmap(region_, regionBytes_);
+    }
+#endif
+}
+
+ShardGroup::Ring* ShardGroup::ring(std::uint32_t from, std::uint32_t to) const noexcept {
+    // Rings of the ordered pairs of distinct shards, by sender then receiver
+    std::size_t index = std::size_t{from} * (shards_ - 1) + (to < from ? to : to - 1);
+    std::byte* base = static_cast<std::byte*>(region_) + ((sizeof(Control) + 4095) & ~std::size_t{4095});
+    return reinterpret_cast<Ring*>(base + index * ringStride_);
+}
+
+std::span<std::byte, ShardGroup::REPORT_BYTES> ShardGroup::report() noexcept {
+    return std::span<std::byte, REPORT_BYTES>(control()->report, REPORT_BYTES);
+}
+
+#ifdef _WIN32
+
+bool ShardGroup::open(std::uint32_t, std::size_t) {
+    return false; // Workers are forked
+}
+
+bool ShardGroup::run(const std::function<int(ShardLink&)>&) {
+    return false;
+}
+
+#else
+
+bool ShardGroup::open(std::uint32_t shards, std::size_t ringBytes) {
+    if (region_ != nullptr || shards == 0 || shards > MAX_SHARDS || ringBytes == 0) {
+        return false;
+    }
+    ringStride_ = (sizeof(Ring) + ringBytes + 63) & ~std::size_t{63};
+    regionBytes_ = ((sizeof(Control) + 4095) & ~std::size_t{4095}) + std::size_t{shards} * (shards - 1) * ringStride_;
+    void* region = mmap(nullptr, regionBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        return false; // Cannot map the region
+    }
+    region_ = region;
+    ringBytes_ = ringBytes;
+    shards_ = shards;
+    new (region_) Control();
+    for (std::uint32_t from = 0; from < shards; ++from) {
+        for (std::uint32_t to = 0; to < shards; ++to) {
+            if (from != to) {
+                new (ring(from, to)) Ring();
+            }
+        }
+    }
+    return true;
+}
+
+bool ShardGroup::run(const std::function<int(ShardLink&)>& worker) {
+    if (region_ == nullptr) {
+        return false;
+    }
+    std::cout.flush(); // Buffered output would be written again by every worker
+    std::cerr.flush();
+    std::vector<pid_t> workers;
+    for (std::uint32_t shard = 0; shard < shards_; ++shard) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            break; // Cannot start the worker
+        }
+        if (pid == 0) {
+            int status = 1;
+            try {
+                ShardLink link(*this, shard);
+                status = worker(link);
+            } catch (const std::exception& error) {
+                std::cerr << "Shard " << shard << ": " << error.what() << std::endl;
+            }
+            if (status != 0) {
+                control()->aborted.store(1, std::memory_order_relaxed);
+            }
+            std::cout.flush();
+            std::cerr.flush();
+            _exit(status); // Skips the destructors of the state copied from the parent
+        }
+        workers.push_back(pid);
+    }
+
+    bool succeeded = workers.size() == shards_;
+    if (!succeeded) {
+        control()->aborted.store(1, std::memory_order_relaxed);
+    }
+    for (std::size_t left = workers.size(); left != 0;) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            break; // No child left
+        }
+        if (std::find(workers.begin(), workers.end(), pid) == workers.end()) {
+            continue; // Not a worker of this group
+        }
+        --left;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            succeeded = false;
+            control()->aborted.store(1, std::memory_order_relaxed); // The others would wait for it forever
+        }
+    }
+    return succeeded;
+}
+
+#endif
+
+ShardLink::ShardLink(ShardGroup& group, std::uint32_t shard)
+    : group_(&group), shard_(shard), shards_(group.shards()), received_(group.shards()) {}
+
+void ShardLink::exchange(std::span<const std::byte> batch) {
+    constexpr std::size_t PREFIX = sizeof(std::uint64_t); // Length of the batch, sent ahead of it
+    const std::uint64_t length = batch.size();
+    std::byte prefix[PREFIX];
+    std::memcpy(prefix, &length, PREFIX);
+    const std::size_t capacity = group_->ringBytes_;
+
+    std::array<std::uint64_t, ShardGroup::MAX_SHARDS> sent{};
+    std::array<std::size_t, ShardGroup::MAX_SHARDS> filled{}; // Bytes received, prefix included
+    std::array<bool, ShardGroup::MAX_SHARDS> done{};
+    std::size_t pending = 2 * std::size_t{shards_ - 1}; // Batches left to send and to receive
+    for (std::uint32_t peer = 0; peer < shards_; ++peer) {
+        received_[peer].resize(PREFIX); // Grown to the batch once its length is known
+    }
+
+    std::size_t spins = 0;
+    while (pending != 0) {
+        bool moved = false;
+        for (std::uint32_t peer = 0; peer < shards_; ++peer) {
+            if (peer == shard_) {
+                continue;
+            }
+            if (sent[peer] < PREFIX + length) {
+                ShardGroup::Ring* out = group_->ring(shard_, peer);
+                std::size_t count = sent[peer] < PREFIX
+                                        ? out->write(prefix + sent[peer], PREFIX - sent[peer], capacity)
+                                        : out->write(batch.data() + (sent[peer] - PREFIX),
+                                                     PREFIX + length - sent[peer], capacity);
+                sent[peer] += count;
+                moved |= count != 0;
+                pending -= sent[peer] == PREFIX + length;
+            }
+
+            // Receive while sending, so two shards filling each other's rings both make progress
+            std::vector<std::byte>& in = received_[peer];
+            while (!done[peer]) {
+                std::size_t count = group_->ring(peer, shard_)->read(in.data() + filled[peer],
+                                                                     in.size() - filled[peer], capacity);
+                filled[peer] += count;
+                moved |= count != 0;
+                if (filled[peer] < in.size()) {
+                    break; // Nothing more yet
+                }
+                if (filled[peer] == PREFIX) {
+                    std::uint64_t incoming;
+                    std::memcpy(&incoming, in.data(), PREFIX);
+                    in.resize(PREFIX + static_cast<std::size_t>(incoming)); // Read the batch next
+                }
+                if (filled[peer] == in.size()) {
+                    done[peer] = true; // The whole batch, or an empty one
+                    --pending;
+                }
+            }
+        }
+        if (moved) {
+            spins = 0;
+        } else {
+            wait(spins);
+        }
+    }
+}
+
+std::span<const std::byte> ShardLink::received(std::uint32_t shard) const noexcept {
+    std::span<const std::byte> batch = received_[shard];
+    return batch.size() > sizeof(std::uint64_t) ? batch.subspan(sizeof(std::uint64_t)) : std::span<const std::byte>();
+}
+
+std::int64_t ShardLink::allReduce(std::int64_t value) {
+    // Contributions alternate between two rows: a shard writes the next row only after every shard arrived at the
+    // barrier in between, so no shard can still be reading it
+    ShardGroup::Control& control = *group_->control();
+    std::uint32_t generation = control.generation.load(std::memory_order_acquire);
+    std::int64_t* values = control.values[generation & 1];
+    values[shard_] = value;
+    if (control.arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == shards_) {
+        control.arrived.store(0, std::memory_order_relaxed);
+        control.generation.store(generation + 1, std::memory_order_release); // Last to arrive releases the others
+    } else {
+        std::size_t spins = 0;
+        while (control.generation.load(std::memory_order_acquire) == generation) {
+            wait(spins);
+        }
+    }
+    std::int64_t sum = 0;
+    for (std::uint32_t shard = 0; shard < shards_; ++shard) {
+        sum += values[shard];
+    }
+    return sum;
+}
+
+void ShardLink::wait(std::size_t& spins) const {
+    if (group_->control()->aborted.load(std::memory_order_relaxed) != 0) {
+        throw std::runtime_error("another shard failed");
+    }
+    if (++spins > 64) {
+        std::this_thread::yield(); // Shards may outnumber the cores
+    }
+}
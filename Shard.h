@@ -0,0 +1,180 @@
+#pragma once
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @class ShardBatch
+ * @brief Bytes of one message batch, built from trivially copyable records.
+ */
+class ShardBatch {
+  public:
+    void clear() noexcept { bytes_.clear(); }
+
+    template <class T> void put(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>, "Batches only carry trivially copyable records");
+        put(&value, sizeof(T));
+    }
+
+    void put(const void* data, std::size_t size) {
+        std::size_t at = bytes_.size();
+        bytes_.resize(at + size);
+        std::memcpy(bytes_.data() + at, data, size);
+    }
+
+    std::span<const std::byte> bytes() const noexcept { return bytes_; }
+
+  private:
+    std::vector<std::byte> bytes_;
+};
+
+/**
+ * @class ShardReader
+ * @brief Reads the records of a batch received from another shard, in the order they were put.
+ */
+class ShardReader {
+  public:
+    explicit ShardReader(std::span<const std::byte> bytes) noexcept : bytes_(bytes) {}
+
+    template <class T> T get() {
+        static_assert(std::is_trivially_copyable_v<T>, "Batches only carry trivially copyable records");
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    std::string_view text(std::size_t length) { return {reinterpret_cast<const char*>(take(length)), length}; }
+
+    bool empty() const noexcept { return offset_ == bytes_.size(); } // Whether every record was read
+
+  private:
+    const std::byte* take(std::size_t size) {
+        if (size > bytes_.size() - offset_) {
+            throw std::runtime_error("ShardReader: batch ended in the middle of a record");
+        }
+        const std::byte* data = bytes_.data() + offset_;
+        offset_ += size;
+        return data;
+    }
+
+    std::span<const std::byte> bytes_;
+    std::size_t offset_ = 0;
+};
+
+class ShardLink;
+
+/**
+ * @class ShardGroup
+ * @brief Worker processes sharing one memory region: a control block and a ring buffer for every pair of shards.
+ *
+ * The region is mapped before the workers are forked, so every worker sees it at the same address. Each ordered
+ * pair of shards has its own single-producer, single-consumer byte ring, so sending never takes a lock. If a worker
+ * dies, the group is aborted and the workers still waiting on it give up instead of waiting forever.
+ *
+ * Only available where fork() is; open() fails elsewhere.
+ */
+class ShardGroup {
+  public:
+    static constexpr std::uint32_t MAX_SHARDS = 64;
+    static constexpr std::size_t REPORT_BYTES = 4096; // Result area the workers hand back to the parent
+
+    ShardGroup() = default;
+    ~ShardGroup();
+    ShardGroup(const ShardGroup&) = delete;
+    ShardGroup& operator=(const ShardGroup&) = delete;
+
+    /**
+     * @brief Map the shared region.
+     * @param shards The number of worker processes, 1 to MAX_SHARDS.
+     * @param ringBytes The capacity of every ring; batches larger than a ring stream through it.
+     * @return false if the region cannot be mapped or the platform cannot fork.
+     */
+    bool open(std::uint32_t shards, std::size_t ringBytes = std::size_t{1} << 20);
+
+    std::uint32_t shards() const noexcept { return shards_; }
+
+    /**
+     * @brief Fork one worker per shard and wait for all of them.
+     * Call it before the process starts any thread: only the calling thread survives in the workers.
+     * @param worker Runs in every worker with the link of its shard; returns the exit status of the worker.
+     * @return false if a worker could not be started, failed or died; the others are aborted.
+     */
+    bool run(const std::function<int(ShardLink&)>& worker);
+
+    /**
+     * @brief Get the result area, written by the workers and read by the parent once run() returns.
+     */
+    std::span<std::byte, REPORT_BYTES> report() noexcept;
+
+  private:
+    friend class ShardLink;
+    struct Control;
+    struct Ring;
+
+    Control* control() const noexcept { return static_cast<Control*>(region_); }
+    Ring* ring(std::uint32_t from, std::uint32_t to) const noexcept; // Carrying the batches from one shard to another
+
+    void* region_ = nullptr;
+    std::size_t regionBytes_ = 0;
+    std::size_t ringBytes_ = 0;
+    std::size_t ringStride_ = 0; // Bytes between consecutive rings, header included
+    std::uint32_t shards_ = 0;
+};
+
+/**
+ * @class ShardLink
+ * @brief The view of a ShardGroup from one worker: which part of the world it owns and how it talks to the others.
+ *
+ * NPCs are dealt to the shards round-robin by creation number. Every collective call, exchange() and allReduce(),
+ * must be made by every shard in the same order.
+ */
+class ShardLink {
+  public:
+    ShardLink(ShardGroup& group, std::uint32_t shard);
+    ShardLink(const ShardLink&) = delete;
+    ShardLink& operator=(const ShardLink&) = delete;
+
+    std::uint32_t shard() const noexcept { return shard_; }   // Shard of this worker
+    std::uint32_t shards() const noexcept { return shards_; } // Shards of the group
+    bool ownsNpc(std::uint64_t number) const noexcept { return number % shards_ == shard_; }
+
+    /**
+     * @brief Send a batch to every other shard and receive the batch of each of them.
+     * Sending and receiving are interleaved, so batches larger than the rings cannot deadlock.
+     * @param batch The batch of this shard.
+     */
+    void exchange(std::span<const std::byte> batch);
+
+    /**
+     * @brief Get the batch a shard sent in the last exchange(); the own batch of the shard is not kept.
+     */
+    std::span<const std::byte> received(std::uint32_t shard) const noexcept;
+
+    /**
+     * @brief Wait for every shard, then sum a value over all of them.
+     * @param value The contribution of this shard.
+     * @return The sum of the contributions of every shard.
+     */
+    std::int64_t allReduce(std::int64_t value);
+
+    void barrier() { allReduce(0); } // Wait for every shard
+
+  private:
+    void wait(std::size_t& spins) const; // Back off while nothing moves; throws once the group is aborted
+
+    ShardGroup* group_;
+    std::uint32_t shard_;
+    std::uint32_t shards_;
+    std::vector<std::vector<std::byte>> received_; // Last batch of every shard, length prefix included
+};
+
+#endif // SHARD_H
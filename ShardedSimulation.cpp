@@ -0,0 +1,65 @@
+#include "ShardedSimulation.h"
+#include "Shard.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+const char* ShardedSimulation::unsupportedOption(const SimulationConfig& config) noexcept {
+    if (!config.restorePath.empty()) {
+        return "restore";
+    }
+    if (!config.checkpointPath.empty()) {
+        return "checkpoint";
+    }
+    if (!config.seriesPath.empty()) {
+        return "series";
+    }
+    if (config.logLevel != EventLevel::Off) {
+        return "log-level";
+    }
+    if (config.publishEvery != 0) {
+        return "publish-every";
+    }
+    if (config.watchSeconds > 0) {
+        return "watch";
+    }
+    return nullptr;
+}
+
+bool ShardedSimulation::run(SimulationSummary& summary) {
+    static_assert(std::is_trivially_copyable_v<SimulationSummary> &&
+                      sizeof(SimulationSummary) <= ShardGroup::REPORT_BYTES,
+                  "Shard 0 hands the summary back through the report area");
+    if (config_.shards == 0 || unsupportedOption(config_) != nullptr) {
+        return false;
+    }
+    ShardGroup group;
+    if (!group.open(config_.shards)) {
+        return false;
+    }
+
+    bool succeeded = group.run([&](ShardLink& link) {
+        SimulationConfig config = config_;
+        if (config.threads == 0) {
+            config.threads = std::max(1u, std::thread::hardware_concurrency() / config.shards); // Split the cores
+        }
+        if (link.shard() != 0) {
+            config.metricsPath.clear(); // One file, from shard 0
+        }
+        Simulation simulation(config, &link);
+        if (!config.scenarioPath.empty() && !simulation.loadScenario(config.scenarioPath)) {
+            return 1;
+        }
+        SimulationSummary result = simulation.run();
+        if (link.shard() == 0) {
+            std::memcpy(group.report().data(), &result, sizeof(result));
+        }
+        return 0;
+    });
+    if (succeeded) {
+        std::memcpy(&summary, group.report().data(), sizeof(summary));
+    }
+    return succeeded;
+}
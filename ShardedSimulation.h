@@ -0,0 +1,38 @@
+#pragma once
+#ifndef SHARDED_SIMULATION_H
+#define SHARDED_SIMULATION_H
+
+#include "Simulation.h"
+
+/**
+ * @class ShardedSimulation
+ * @brief Headless driver running one world in several worker processes, see ShardGroup.
+ *
+ * Every worker builds all the businesses and its share of the NPCs from the same options and seed, then runs the
+ * ticks in lockstep with the others (TickScheduler::setShard()). The summary is the one a Simulation of the same
+ * options and seed reports. Snapshots, event logs, time series and published views need the whole world in one
+ * process and cannot be used.
+ */
+class ShardedSimulation {
+  public:
+    explicit ShardedSimulation(const SimulationConfig& config) : config_(config) {}
+
+    /**
+     * @brief Get an option the sharded run does not support.
+     * @return The name of the option as given on the command line, nullptr if every option set is supported.
+     */
+    static const char* unsupportedOption(const SimulationConfig& config) noexcept;
+
+    /**
+     * @brief Run the simulation over config.shards worker processes.
+     * Call it before the process starts any thread. Only shard 0 writes the metrics file.
+     * @param summary Set to the summary of the run.
+     * @return false if the platform cannot fork workers or a worker failed.
+     */
+    bool run(SimulationSummary& summary);
+
+  private:
+    SimulationConfig config_;
+};
+
+#endif // SHARDED_SIMULATION_H
@@ -0,0 +1,302 @@
+#include "Simulation.h"
+#include "Metrics.h"
+#include "Random.h"
+#include "Shard.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+
+namespace {
+
+bool parseLevel(const std::string& name, EventLevel& level) {
+    if (name == "off") {
+        level = EventLevel::Off;
+    } else if (name == "warning") {
+        level = EventLevel::Warning;
+    } else if (name == "info") {
+        level = EventLevel::Info;
+    } else if (name == "debug") {
+        level = EventLevel::Debug;
+    } else {
+        return false; // Unknown level
+    }
+    return true;
+}
+
+bool parseSelection(const std::string& name, CandidateMode& mode) {
+    if (name == "price") {
+        mode = CandidateMode::Price;
+    } else if (name == "demand") {
+        mode = CandidateMode::Demand;
+    } else if (name == "segment") {
+        mode = CandidateMode::Segment;
+    } else {
+        return false; // Unknown selection
+    }
+    return true;
+}
+
+std::string trim(const std::string& text) {
+    std::size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) {
+        return {}; // Only whitespace
+    }
+    return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+}
+
+} // namespace
+
+bool SimulationConfig::set(const std::string& name, const std::string& value) {
+    try {
+        if (name == "businesses") {
+            businesses = static_cast<std::uint32_t>(std::stoul(value));
+        } else if (name == "npcs") {
+            npcs = static_cast<std::uint32_t>(std::stoul(value));
+        } else if (name == "products") {
+            products = static_cast<std::uint32_t>(std::stoul(value));
+        } else if (name == "warmup") {
+            warmupTicks = static_cast<std::uint32_t>(std::stoul(value));
+        } else if (name == "ticks") {
+            ticks = static_cast<std::uint32_t>(std::stoul(value));
+        } else if (name == "seed") {
+            seed = std::stoull(value);
+            hasSeed = true;
+        } else if (name == "threads") {
+            threads = std::stoul(value);
+        } else if (name == "mode") {
+            if (value != "fixed" && value != "ramp") {
+                return false; // Unknown mode
+            }
+            mode = value == "fixed" ? PopulationMode::Fixed : PopulationMode::Ramp;
+        } else if (name == "candidates") {
+            candidates = static_cast<std::uint32_t>(std::stoul(value));
+        } else if (name == "selection") {
+            return parseSelection(value, selection);
+        } else if (name == "scheduling") {
+            if (value != "ticks" && value != "events") {
+                return false; // Unknown scheduling
+            }
+            scheduling = value == "ticks" ? SchedulingMode::EveryTick : SchedulingMode::Events;
+        } else if (name == "strategies") {
+            return parseStrategies(value, strategies);
+        } else if (name == "log") {
+            logPath = value;
+        } else if (name == "restore") {
+            restorePath = value;
+        } else if (name == "scenario") {
+            scenarioPath = value;
+        } else if (name == "checkpoint") {
+            checkpointPath = value;
+        } else if (name == "checkpoint-every") {
+            checkpointEvery = static_cast<std::uint32_t>(std::stoul(value));
+        } else if (name == "series") {
+            seriesPath = value;
+        } else if (name == "metrics") {
+            metricsPath = value;
+        } else if (name == "metrics-every") {
+            metricsEvery = static_cast<std::uint32_t>(std::stoul(value));
+        } else if (name == "publish-every") {
+            publishEvery = static_cast<std::uint32_t>(std::stoul(value));
+        } else if (name == "watch") {
+            watchSeconds = std::stod(value);
+            if (!(watchSeconds >= 0)) {
+                return false; // Negative or NaN
+            }
+        } else if (name == "shards") {
+            shards = static_cast<std::uint32_t>(std::stoul(value));
+            if (shards > ShardGroup::MAX_SHARDS) {
+                return false; // More workers than a shard group holds
+            }
+        } else if (name == "log-level") {
+            return parseLevel(value, logLevel);
+        } else {
+            return false; // Unknown option
+        }
+    } catch (const std::exception&) {
+        return false; // Not a number
+    }
+    return true;
+}
+
+bool SimulationConfig::load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        return false; // Cannot read the file
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue; // Blank line or comment
+        }
+        std::size_t equals = line.find('=');
+        if (equals == std::string::npos || !set(trim(line.substr(0, equals)), trim(line.substr(equals + 1)))) {
+            return false; // Not a name=value line, or an invalid option
+        }
+    }
+    return true;
+}
+
+Simulation::Simulation(const SimulationConfig& config, ShardLink* shard)
+    : config_(config), shard_(shard), scheduler_(config.threads) {
+    if (config.candidates != 0) {
+        scheduler_.candidates() = CandidateSelector(config.selection, config.candidates);
+    }
+    scheduler_.setScheduling(config.scheduling);
+    scheduler_.setShard(shard);
+}
+
+bool Simulation::restore(const std::string& path) {
+    restored_ = Snapshot::load(world_, path, nextTick_);
+    return restored_;
+}
+
+bool Simulation::loadScenario(const std::string& path) {
+    hasScenario_ = scenario_.load(path);
+    return hasScenario_;
+}
+
+SimulationSummary Simulation::run() {
+    SimulationSummary summary;
+    if (!restored_) {
+        auto start = std::chrono::steady_clock::now();
+        if (hasScenario_) {
+            scenario_.generate(world_, scheduler_.pool(), shard_);
+        } else {
+            populate();
+        }
+        summary.setupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    if (!config_.seriesPath.empty() && !recorder_.open(config_.seriesPath)) {
+        std::cerr << "Cannot write the time series " << config_.seriesPath << "." << std::endl;
+    }
+
+    for (std::uint32_t i = 0; i < config_.warmupTicks; ++i) {
+        step(); // Let prices, portfolios and order books settle before measuring
+    }
+
+    Metrics::global().reset(); // Profile the steady state only, like the summary
+    std::uint64_t businessUpdates = 0;
+    std::uint64_t npcUpdates = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (std::uint32_t i = 0; i < config_.ticks; ++i) {
+        TickStats stats = step();
+        businessUpdates += stats.businessUpdates;
+        npcUpdates += stats.npcUpdates;
+        summary.trades += stats.trades();
+        summary.sharesTraded += stats.sharesTraded;
+    }
+    summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!config_.checkpointPath.empty() && config_.checkpointEvery == 0) {
+        checkpoint(); // Final state only
+    }
+    if (!config_.metricsPath.empty()) {
+        writeMetrics(); // Final metrics, also when written periodically
+    }
+    recorder_.close(); // Waits for the writer to catch up, outside the measured phase
+    queries_.flush();  // Readers see the final tick once the run returns
+    summary.ticks = config_.ticks;
+    summary.businesses = world_.businesses().size();
+    summary.npcs = world_.npcs().size();
+    summary.moneySupply = world_.ledger().supply().toDouble();
+    if (shard_ != nullptr) {
+        // Every shard holds the same businesses and commits every trade; only the NPCs are split between them
+        Money businessMoney;
+        const SlotPool<Business>& businesses = world_.businesses();
+        for (std::uint32_t b = 0; b < businesses.slots(); ++b) {
+            if (const Business* business = businesses.at(b)) {
+                businessMoney += business->balance();
+            }
+        }
+        Money npcMoney = world_.ledger().supply() - businessMoney;
+        npcUpdates = static_cast<std::uint64_t>(shard_->allReduce(static_cast<std::int64_t>(npcUpdates)));
+        summary.npcs = static_cast<std::size_t>(shard_->allReduce(static_cast<std::int64_t>(summary.npcs)));
+        summary.moneySupply = (businessMoney + Money::fromCents(shard_->allReduce(npcMoney.cents()))).toDouble();
+    }
+    summary.entityUpdates = businessUpdates + npcUpdates;
+    MarketAggregates& market = world_.aggregates();
+    market.refresh(world_); // Folds in every tick since the last read
+    summary.marketCap = market.marketCap();
+    summary.meanStockPrice = market.meanStockPrice();
+    if (const Business* top = world_.business(market.top())) {
+        summary.topBusiness = top->id();
+    }
+    summary.unbalancedTicks = unbalancedTicks_;
+    return summary;
+}
+
+void Simulation::populate() {
+    RandomService::global().setTick(0);
+    RandomStream rng = RandomService::global().stream(RandomDomain::World, 0);
+    std::uint32_t names = std::max<std::uint32_t>(64, config_.products); // Distinct product names in the market
+
+    std::uint32_t shards = shard_ != nullptr ? shard_->shards() : 1;
+    world_.reserve(config_.businesses, (config_.npcs + shards - 1) / shards);
+    ProductTable::market().reserve(config_.businesses, std::size_t{config_.businesses} * config_.products);
+    for (std::uint32_t b = 0; b < config_.businesses; ++b) {
+        Business* business = world_.business(world_.createBusiness("Business" + std::to_string(b)));
+        for (std::uint32_t p = 0; p < config_.products; ++p) {
+            business->addProduct("Product" + std::to_string((b * 7 + p) % names), 5 + rng.uniform() * 15);
+        }
+    }
+    for (std::uint32_t n = 0; n < config_.npcs; ++n) {
+        createNpc(n);
+    }
+}
+
+TickStats Simulation::step() {
+    std::uint64_t tick = nextTick_++;
+    RandomService::global().setTick(tick); // Key every stream of this tick on the tick
+    if (config_.mode == PopulationMode::Ramp) {
+        world_.createBusiness("Business" + std::to_string(config_.businesses + tick)); // Add a business to the world
+        createNpc(config_.npcs + tick);                                                // Add an npc to the world
+    }
+    TickStats stats = scheduler_.tick(world_);
+    if (!stats.balanced && unbalancedTicks_++ == 0 && (shard_ == nullptr || shard_->shard() == 0)) {
+        std::cerr << "Money is not conserved at tick " << tick << ": the ledger audit failed." << std::endl;
+    }
+    if (recorder_.isOpen()) {
+        recorder_.record(world_, tick);
+    }
+    if (config_.publishEvery != 0 && nextTick_ % config_.publishEvery == 0) {
+        queries_.publish(world_, tick); // Indexed off the tick thread
+    }
+    if (!config_.checkpointPath.empty() && config_.checkpointEvery != 0 && nextTick_ % config_.checkpointEvery == 0) {
+        checkpoint();
+    }
+    if (!config_.metricsPath.empty() && config_.metricsEvery != 0 && nextTick_ % config_.metricsEvery == 0) {
+        writeMetrics();
+    }
+    return stats;
+}
+
+void Simulation::createNpc(std::uint64_t number) {
+    std::string name = "Npc" + std::to_string(number);
+    NpcHandle handle;
+    if (shard_ == nullptr) {
+        handle = world_.createNpc(std::move(name));
+    } else if (shard_->ownsNpc(number)) {
+        handle = world_.createNpc(std::move(name), Npc::ENDOWMENT, number); // Numbered as in a whole world
+    } else {
+        return; // Created by the shard owning it
+    }
+    world_.npc(handle)->setStrategy(strategyFor(number, config_.strategies));
+}
+
+void Simulation::checkpoint() {
+    scheduler_.settleInterest(world_); // NPCs waiting on the wheels are owed interest the snapshot would lose
+    if (!Snapshot::save(world_, config_.checkpointPath, nextTick_)) {
+        std::cerr << "Cannot write the checkpoint " << config_.checkpointPath << "." << std::endl;
+    }
+}
+
+void Simulation::writeMetrics() {
+    if (!Metrics::global().write(config_.metricsPath)) {
+        std::cerr << "Cannot write the metrics " << config_.metricsPath << "." << std::endl;
+    }
+}
@@ -0,0 +1,162 @@
+#pragma once
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "EventLog.h"
+#include "NpcStrategy.h"
+#include "QueryService.h"
+#include "Scenario.h"
+#include "Snapshot.h"
+#include "TickScheduler.h"
+#include "TimeSeries.h"
+#include "World.h"
+
+#include <cstddef>
+#include <array>
+#include <cstdint>
+#include <string>
+
+class ShardLink;
+
+/**
+ * @brief How the population changes while the simulation runs.
+ */
+enum class PopulationMode {
+    Fixed, // The initial population is created up front; only NPCs open and close businesses afterwards
+    Ramp,  // One business and one NPC are added every tick on top of the initial population
+};
+
+/**
+ * @struct SimulationConfig
+ * @brief Options of a headless simulation run.
+ * Options come from the command line (--name value) or from a config file of name=value lines, with the same names.
+ */
+struct SimulationConfig {
+    std::uint32_t businesses = 100;    // Initial number of businesses
+    std::uint32_t npcs = 1000;         // Initial number of NPCs
+    std::uint32_t products = 8;        // Products of every initial business
+    std::uint32_t warmupTicks = 10;    // Ticks run before measuring
+    std::uint32_t ticks = 100;         // Measured steady-state ticks
+    std::uint64_t seed = 0;            // Run seed, drawn from the random device unless hasSeed
+    bool hasSeed = false;              // Set once a seed was given
+    std::size_t threads = 0;           // Threads running ticks, 0 uses every hardware thread
+    PopulationMode mode = PopulationMode::Fixed;
+    std::uint32_t candidates = 0;      // Businesses every NPC considers per tick, 0 for all of them
+    CandidateMode selection = CandidateMode::Price; // How the candidates are chosen
+    SchedulingMode scheduling = SchedulingMode::EveryTick; // Which entities every tick updates
+    std::array<double, STRATEGY_COUNT> strategies = {1.0}; // Share of the NPCs following every strategy
+    std::string logPath = "events.bin"; // Event log file
+    EventLevel logLevel = EventLevel::Off;
+    std::string restorePath;            // Snapshot to resume from instead of creating a population
+    std::string scenarioPath;           // Scenario generating the initial population, empty for the options above
+    std::string checkpointPath;         // Snapshot written during the run, empty for none
+    std::uint32_t checkpointEvery = 0;  // Ticks between checkpoints, 0 only writes one at the end
+    std::string seriesPath;             // Time series of the market state, empty for none
+    std::string metricsPath;            // Metrics file, JSON if it ends in .json, else Prometheus text; empty for none
+    std::uint32_t metricsEvery = 0;     // Ticks between metrics files, 0 only writes one at the end
+    std::uint32_t publishEvery = 0;     // Ticks between views published for queries, 0 for none
+    double watchSeconds = 0;            // Seconds between market reports printed while running, 0 for none
+    std::uint32_t shards = 0;           // Worker processes sharing the world, 0 runs it in this process
+
+    /**
+     * @brief Set one option.
+     * @param name The name of the option, without the leading dashes.
+     * @param value The value of the option.
+     * @return false if the option is unknown or the value is invalid.
+     */
+    bool set(const std::string& name, const std::string& value);
+
+    /**
+     * @brief Set every option of a config file; blank lines and lines starting with # are skipped.
+     * @param path The path of the config file.
+     * @return false if the file cannot be read or holds an invalid option.
+     */
+    bool load(const std::string& path);
+};
+
+/**
+ * @struct SimulationSummary
+ * @brief Throughput of the steady-state phase of a run, and the state of the market at its end.
+ */
+struct SimulationSummary {
+    std::uint64_t ticks = 0;           // Measured ticks
+    double seconds = 0;                // Wall time of the measured ticks
+    std::uint64_t entityUpdates = 0;   // Business and NPC updates
+    std::uint64_t trades = 0;          // Filled product purchases and stock orders
+    std::int64_t sharesTraded = 0;     // Shares that changed hands
+    std::size_t businesses = 0;        // Businesses at the end of the run
+    std::size_t npcs = 0;              // NPCs at the end of the run
+    double marketCap = 0;              // Market cap at the end of the run
+    double meanStockPrice = 0;         // Mean stock price at the end of the run
+    int topBusiness = 0;               // ID of the business with the highest stock price, 0 for none
+    double moneySupply = 0;            // Money held by NPCs and businesses at the end of the run
+    std::uint64_t unbalancedTicks = 0; // Ticks of the run, warm-up included, whose ledger audit failed
+    double setupSeconds = 0;           // Wall time of creating the initial population, 0 when restored
+
+    double ticksPerSecond() const noexcept { return ticks / seconds; }
+    double entityUpdatesPerSecond() const noexcept { return entityUpdates / seconds; }
+    double tradesPerSecond() const noexcept { return trades / seconds; }
+};
+
+/**
+ * @class Simulation
+ * @brief Headless driver: populates a world, warms it up, then measures a steady-state phase.
+ */
+class Simulation {
+  public:
+    /**
+     * @brief Create a simulation.
+     * @param config The options of the run.
+     * @param shard The shard this process runs, which only holds the NPCs it owns; nullptr for the whole world.
+     * The summary of a shard covers the whole sharded world.
+     */
+    explicit Simulation(const SimulationConfig& config, ShardLink* shard = nullptr);
+
+    /**
+     * @brief Resume from a snapshot instead of creating the initial population; restores the seed of the run.
+     * @param path The path of the snapshot.
+     * @return false if the snapshot cannot be loaded.
+     */
+    bool restore(const std::string& path);
+
+    /**
+     * @brief Generate the initial population from a scenario instead of the population options.
+     * @param path The path of the scenario file.
+     * @return false if the scenario cannot be loaded; scenario().errorLine() tells where.
+     */
+    bool loadScenario(const std::string& path);
+
+    const Scenario& scenario() const noexcept { return scenario_; }
+
+    /**
+     * @brief Run the warm-up and the steady-state phase.
+     * @return The throughput of the steady-state phase.
+     */
+    SimulationSummary run();
+
+    std::uint64_t nextTick() const noexcept { return nextTick_; } // Tick the next step runs
+
+    World& world() noexcept { return world_; }
+    QueryService& queries() noexcept { return queries_; } // Views of the market for other threads, if published
+
+  private:
+    void populate();  // Create the initial businesses and NPCs
+    void createNpc(std::uint64_t number); // Create the NPC of a creation number, with its share of the strategies
+    TickStats step(); // Run one tick, record it and write a checkpoint when one is due
+    void checkpoint(); // Write a snapshot of the world at the current tick boundary
+    void writeMetrics(); // Write the metrics file
+
+    SimulationConfig config_;
+    ShardLink* shard_;          // Shard of a sharded world, nullptr for a whole world
+    bool restored_ = false;     // Resumed from a snapshot
+    bool hasScenario_ = false;  // Populated from scenario_
+    Scenario scenario_;
+    std::uint64_t nextTick_ = 0;
+    std::uint64_t unbalancedTicks_ = 0; // Ticks whose ledger audit failed
+    World world_;
+    TickScheduler scheduler_;
+    TimeSeriesRecorder recorder_; // Open while running if a time series was requested
+    QueryService queries_;        // Publishes views of the world while running if publishEvery is set
+};
+
+#endif // SIMULATION_H
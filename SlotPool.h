@@ -0,0 +1,161 @@
+#pragma once
+#ifndef SLOT_POOL_H
+#define SLOT_POOL_H
+
+#include "Handle.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <utility>
+#include <vector>
+
+/**
+ * @class SlotPool
+ * @brief Slab storage for objects addressed by generational handles.
+ *
+ * Objects are constructed in place inside fixed-size chunks, so they never move and stay contiguous in slot order.
+ * Destroyed slots go to a free list and are reused by the next create(), which makes both operations O(1). Every
+ * destroy bumps the generation of the slot, turning the handles to the old object stale.
+ */
+template <class T> class SlotPool {
+  public:
+    SlotPool() = default;
+    SlotPool(const SlotPool&) = delete;
+    SlotPool& operator=(const SlotPool&) = delete;
+
+    ~SlotPool() {
+        for (std::uint32_t i = 0; i < slots_; ++i) {
+            if (alive_[i]) {
+                object(i)->~T();
+            }
+        }
+    }
+
+    /**
+     * @brief Construct an object in a free slot.
+     * @return The handle to the new object.
+     */
+    template <class... Args> Handle<T> create(Args&&... args) {
+        std::uint32_t index;
+        if (!free_.empty()) {
+            index = free_.back(); // Reuse the most recently freed slot, it is the most likely to be in cache
+            free_.pop_back();
+        } else {
+            index = slots_++;
+            if ((index >> CHUNK_SHIFT) == chunks_.size()) {
+                chunks_.emplace_back(new Storage[CHUNK_SIZE]); // Left uninitialized, objects are built in place
+            }
+            generations_.push_back(0);
+            alive_.push_back(0);
+        }
+        new (object(index)) T(std::forward<Args>(args)...);
+        alive_[index] = 1;
+        ++size_;
+        return {index, generations_[index]};
+    }
+
+    /**
+     * @brief Destroy an object and free its slot. Stale handles are ignored.
+     */
+    void destroy(Handle<T> handle) {
+        if (get(handle) == nullptr) {
+            return;
+        }
+        object(handle.index)->~T();
+        alive_[handle.index] = 0;
+        ++generations_[handle.index]; // Every handle to the old object is stale from now on
+        free_.push_back(handle.index);
+        --size_;
+    }
+
+    /**
+     * @brief Resolve a handle.
+     * @return The object, or nullptr if the handle is null or stale.
+     */
+    T* get(Handle<T> handle) noexcept {
+        return valid(handle) ? object(handle.index) : nullptr;
+    }
+
+    const T* get(Handle<T> handle) const noexcept {
+        return valid(handle) ? object(handle.index) : nullptr;
+    }
+
+    /**
+     * @brief Get the object living in a slot.
+     * @return The object, or nullptr if the slot is free.
+     */
+    T* at(std::uint32_t index) noexcept { return alive_[index] ? object(index) : nullptr; }
+
+    const T* at(std::uint32_t index) const noexcept { return alive_[index] ? object(index) : nullptr; }
+
+    Handle<T> handleAt(std::uint32_t index) const noexcept { return {index, generations_[index]}; }
+
+    std::uint32_t slots() const noexcept { return slots_; } // Number of slots ever used, the bound of at()
+    std::span<const std::uint32_t> freeSlots() const noexcept { return free_; } // Free list, last entry reused first
+    std::size_t size() const noexcept { return size_; }     // Number of live objects
+
+    /**
+     * @brief Make room for a number of slots up front.
+     */
+    void reserve(std::size_t count) {
+        generations_.reserve(count);
+        alive_.reserve(count);
+        while (chunks_.size() * CHUNK_SIZE < count) {
+            chunks_.emplace_back(new Storage[CHUNK_SIZE]); // Left uninitialized, objects are built in place
+        }
+    }
+
+    /**
+     * @brief Give an empty pool the slot layout of another pool, so handles to the other pool resolve here.
+     * Every slot starts free; live objects are then placed with createAt().
+     * @param generations The generation of every slot.
+     * @param freeSlots The free list, excluding the slots createAt() will fill.
+     */
+    void restore(std::span<const std::uint32_t> generations, std::span<const std::uint32_t> freeSlots) {
+        slots_ = static_cast<std::uint32_t>(generations.size());
+        reserve(slots_);
+        generations_.assign(generations.begin(), generations.end());
+        alive_.assign(slots_, 0);
+        free_.assign(freeSlots.begin(), freeSlots.end());
+    }
+
+    /**
+     * @brief Construct an object in a given slot of a restored pool, keeping the slot's generation.
+     * @return The new object.
+     */
+    template <class... Args> T* createAt(std::uint32_t index, Args&&... args) {
+        T* created = new (object(index)) T(std::forward<Args>(args)...);
+        alive_[index] = 1;
+        ++size_;
+        return created;
+    }
+
+  private:
+    static constexpr std::uint32_t CHUNK_SHIFT = 12; // 4096 objects per chunk
+    static constexpr std::uint32_t CHUNK_SIZE = 1u << CHUNK_SHIFT;
+
+    struct Storage {
+        alignas(T) unsigned char bytes[sizeof(T)];
+    };
+
+    bool valid(Handle<T> handle) const noexcept {
+        return handle.index < slots_ && alive_[handle.index] && generations_[handle.index] == handle.generation;
+    }
+
+    T* object(std::uint32_t index) const noexcept {
+        Storage& storage = chunks_[index >> CHUNK_SHIFT][index & (CHUNK_SIZE - 1)];
+        return std::launder(reinterpret_cast<T*>(storage.bytes));
+    }
+
+    std::vector<std::unique_ptr<Storage[]>> chunks_; // Object storage, chunks never move
+    std::vector<std::uint32_t> generations_;          // Generation of every slot
+    std::vector<std::uint8_t> alive_;                 // Whether every slot holds an object
+    std::vector<std::uint32_t> free_;                 // Free slots, reused last-in first-out
+    std::uint32_t slots_ = 0;                         // Number of slots ever used
+    std::size_t size_ = 0;                            // Number of live objects
+};
+
+#endif // SLOT_POOL_H
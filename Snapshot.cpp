@@ -0,0 +1,467 @@
+#include "Snapshot.h"
+#include "BusinessIdAllocator.h"
+#include "MappedFile.h"
+#include "ProductCatalog.h"
+#include "Random.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+enum Section : std::uint32_t {
+    Strings,             // char: every name, referenced by StringRef
+    ProductNames,        // StringRef: catalog names by ProductId
+    BusinessGenerations, // uint32: generation of every business slot
+    BusinessFreeSlots,   // uint32: free list of the business pool
+    Businesses,          // BusinessRecord, in slot order
+    RowProducts,         // ProductId: product rows of every business, in business order
+    RowPrices,           // double
+    RowInitialPrices,    // double
+    RowSupply,           // int32
+    RowDemand,           // double
+    RowResupplyRates,    // double
+    NpcGenerations,      // uint32: generation of every NPC slot
+    NpcFreeSlots,        // uint32: free list of the NPC pool
+    Npcs,                // NpcRecord, in slot order
+    OwnedBusinesses,     // OwnedRecord: businesses founded by every NPC, in NPC order
+    Holdings,            // HoldingRecord: portfolio of every NPC, in NPC order
+    SECTION_COUNT,
+};
+
+struct SectionEntry {
+    std::uint64_t offset = 0; // From the start of the file, 8-byte aligned
+    std::uint64_t count = 0;  // Number of records
+};
+
+struct Header {
+    char magic[8] = {'E', 'C', 'O', 'S', 'N', 'A', 'P', '\0'};
+    std::uint32_t version = Snapshot::VERSION;
+    std::uint32_t byteOrder = 0x01020304; // Reads back differently on a machine of the other byte order
+    std::uint64_t fileSize = 0;
+    std::uint64_t seed = 0;
+    std::uint64_t nextTick = 0;
+    std::uint64_t businessesCreated = 0; // Business IDs handed out, the allocator continues from there
+    std::uint64_t npcsCreated = 0;       // Numbers the next NPC
+    SectionEntry sections[SECTION_COUNT];
+};
+
+struct StringRef {
+    std::uint64_t offset; // In the Strings section
+    std::uint64_t length;
+};
+
+struct HandleRecord {
+    std::uint32_t index;
+    std::uint32_t generation;
+};
+
+struct BusinessRecord {
+    std::uint32_t index; // Slot in the pool
+    std::int32_t id;
+    double stockPrice;
+    std::int64_t balance; // Cents
+    double stockDemand;
+    std::int64_t sharesOutstanding;
+    std::int32_t score;
+    std::uint32_t rowCount;
+    std::uint64_t rowOffset; // First row in the Row* sections
+    StringRef name;
+    StringRef description;
+};
+
+struct NpcRecord {
+    std::uint32_t index; // Slot in the pool
+    std::int32_t score;
+    std::uint64_t id;
+    std::int64_t balance;        // Cents
+    std::int64_t savingsAccount; // Cents
+    StringRef name;
+    std::uint64_t ownedOffset;    // In the OwnedBusinesses section
+    std::uint64_t holdingsOffset; // In the Holdings section
+    std::uint32_t ownedCount;
+    std::uint32_t holdingsCount;
+    std::uint32_t strategy; // StrategyId
+    std::uint32_t reserved; // Padding, always 0
+};
+
+struct OwnedRecord {
+    HandleRecord business;
+    std::uint64_t nameHash;
+};
+
+struct HoldingRecord {
+    HandleRecord business;
+    double shares;
+    double costBasis;
+};
+
+/**
+ * @brief Writes sections one after the other, keeping them aligned.
+ */
+class SectionWriter {
+  public:
+    explicit SectionWriter(std::FILE* file) : file_(file) {}
+
+    void begin(Header& header, Section section) {
+        static const char padding[8] = {};
+        std::size_t pad = (8 - position_ % 8) % 8;
+        put(padding, pad);
+        header.sections[section].offset = position_;
+        section_ = &header.sections[section];
+    }
+
+    template <class T> void write(std::span<const T> records) {
+        static_assert(std::is_trivially_copyable_v<T>, "Sections hold raw records");
+        put(records.data(), records.size_bytes());
+        section_->count += records.size();
+    }
+
+    template <class T> void write(const T& record) { write(std::span<const T>(&record, 1)); }
+
+    void put(const void* data, std::size_t bytes) {
+        if (bytes != 0 && std::fwrite(data, 1, bytes, file_) != bytes) {
+            failed_ = true;
+        }
+        position_ += bytes;
+    }
+
+    std::uint64_t position() const noexcept { return position_; }
+    bool failed() const noexcept { return failed_; }
+
+  private:
+    std::FILE* file_;
+    std::uint64_t position_ = 0;
+    SectionEntry* section_ = nullptr;
+    bool failed_ = false;
+};
+
+/**
+ * @brief Hands out consecutive StringRefs in the order the names are written to the Strings section.
+ */
+class StringCursor {
+  public:
+    StringRef next(std::string_view text) {
+        StringRef ref{offset_, text.size()};
+        offset_ += text.size();
+        return ref;
+    }
+
+  private:
+    std::uint64_t offset_ = 0;
+};
+
+template <class T> std::vector<std::uint32_t> generationsOf(const SlotPool<T>& pool) {
+    std::vector<std::uint32_t> generations(pool.slots());
+    for (std::uint32_t i = 0; i < pool.slots(); ++i) {
+        generations[i] = pool.handleAt(i).generation;
+    }
+    return generations;
+}
+
+/**
+ * @brief Read-only view of the sections of a mapped snapshot.
+ */
+class SectionReader {
+  public:
+    SectionReader(const MappedFile& file, const Header& header) : file_(file), header_(header) {}
+
+    template <class T> std::span<const T> get(Section section) const {
+        const SectionEntry& entry = header_.sections[section];
+        return {reinterpret_cast<const T*>(file_.data() + entry.offset), static_cast<std::size_t>(entry.count)};
+    }
+
+    template <class T> bool valid(Section section) const {
+        const SectionEntry& entry = header_.sections[section];
+        return entry.offset % alignof(T) == 0 && entry.offset <= file_.size() &&
+               entry.count <= (file_.size() - entry.offset) / sizeof(T);
+    }
+
+  private:
+    const MappedFile& file_;
+    const Header& header_;
+};
+
+} // namespace
+
+bool Snapshot::save(const World& world, const std::string& path, std::uint64_t nextTick) {
+    std::string temporary = path + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (file == nullptr) {
+        return false; // Cannot create the file
+    }
+
+    const SlotPool<Business>& businesses = world.businesses();
+    const SlotPool<Npc>& npcs = world.npcs();
+    const ProductCatalog& catalog = ProductCatalog::global();
+
+    Header header;
+    header.seed = RandomService::global().seed();
+    header.nextTick = nextTick;
+    header.businessesCreated = BusinessIdAllocator::global().allocated();
+    header.npcsCreated = Npc::created_;
+
+    SectionWriter out(file);
+    out.put(&header, sizeof(header)); // Placeholder, rewritten once the sections are known
+
+    // Names, in the order the StringCursors below hand out their references
+    out.begin(header, Strings);
+    std::size_t productCount = catalog.size();
+    for (ProductId id = 0; id < productCount; ++id) {
+        const std::string& name = catalog.name(id);
+        out.put(name.data(), name.size());
+    }
+    for (std::uint32_t i = 0; i < businesses.slots(); ++i) {
+        if (const Business* business = businesses.at(i)) {
+            out.put(business->name().data(), business->name().size());
+            out.put(business->description().data(), business->description().size());
+        }
+    }
+    for (std::uint32_t i = 0; i < npcs.slots(); ++i) {
+        if (const Npc* npc = npcs.at(i)) {
+            out.put(npc->name().data(), npc->name().size());
+        }
+    }
+    header.sections[Strings].count = out.position() - header.sections[Strings].offset;
+
+    StringCursor strings;
+    out.begin(header, ProductNames);
+    for (ProductId id = 0; id < productCount; ++id) {
+        out.write(strings.next(catalog.name(id)));
+    }
+
+    // Businesses; their rows are written column by column in the same order
+    out.begin(header, BusinessGenerations);
+    out.write(std::span<const std::uint32_t>(generationsOf(businesses)));
+    out.begin(header, BusinessFreeSlots);
+    out.write(businesses.freeSlots());
+
+    out.begin(header, Businesses);
+    std::uint64_t rows = 0;
+    for (std::uint32_t i = 0; i < businesses.slots(); ++i) {
+        if (const Business* business = businesses.at(i)) {
+            std::uint32_t count = static_cast<std::uint32_t>(business->table_->count(business->slot_));
+            StringRef name = strings.next(business->name());
+            StringRef description = strings.next(business->description());
+            out.write(BusinessRecord{i, business->ID, business->stockPrice_, business->balance_.cents(),
+                                     business->stockDemand_, business->sharesOutstanding_, business->score_, count,
+                                     rows, name, description});
+            rows += count;
+        }
+    }
+
+    auto writeColumn = [&](Section section, auto column) {
+        out.begin(header, section);
+        for (std::uint32_t i = 0; i < businesses.slots(); ++i) {
+            if (const Business* business = businesses.at(i)) {
+                out.write(column(*business->table_, business->slot_));
+            }
+        }
+    };
+    using Table = const ProductTable&;
+    using Slot = ProductTable::Slot;
+    writeColumn(RowProducts, [](Table table, Slot slot) { return table.products(slot); });
+    writeColumn(RowPrices, [](Table table, Slot slot) { return table.prices(slot); });
+    writeColumn(RowInitialPrices, [](Table table, Slot slot) { return table.initialPrices(slot); });
+    writeColumn(RowSupply, [](Table table, Slot slot) { return table.supply(slot); });
+    writeColumn(RowDemand, [](Table table, Slot slot) { return table.demand(slot); });
+    writeColumn(RowResupplyRates, [](Table table, Slot slot) { return table.resupplyRates(slot); });
+
+    // NPCs; their portfolios are written section by section in the same order
+    out.begin(header, NpcGenerations);
+    out.write(std::span<const std::uint32_t>(generationsOf(npcs)));
+    out.begin(header, NpcFreeSlots);
+    out.write(npcs.freeSlots());
+
+    out.begin(header, Npcs);
+    std::uint64_t owned = 0;
+    std::uint64_t holdings = 0;
+    for (std::uint32_t i = 0; i < npcs.slots(); ++i) {
+        if (const Npc* npc = npcs.at(i)) {
+            NpcRecord record{i, npc->score_, npc->id_, npc->balance_.cents(), npc->savingsAccount_.cents(),
+                             strings.next(npc->name()), owned, holdings,
+                             static_cast<std::uint32_t>(npc->owned().size()),
+                             static_cast<std::uint32_t>(npc->portfolio_.size()),
+                             static_cast<std::uint32_t>(npc->strategy_), 0};
+            out.write(record);
+            owned += record.ownedCount;
+            holdings += record.holdingsCount;
+        }
+    }
+
+    out.begin(header, OwnedBusinesses);
+    for (std::uint32_t i = 0; i < npcs.slots(); ++i) {
+        if (const Npc* npc = npcs.at(i)) {
+            for (const Npc::OwnedBusiness& business : npc->owned()) {
+                out.write(OwnedRecord{{business.business.index, business.business.generation}, business.nameHash});
+            }
+        }
+    }
+    out.begin(header, Holdings);
+    for (std::uint32_t i = 0; i < npcs.slots(); ++i) {
+        if (const Npc* npc = npcs.at(i)) {
+            for (const Holding& holding : npc->portfolio_.holdings()) {
+                out.write(HoldingRecord{{holding.business.index, holding.business.generation}, holding.shares,
+                                        holding.costBasis});
+            }
+        }
+    }
+
+    header.fileSize = out.position();
+    bool written = !out.failed() && std::fseek(file, 0, SEEK_SET) == 0 &&
+                   std::fwrite(&header, sizeof(header), 1, file) == 1;
+    written = std::fclose(file) == 0 && written;
+    if (!written) {
+        std::remove(temporary.c_str());
+        return false; // Disk full or I/O error, the previous snapshot is left alone
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error); // Replaces the previous snapshot in one step
+    return !error;
+}
+
+bool Snapshot::load(World& world, const std::string& path, std::uint64_t& nextTick) {
+    MappedFile file;
+    if (!file.open(path) || file.size() < sizeof(Header)) {
+        return false; // Missing or truncated
+    }
+    Header header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    Header expected;
+    if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != VERSION ||
+        header.byteOrder != expected.byteOrder || header.fileSize != file.size()) {
+        return false; // Not a snapshot, or written by an incompatible build
+    }
+
+    SectionReader in(file, header);
+    if (!in.valid<char>(Strings) || !in.valid<StringRef>(ProductNames) ||
+        !in.valid<std::uint32_t>(BusinessGenerations) || !in.valid<std::uint32_t>(BusinessFreeSlots) ||
+        !in.valid<BusinessRecord>(Businesses) || !in.valid<ProductId>(RowProducts) ||
+        !in.valid<double>(RowPrices) || !in.valid<double>(RowInitialPrices) || !in.valid<int>(RowSupply) ||
+        !in.valid<double>(RowDemand) || !in.valid<double>(RowResupplyRates) ||
+        !in.valid<std::uint32_t>(NpcGenerations) || !in.valid<std::uint32_t>(NpcFreeSlots) ||
+        !in.valid<NpcRecord>(Npcs) || !in.valid<OwnedRecord>(OwnedBusinesses) || !in.valid<HoldingRecord>(Holdings)) {
+        return false; // A section points outside the file
+    }
+    if (world.businesses().size() != 0 || world.npcs().size() != 0) {
+        return false; // Only an empty world can take the saved slot layout
+    }
+
+    std::span<const char> strings = in.get<char>(Strings);
+    auto text = [&](const StringRef& ref) {
+        return ref.offset <= strings.size() && ref.length <= strings.size() - ref.offset
+                   ? std::string_view(strings.data() + ref.offset, ref.length)
+                   : std::string_view();
+    };
+
+    // Products keep their IDs when the catalog is fresh; otherwise the rows are translated to the running catalog
+    std::span<const StringRef> productNames = in.get<StringRef>(ProductNames);
+    std::vector<ProductId> productIds(productNames.size());
+    bool sameIds = true;
+    for (ProductId id = 0; id < productNames.size(); ++id) {
+        productIds[id] = ProductCatalog::global().intern(text(productNames[id]));
+        sameIds = sameIds && productIds[id] == id;
+    }
+
+    std::span<const BusinessRecord> businessRecords = in.get<BusinessRecord>(Businesses);
+    std::span<const ProductId> products = in.get<ProductId>(RowProducts);
+    std::span<const double> prices = in.get<double>(RowPrices);
+    std::span<const double> initialPrices = in.get<double>(RowInitialPrices);
+    std::span<const int> supply = in.get<int>(RowSupply);
+    std::span<const double> demand = in.get<double>(RowDemand);
+    std::span<const double> resupplyRates = in.get<double>(RowResupplyRates);
+    std::size_t rowCount = products.size();
+    if (prices.size() != rowCount || initialPrices.size() != rowCount || supply.size() != rowCount ||
+        demand.size() != rowCount || resupplyRates.size() != rowCount) {
+        return false; // Columns of different lengths
+    }
+
+    SlotPool<Business>& businesses = world.businesses();
+    std::span<const std::uint32_t> businessGenerations = in.get<std::uint32_t>(BusinessGenerations);
+    businesses.restore(businessGenerations, in.get<std::uint32_t>(BusinessFreeSlots));
+    std::vector<ProductId> translated;
+    for (const BusinessRecord& record : businessRecords) {
+        if (record.index >= businessGenerations.size() || businesses.at(record.index) != nullptr ||
+            record.rowOffset > rowCount || record.rowCount > rowCount - record.rowOffset) {
+            return false; // Corrupt record; the businesses restored so far are destroyed with the world
+        }
+        Business* business =
+            businesses.createAt(record.index, text(record.name), text(record.description), ProductTable::market(),
+                                record.id);
+        business->handle_ = businesses.handleAt(record.index);
+        business->aggregates_ = &world.aggregates_;
+        world.businessIds_.emplace(record.id, business->handle_);
+        business->stockPrice_ = record.stockPrice;
+        business->balance_ = Money::fromCents(record.balance);
+        business->stockDemand_ = record.stockDemand;
+        business->sharesOutstanding_ = record.sharesOutstanding;
+        business->score_ = record.score;
+
+        std::size_t row = record.rowOffset;
+        std::size_t count = record.rowCount;
+        std::span<const ProductId> rowProducts = products.subspan(row, count);
+        if (!sameIds) {
+            translated.clear();
+            for (ProductId id : rowProducts) {
+                translated.push_back(id < productIds.size() ? productIds[id] : INVALID_PRODUCT);
+            }
+            rowProducts = translated;
+        }
+        business->table_->insert(business->slot_,
+                                 {rowProducts, prices.subspan(row, count), initialPrices.subspan(row, count),
+                                  supply.subspan(row, count), demand.subspan(row, count),
+                                  resupplyRates.subspan(row, count)});
+    }
+
+    std::span<const NpcRecord> npcRecords = in.get<NpcRecord>(Npcs);
+    std::span<const OwnedRecord> owned = in.get<OwnedRecord>(OwnedBusinesses);
+    std::span<const HoldingRecord> holdings = in.get<HoldingRecord>(Holdings);
+
+    SlotPool<Npc>& npcs = world.npcs();
+    std::vector<Holding> portfolio;
+    std::span<const std::uint32_t> npcGenerations = in.get<std::uint32_t>(NpcGenerations);
+    npcs.restore(npcGenerations, in.get<std::uint32_t>(NpcFreeSlots));
+    for (const NpcRecord& record : npcRecords) {
+        if (record.index >= npcGenerations.size() || npcs.at(record.index) != nullptr ||
+            record.ownedOffset > owned.size() || record.ownedCount > owned.size() - record.ownedOffset ||
+            record.holdingsOffset > holdings.size() ||
+            record.holdingsCount > holdings.size() - record.holdingsOffset || record.strategy >= STRATEGY_COUNT) {
+            return false; // Corrupt record
+        }
+        Npc* npc = npcs.createAt(record.index, text(record.name));
+        npc->handle_ = npcs.handleAt(record.index);
+        npc->id_ = record.id;
+        npc->score_ = record.score;
+        npc->balance_ = Money::fromCents(record.balance);
+        npc->savingsAccount_ = Money::fromCents(record.savingsAccount);
+        npc->strategy_ = static_cast<StrategyId>(record.strategy);
+
+        for (const OwnedRecord& business : owned.subspan(record.ownedOffset, record.ownedCount)) {
+            BusinessHandle handle{business.business.index, business.business.generation};
+            npc->ownedList().push_back({business.nameHash, handle});
+        }
+        portfolio.clear();
+        for (const HoldingRecord& holding : holdings.subspan(record.holdingsOffset, record.holdingsCount)) {
+            portfolio.push_back({{holding.business.index, holding.business.generation}, holding.shares,
+                                 holding.costBasis});
+        }
+        npc->portfolio_.assign(portfolio);
+    }
+
+    world.aggregates_.rebuild(world); // Restored rows bypass the hooks of Business
+    world.ledger_.rebuild();          // Restored balances bypass the ledger
+    BusinessIdAllocator::global().restore(header.businessesCreated);
+    Npc::created_ = header.npcsCreated; // Constructing the restored NPCs advanced the counter
+    RandomService::global().seed(header.seed);
+    nextTick = header.nextTick;
+    return true;
+}
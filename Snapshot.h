@@ -0,0 +1,48 @@
+#pragma once
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "World.h"
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @class Snapshot
+ * @brief Binary checkpoint of a complete simulation, taken at a tick boundary.
+ *
+ * A snapshot holds the businesses with their product rows, the NPCs with their balances, portfolios and strategies,
+ * the slot layout of both pools (so saved handles stay valid), the product catalog, and the random state (seed, next
+ * tick and the creation counters that number new businesses and NPCs). Balances are saved in cents; the system
+ * account of the ledger is rebuilt from them on load, since money is conserved at a tick boundary.
+ *
+ * The file is a header followed by flat, 8-byte aligned sections of fixed-size records, addressed by offsets from
+ * the start of the file. It holds no pointers, so it can be moved and copied freely, and it is loaded through a
+ * memory mapping: records are read in place and product columns are copied in bulk, without per-object parsing.
+ * A snapshot is only read back by a build with the same version and byte order.
+ */
+class Snapshot {
+  public:
+    static constexpr std::uint32_t VERSION = 5;
+
+    /**
+     * @brief Save a world. The file is written next to the target and renamed over it once complete, so a crash
+     * while saving leaves the previous snapshot intact.
+     * @param world The world to save; it must be at a tick boundary.
+     * @param path The path of the snapshot.
+     * @param nextTick The tick the simulation continues with.
+     * @return false if the file cannot be written.
+     */
+    static bool save(const World& world, const std::string& path, std::uint64_t nextTick);
+
+    /**
+     * @brief Load a snapshot into an empty world and restore the random state of the run.
+     * @param world The world to load into; it must be empty.
+     * @param path The path of the snapshot.
+     * @param nextTick Set to the tick the simulation continues with.
+     * @return false if the file cannot be read, is not a snapshot or was written by an incompatible build.
+     */
+    static bool load(World& world, const std::string& path, std::uint64_t& nextTick);
+};
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,134 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+thread_local std::size_t participantIndex = 0; // Index of this thread in the loop it runs
+
+// Makes the caller of a loop participant 0, even if it is a worker of another pool
+class CallerScope {
+  public:
+    CallerScope() noexcept : outer_(participantIndex) { participantIndex = 0; }
+    ~CallerScope() { participantIndex = outer_; }
+    CallerScope(const CallerScope&) = delete;
+    CallerScope& operator=(const CallerScope&) = delete;
+
+  private:
+    std::size_t outer_;
+};
+
+} // namespace
+
+ThreadPool::ThreadPool(std::size_t threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency()); // Use every hardware thread by default
+    }
+    for (std::size_t i = 0; i < threads; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (std::size_t i = 1; i < threads; ++i) {
+        threads_.emplace_back(&ThreadPool::workerLoop, this, i); // The caller acts as participant 0
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+std::size_t ThreadPool::participant() noexcept {
+    return participantIndex;
+}
+
+void ThreadPool::parallelFor(std::size_t count, std::size_t grain, const Body& body) {
+    if (count == 0) {
+        return;
+    }
+    CallerScope caller;
+    if (grain == 0) {
+        grain = std::max<std::size_t>(1, count / (queues_.size() * 8)); // Several chunks per thread to steal from
+    }
+    if (threads_.empty() || count <= grain) {
+        body(0, count); // Not worth waking anyone
+        return;
+    }
+
+    std::size_t chunks = (count + grain - 1) / grain;
+    pending_.store(chunks, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < chunks; ++i) {
+        Queue& queue = *queues_[i % queues_.size()]; // Deal the chunks round-robin
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.chunks.push_back({i * grain, std::min(count, (i + 1) * grain), &body});
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    runChunks(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return pending_.load(std::memory_order_acquire) == 0; });
+}
+
+void ThreadPool::workerLoop(std::size_t index) {
+    participantIndex = index;
+    std::uint64_t seen = 0; // Last loop this worker woke up for
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+            if (stopping_) {
+                return;
+            }
+            seen = generation_;
+        }
+        runChunks(index);
+    }
+}
+
+void ThreadPool::runChunks(std::size_t index) {
+    Chunk chunk;
+    while (pop(index, chunk) || steal(index, chunk)) {
+        (*chunk.body)(chunk.begin, chunk.end);
+        if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(mutex_); // Pairs with the predicate check of the waiting caller
+            done_.notify_all();
+        }
+    }
+}
+
+bool ThreadPool::pop(std::size_t index, Chunk& chunk) {
+    Queue& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.chunks.empty()) {
+        return false;
+    }
+    chunk = queue.chunks.back(); // Newest chunk first, it is the most likely to still be in cache
+    queue.chunks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(std::size_t index, Chunk& chunk) {
+    for (std::size_t i = 1; i < queues_.size(); ++i) {
+        Queue& victim = *queues_[(index + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.chunks.empty()) {
+            chunk = victim.chunks.front(); // Oldest chunk, away from where the owner is working
+            victim.chunks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class ThreadPool
+ * @brief Fixed set of worker threads running parallel loops with work stealing.
+ * A loop is cut into chunks that are dealt round-robin to one deque per participant. Each participant pops
+ * chunks from the back of its own deque and, once it runs dry, steals from the front of the others, so uneven
+ * chunks (an NPC with a large portfolio, a business with many products) do not leave threads idle.
+ */
+class ThreadPool {
+  public:
+    using Body = std::function<void(std::size_t begin, std::size_t end)>;
+
+    /**
+     * @brief Start the pool.
+     * @param threads The number of threads running loops, including the caller; 0 uses every hardware thread.
+     */
+    explicit ThreadPool(std::size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t size() const noexcept { return queues_.size(); } // Number of threads running loops
+
+    /**
+     * @brief Get the index of the calling thread in the loop it runs: 0 for the caller of parallelFor(), 1 to
+     * size() - 1 for the workers. Loop bodies use it to pick per-thread storage without locking.
+     */
+    static std::size_t participant() noexcept;
+
+    /**
+     * @brief Run body over [0, count) in parallel and wait for it to finish.
+     * The calling thread takes part in the loop.
+     * @param count The number of iterations.
+     * @param grain The number of iterations per chunk; 0 picks a size giving every thread several chunks.
+     * @param body Called with the [begin, end) range of every chunk.
+     */
+    void parallelFor(std::size_t count, std::size_t grain, const Body& body);
+
+  private:
+    struct Chunk {
+        std::size_t begin;
+        std::size_t end;
+        const Body* body; // Loop the chunk belongs to
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Chunk> chunks;
+    };
+
+    void workerLoop(std::size_t index); // Body of every worker thread
+    void runChunks(std::size_t index);  // Drain the own queue, then steal, until no chunk is left
+    bool pop(std::size_t index, Chunk& chunk);
+    bool steal(std::size_t index, Chunk& chunk);
+
+    std::vector<std::unique_ptr<Queue>> queues_; // One per participant, the caller uses queue 0
+    std::vector<std::thread> threads_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_; // Signals workers that a loop was posted or the pool stops
+    std::condition_variable done_; // Signals the caller that the last chunk finished
+    std::uint64_t generation_ = 0; // Incremented for every posted loop
+    bool stopping_ = false;
+    std::atomic<std::size_t> pending_ = 0; // Chunks of the current loop that have not finished
+};
+
+#endif // THREAD_POOL_H
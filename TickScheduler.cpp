@@ -0,0 +1,602 @@
+#include "TickScheduler.h"
+#include "Metrics.h"
+#include "Random.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Records of the batches sharded ticks exchange
+struct PurchaseMessage {
+    std::uint64_t npc; // Creation number of the buyer
+    std::uint32_t business;
+    ProductId product;
+    int amount;
+};
+
+struct OrderMessage {
+    std::uint64_t npc; // Creation number of the NPC placing the order
+    StockOrder order;
+};
+
+struct ActionMessage {
+    std::uint64_t npc;        // Creation number of the NPC founding or closing a business
+    BusinessHandle sell;      // Business closed, null if none
+    std::uint32_t nameLength; // Length of the name of the founded business, which follows the record
+    std::uint8_t founds;      // Whether a business is founded
+};
+
+} // namespace
+
+TickScheduler::TickScheduler(std::size_t threads) : pool_(threads), intents_(pool_.size()) {}
+
+TickStats TickScheduler::tick(World& world) {
+    SlotPool<Business>& businesses = world.businesses();
+    SlotPool<Npc>& npcs = world.npcs();
+
+    PhaseTimer tickTimer(Phase::Tick);
+    TickStats stats;
+    std::uint64_t now = RandomService::global().tick();
+    for (IntentBuffer& buffer : intents_) {
+        buffer.clear(); // Keeps the capacity of the last ticks
+    }
+    std::size_t accrued = 0; // Interest transfers applied before the decisions
+    if (scheduling_ == SchedulingMode::Events) {
+        accrued = collectDue(world, now);
+        stats.businessUpdates = dueBusinesses_.size();
+    } else {
+        world.clearCreated(); // Only the event-driven mode needs them
+        npcSlots_.clear();
+        for (std::uint32_t n = 0; n < npcs.slots(); ++n) {
+            if (npcs.at(n) != nullptr) {
+                npcSlots_.push_back(n);
+            }
+        }
+        stats.businessUpdates = businesses.size();
+    }
+    stats.npcUpdates = npcSlots_.size();
+
+    // Phase 1: businesses only touch their own state
+    PhaseTimer businessTimer(Phase::Businesses);
+    if (scheduling_ == SchedulingMode::Events) {
+        updateDue(world, now);
+    } else if (sweepsProducts(world)) {
+        updateBusinesses(world);
+        world.aggregates().markProducts(); // The sweep rewrote every row of the market table
+    } else {
+        pool_.parallelFor(businesses.slots(), 0, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t b = begin; b < end; ++b) {
+                if (Business* business = businesses.at(b)) {
+                    business->update();
+                }
+            }
+        });
+    }
+    candidates_.prepare(world);
+    businessTimer.stop();
+
+    // Phase 2: NPCs decide against the frozen businesses, every strategy group in its own statically bound loop
+    PhaseTimer decideTimer(Phase::Decide);
+    groupNpcs(world);
+    npcIntents_.resize(npcs.slots());
+    pool_.parallelFor(grouped_.size(), 0, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t g = 0; g < STRATEGY_COUNT; ++g) {
+            std::size_t from = std::max(begin, groupStart_[g]);
+            std::size_t to = std::min(end, groupStart_[g + 1]);
+            if (from < to) {
+                visitStrategy(static_cast<StrategyId>(g), [&](auto strategy) {
+                    decideGroup<decltype(strategy)>(world, from, to);
+                });
+            }
+        }
+    });
+    if (scheduling_ == SchedulingMode::Events) {
+        scheduleNpcs(world, now);
+    }
+    decideTimer.stop();
+
+    // Phase 3: every business commits its own purchases; orders enter the books tagged with the NPC's slot
+    PhaseTimer purchaseTimer(Phase::Purchases);
+    if (shard_ != nullptr) {
+        exchangeIntents(world); // The businesses commit the purchases and orders of every shard
+    }
+    groupPurchases(world);
+    std::atomic<std::size_t> purchases = 0;
+    pool_.parallelFor(businesses.slots(), 0, [&](std::size_t begin, std::size_t end) {
+        std::size_t filled = 0;
+        for (std::size_t b = begin; b < end; ++b) {
+            for (std::size_t i = businessStart_[b]; i < businessStart_[b + 1]; ++i) {
+                PurchaseIntent& purchase = *byBusiness_[i];
+                purchase.result = businesses.at(b)->sellProduct(purchase.product, purchase.amount);
+                filled += purchase.result == PurchaseResult::Filled;
+            }
+        }
+        purchases.fetch_add(filled, std::memory_order_relaxed);
+    });
+    stats.purchases = purchases.load(std::memory_order_relaxed);
+    purchaseTimer.stop();
+    PhaseTimer orderTimer(Phase::Orders);
+    auctions_.clear();
+    auto submit = [&](const StockOrder& order, std::uint64_t owner) {
+        OrderBook& book = world.business(order.business)->orderBook();
+        if (book.size() == 0) {
+            auctions_.push_back(order.business.index); // First order of the book this tick
+        }
+        book.submit(order, owner);
+    };
+    if (shard_ == nullptr) {
+        for (std::uint32_t n : npcSlots_) {
+            for (const auto& order : ordersOf(n)) {
+                submit(order, n);
+            }
+        }
+    } else {
+        for (const SharedOrder& shared : sharedOrders_) {
+            submit(shared.order, shared.owner);
+        }
+    }
+    std::sort(auctions_.begin(), auctions_.end());
+    orderTimer.stop();
+
+    // Phase 4: every business with orders clears its own order book; an empty auction never trades
+    PhaseTimer auctionTimer(Phase::Auctions);
+    std::atomic<std::int64_t> shares = 0;
+    pool_.parallelFor(auctions_.size(), 0, [&](std::size_t begin, std::size_t end) {
+        std::int64_t volume = 0;
+        for (std::size_t i = begin; i < end; ++i) {
+            volume += businesses.at(auctions_[i])->auction().volume;
+        }
+        shares.fetch_add(volume, std::memory_order_relaxed);
+    });
+    stats.sharesTraded = shares.load(std::memory_order_relaxed);
+    auctionTimer.stop();
+
+    // Phase 5: NPCs settle their own purchases and orders
+    PhaseTimer settleTimer(Phase::Settle);
+    stats.stockTrades = groupFills(world);
+    pool_.parallelFor(npcSlots_.size(), 0, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            std::uint32_t n = npcSlots_[i];
+            std::span<const StockFill> fills(byNpc_.data() + npcStart_[n], npcStart_[n + 1] - npcStart_[n]);
+            npcs.at(n)->settle(world, purchasesOf(n), fills, intents_[ThreadPool::participant()].journal);
+        }
+    });
+    settleTimer.stop();
+    PhaseTimer ledgerTimer(Phase::Ledger); // The payments of the tick move in one batch, account by account
+    Ledger& ledger = world.ledger();
+    if (shard_ != nullptr) {
+        exchangeTransfers(world); // Keeps the balances of the businesses identical on every shard
+    }
+    for (const IntentBuffer& buffer : intents_) {
+        ledger.post(buffer.journal);
+    }
+    stats.transfers = accrued + ledger.apply();
+    stats.balanced = ledger.audit().balanced();
+    ledgerTimer.stop();
+
+    // Phase 6: structural changes to the market are applied serially, in NPC order
+    PhaseTimer restructureTimer(Phase::Restructure);
+    if (shard_ == nullptr) {
+        for (std::uint32_t n : npcSlots_) {
+            npcs.at(n)->restructure(world);
+        }
+    } else {
+        exchangeRestructures(world);
+    }
+    restructureTimer.stop();
+    if (shard_ != nullptr) {
+        stats.balanced = shard_->allReduce(stats.balanced ? 0 : 1) == 0; // Every shard finished the tick
+    }
+
+    Metrics::count(Counter::BusinessUpdates, stats.businessUpdates);
+    Metrics::count(Counter::NpcUpdates, stats.npcUpdates);
+    return stats;
+}
+
+void TickScheduler::setScheduling(SchedulingMode mode) noexcept {
+    scheduling_ = mode;
+    wheelWorld_ = nullptr; // Seed the wheels again on the next event-driven tick
+}
+
+bool TickScheduler::sweepsProducts(const World& world) noexcept {
+    // A scalar sweep does the work of Business::update() plus a pass over the factors, and the vector kernels only
+    // make up for that pass when the blocks are long enough
+    return bestSimdLevel() != SimdLevel::Scalar &&
+           ProductTable::market().rows() >= SWEEP_MIN_ROWS * world.businesses().size();
+}
+
+void TickScheduler::updateBusinesses(World& world, SimdLevel level) {
+    SlotPool<Business>& businesses = world.businesses();
+    ProductTable& market = ProductTable::market();
+    slotFactors_.assign(market.slots(), ProductTable::SKIP); // Free blocks and other worlds' businesses are skipped
+    pool_.parallelFor(businesses.slots(), 0, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            if (Business* business = businesses.at(i)) {
+                double factor = business->updateStock();
+                if (&business->productTable() == &market) {
+                    slotFactors_[business->productSlot()] = factor; // Swept below with the rest of the market
+                } else {
+                    business->updateProducts(factor);
+                }
+            }
+        }
+    });
+    pool_.parallelFor(market.slots(), 0, [&](std::size_t begin, std::size_t end) {
+        market.update(slotFactors_, static_cast<ProductTable::Slot>(begin), static_cast<ProductTable::Slot>(end),
+                      level);
+    });
+}
+
+void TickScheduler::groupNpcs(World& world) {
+    // Counting sort of the deciding NPCs by strategy, keeping slot order within every group
+    SlotPool<Npc>& npcs = world.npcs();
+    groupStart_.fill(0);
+    for (std::uint32_t n : npcSlots_) {
+        ++groupStart_[static_cast<std::size_t>(npcs.at(n)->strategy()) + 1];
+    }
+    for (std::size_t g = 0; g < STRATEGY_COUNT; ++g) {
+        groupStart_[g + 1] += groupStart_[g];
+    }
+
+    grouped_.resize(npcSlots_.size());
+    std::array<std::size_t, STRATEGY_COUNT> cursor;
+    std::copy(groupStart_.begin(), groupStart_.end() - 1, cursor.begin());
+    for (std::uint32_t n : npcSlots_) {
+        grouped_[cursor[static_cast<std::size_t>(npcs.at(n)->strategy())]++] = n;
+    }
+}
+
+template <class Strategy> void TickScheduler::decideGroup(World& world, std::size_t begin, std::size_t end) {
+    SlotPool<Npc>& npcs = world.npcs();
+    std::uint32_t buffer = static_cast<std::uint32_t>(ThreadPool::participant());
+    IntentBuffer& intents = intents_[buffer];
+    for (std::size_t i = begin; i < end; ++i) {
+        std::size_t purchases = intents.purchases.size();
+        std::size_t orders = intents.orders.size();
+        npcs.at(grouped_[i])->decide<Strategy>(world, candidates_, intents);
+        npcIntents_[grouped_[i]] = {buffer, static_cast<std::uint32_t>(purchases),
+                                    static_cast<std::uint32_t>(intents.purchases.size() - purchases),
+                                    static_cast<std::uint32_t>(orders),
+                                    static_cast<std::uint32_t>(intents.orders.size() - orders)};
+    }
+}
+
+void TickScheduler::groupPurchases(World& world) {
+    // Counting sort of the purchases by business slot; walking the NPCs in slot order keeps the commit order fixed
+    auto forEachPurchase = [&](auto&& body) {
+        if (shard_ == nullptr) {
+            for (std::uint32_t n : npcSlots_) {
+                for (auto& purchase : purchasesOf(n)) {
+                    body(purchase);
+                }
+            }
+        } else {
+            for (const SharedPurchase& shared : sharedPurchases_) {
+                body(*shared.purchase); // Creation order, the slot order of an unsharded world
+            }
+        }
+    };
+    const std::size_t businessCount = world.businesses().slots();
+    businessStart_.assign(businessCount + 1, 0);
+    std::size_t total = 0;
+    forEachPurchase([&](const PurchaseIntent& purchase) {
+        ++businessStart_[purchase.business + 1];
+        ++total;
+    });
+    for (std::size_t b = 0; b < businessCount; ++b) {
+        businessStart_[b + 1] += businessStart_[b]; // Prefix sum: counts become start offsets
+    }
+
+    byBusiness_.resize(total);
+    cursor_.assign(businessStart_.begin(), businessStart_.end() - 1);
+    forEachPurchase([&](PurchaseIntent& purchase) { byBusiness_[cursor_[purchase.business]++] = &purchase; });
+}
+
+std::size_t TickScheduler::groupFills(World& world) {
+    // Counting sort of the execution reports by owner slot, walking the auctions in business order
+    SlotPool<Business>& businesses = world.businesses();
+    const std::size_t npcCount = world.npcs().slots();
+    npcStart_.assign(npcCount + 1, 0);
+    std::size_t total = 0;
+    std::size_t filled = 0;
+    for (std::uint32_t b : auctions_) {
+        for (const auto& fill : businesses.at(b)->orderBook().reports()) {
+            filled += fill.filled > 0;
+            if (fill.owner == REMOTE_OWNER) {
+                continue; // Settled by the shard owning the NPC
+            }
+            ++npcStart_[fill.owner + 1];
+            ++total;
+        }
+    }
+    for (std::size_t n = 0; n < npcCount; ++n) {
+        npcStart_[n + 1] += npcStart_[n];
+    }
+
+    byNpc_.resize(total);
+    cursor_.assign(npcStart_.begin(), npcStart_.end() - 1);
+    for (std::uint32_t b : auctions_) {
+        for (const auto& fill : businesses.at(b)->orderBook().reports()) {
+            if (fill.owner != REMOTE_OWNER) {
+                byNpc_[cursor_[fill.owner]++] = fill;
+            }
+        }
+    }
+    return filled;
+}
+
+std::size_t TickScheduler::collectDue(World& world, std::uint64_t now) {
+    SlotPool<Business>& businesses = world.businesses();
+    SlotPool<Npc>& npcs = world.npcs();
+    lastTick_ = now;
+    if (wheelWorld_ != &world) {
+        // First event-driven tick on this world: everything is due, the wheels take over from there
+        wheelWorld_ = &world;
+        businessWheel_.reset(now);
+        npcWheel_.reset(now);
+        businessDue_.assign(businesses.slots(), now);
+        npcIntervals_.assign(npcs.slots(), 1);
+        npcPaidThrough_.assign(npcs.slots(), now - 1);
+        for (std::uint32_t b = 0; b < businesses.slots(); ++b) {
+            if (businesses.at(b) != nullptr) {
+                businessWheel_.schedule({businesses.handleAt(b).bits(), now - 1, now});
+            }
+        }
+        for (std::uint32_t n = 0; n < npcs.slots(); ++n) {
+            if (npcs.at(n) != nullptr) {
+                npcWheel_.schedule({npcs.handleAt(n).bits(), now - 1, now});
+            }
+        }
+        world.clearCreated();
+    }
+    for (BusinessHandle business : world.createdBusinesses()) {
+        if (business.index >= businessDue_.size()) {
+            businessDue_.resize(business.index + 1);
+        }
+        businessDue_[business.index] = now;
+        businessWheel_.schedule({business.bits(), now - 1, now});
+    }
+    for (NpcHandle npc : world.createdNpcs()) {
+        if (npc.index >= npcIntervals_.size()) {
+            npcIntervals_.resize(npc.index + 1);
+            npcPaidThrough_.resize(npc.index + 1);
+        }
+        npcIntervals_[npc.index] = 1;
+        npcPaidThrough_[npc.index] = now - 1;
+        npcWheel_.schedule({npc.bits(), now - 1, now});
+    }
+    world.clearCreated();
+
+    // Timers of destroyed entities hold stale handles and are dropped here, as is any timer that is not the latest
+    // one of its slot
+    fired_.clear();
+    businessWheel_.advance(now, fired_);
+    dueBusinesses_.clear();
+    for (const TimingWheel::Timer& timer : fired_) {
+        BusinessHandle handle = businessTimer(timer);
+        if (businesses.get(handle) != nullptr && businessDue_[handle.index] == timer.due) {
+            dueBusinesses_.push_back(handle.index);
+        }
+    }
+    std::sort(dueBusinesses_.begin(), dueBusinesses_.end());
+
+    fired_.clear();
+    npcWheel_.advance(now, fired_);
+    std::sort(fired_.begin(), fired_.end(), [](const auto& a, const auto& b) {
+        return npcTimer(a).index < npcTimer(b).index;
+    });
+    npcSlots_.clear();
+    std::vector<JournalEntry>& interest = intents_[0].journal; // Free until the decisions
+    for (const TimingWheel::Timer& timer : fired_) {
+        NpcHandle handle = npcTimer(timer);
+        if (Npc* npc = npcs.get(handle)) {
+            npc->accrueInterest(now - npcPaidThrough_[handle.index] - 1, interest); // decide() accrues this tick
+            npcSlots_.push_back(handle.index);
+        }
+    }
+    // Applied right away, so that decide() earns the interest of this tick on the compounded savings
+    world.ledger().transfer(interest);
+    std::size_t accrued = interest.size();
+    interest.clear();
+    return accrued;
+}
+
+void TickScheduler::settleInterest(World& world) {
+    if (scheduling_ != SchedulingMode::Events || wheelWorld_ != &world) {
+        return; // Every NPC decided in the last tick
+    }
+    SlotPool<Npc>& npcs = world.npcs();
+    npcPaidThrough_.resize(npcs.slots(), lastTick_);
+    for (NpcHandle npc : world.createdNpcs()) {
+        npcPaidThrough_[npc.index] = lastTick_; // Created since, owed nothing yet
+    }
+    std::vector<JournalEntry>& interest = intents_[0].journal;
+    interest.clear();
+    for (std::uint32_t n = 0; n < npcs.slots(); ++n) {
+        if (Npc* npc = npcs.at(n)) {
+            npc->accrueInterest(lastTick_ - npcPaidThrough_[n], interest);
+            npcPaidThrough_[n] = lastTick_;
+        }
+    }
+    world.ledger().transfer(interest);
+    interest.clear();
+}
+
+void TickScheduler::updateDue(World& world, std::uint64_t now) {
+    SlotPool<Business>& businesses = world.businesses();
+    dueIdle_.assign(dueBusinesses_.size(), 0);
+    pool_.parallelFor(dueBusinesses_.size(), 0, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            Business* business = businesses.at(dueBusinesses_[i]);
+            business->update();
+            // Without products and stock demand an update changes nothing: demand stays 0, so does the price
+            dueIdle_[i] = business->products().empty() && business->stockDemand() == 0;
+        }
+    });
+    for (std::size_t i = 0; i < dueBusinesses_.size(); ++i) {
+        std::uint32_t b = dueBusinesses_[i];
+        businessDue_[b] = now + (dueIdle_[i] ? BUSINESS_PARK_INTERVAL : 1);
+        businessWheel_.schedule({businesses.handleAt(b).bits(), now, businessDue_[b]});
+    }
+}
+
+void TickScheduler::scheduleNpcs(World& world, std::uint64_t now) {
+    SlotPool<Npc>& npcs = world.npcs();
+    for (std::uint32_t n : npcSlots_) {
+        std::uint32_t& interval = npcIntervals_[n];
+        interval = npcs.at(n)->trading() ? 1 : std::min(interval * 2, NPC_MAX_INTERVAL); // Back off while idle
+        npcPaidThrough_[n] = now;
+        npcWheel_.schedule({npcs.handleAt(n).bits(), now, now + interval});
+    }
+}
+
+void TickScheduler::exchangeIntents(World& world) {
+    SlotPool<Npc>& npcs = world.npcs();
+    std::uint64_t purchaseCount = 0;
+    std::uint64_t orderCount = 0;
+    for (std::uint32_t n : npcSlots_) {
+        purchaseCount += npcIntents_[n].purchaseCount;
+        orderCount += npcIntents_[n].orderCount;
+    }
+    batch_.clear();
+    batch_.put(purchaseCount);
+    for (std::uint32_t n : npcSlots_) {
+        for (const auto& purchase : purchasesOf(n)) {
+            batch_.put(PurchaseMessage{npcs.at(n)->id(), purchase.business, purchase.product, purchase.amount});
+        }
+    }
+    batch_.put(orderCount);
+    for (std::uint32_t n : npcSlots_) {
+        for (const auto& order : ordersOf(n)) {
+            batch_.put(OrderMessage{npcs.at(n)->id(), order});
+        }
+    }
+    shard_->exchange(batch_.bytes());
+
+    // The remote purchases are stored first, so the pointers taken below stay valid
+    std::size_t remote = 0;
+    for (std::uint32_t peer = 0; peer < shard_->shards(); ++peer) {
+        if (peer != shard_->shard()) {
+            remote += static_cast<std::size_t>(ShardReader(shard_->received(peer)).get<std::uint64_t>());
+        }
+    }
+    remotePurchases_.clear();
+    remotePurchases_.reserve(remote);
+    sharedPurchases_.clear();
+    sharedOrders_.clear();
+    for (std::uint32_t n : npcSlots_) {
+        std::uint64_t id = npcs.at(n)->id();
+        for (auto& purchase : purchasesOf(n)) {
+            sharedPurchases_.push_back({id, &purchase});
+        }
+        for (const auto& order : ordersOf(n)) {
+            sharedOrders_.push_back({id, n, order});
+        }
+    }
+    for (std::uint32_t peer = 0; peer < shard_->shards(); ++peer) {
+        if (peer == shard_->shard()) {
+            continue;
+        }
+        ShardReader in(shard_->received(peer));
+        for (std::uint64_t i = in.get<std::uint64_t>(); i != 0; --i) {
+            PurchaseMessage message = in.get<PurchaseMessage>();
+            remotePurchases_.push_back({message.business, message.product, message.amount, Money()});
+            sharedPurchases_.push_back({message.npc, &remotePurchases_.back()});
+        }
+        for (std::uint64_t i = in.get<std::uint64_t>(); i != 0; --i) {
+            OrderMessage message = in.get<OrderMessage>();
+            sharedOrders_.push_back({message.npc, REMOTE_OWNER, message.order});
+        }
+    }
+
+    // Every batch lists its NPCs in creation order; stable sorts keep the order of the intents of every NPC
+    std::stable_sort(sharedPurchases_.begin(), sharedPurchases_.end(),
+                     [](const SharedPurchase& a, const SharedPurchase& b) { return a.npc < b.npc; });
+    std::stable_sort(sharedOrders_.begin(), sharedOrders_.end(),
+                     [](const SharedOrder& a, const SharedOrder& b) { return a.npc < b.npc; });
+}
+
+void TickScheduler::exchangeTransfers(World& world) {
+    // Transfers between an NPC and a business reach the other shards with the NPC's side on the system account,
+    // which stands for every account a shard does not hold
+    auto shared = [](Account account) {
+        return account.kind == AccountKind::Business ? account : Account::system();
+    };
+    batch_.clear();
+    for (const IntentBuffer& buffer : intents_) {
+        for (const JournalEntry& entry : buffer.journal) {
+            if (entry.from.kind == AccountKind::Business || entry.to.kind == AccountKind::Business) {
+                batch_.put(JournalEntry{shared(entry.from), shared(entry.to), entry.amount, entry.kind});
+            }
+        }
+    }
+    shard_->exchange(batch_.bytes());
+
+    remoteTransfers_.clear();
+    for (std::uint32_t peer = 0; peer < shard_->shards(); ++peer) {
+        if (peer == shard_->shard()) {
+            continue;
+        }
+        std::span<const std::byte> received = shard_->received(peer);
+        ShardReader in(received);
+        for (std::size_t i = received.size() / sizeof(JournalEntry); i != 0; --i) {
+            remoteTransfers_.push_back(in.get<JournalEntry>());
+        }
+    }
+    world.ledger().post(remoteTransfers_);
+}
+
+void TickScheduler::exchangeRestructures(World& world) {
+    SlotPool<Npc>& npcs = world.npcs();
+    batch_.clear();
+    sharedActions_.clear();
+    for (std::uint32_t n : npcSlots_) {
+        Npc* npc = npcs.at(n);
+        if (!npc->wantsBusiness() && npc->businessToSell().isNull()) {
+            continue; // Nothing to found or close
+        }
+        std::string name = npc->wantsBusiness() ? npc->newBusinessName() : std::string();
+        batch_.put(ActionMessage{npc->id(), npc->businessToSell(), static_cast<std::uint32_t>(name.size()),
+                                 npc->wantsBusiness()});
+        batch_.put(name.data(), name.size());
+        sharedActions_.push_back({npc->id(), n, {}, false, {}}); // Restructures itself below
+    }
+    shard_->exchange(batch_.bytes());
+
+    for (std::uint32_t peer = 0; peer < shard_->shards(); ++peer) {
+        if (peer == shard_->shard()) {
+            continue;
+        }
+        std::span<const std::byte> received = shard_->received(peer);
+        ShardReader in(received);
+        while (!in.empty()) {
+            ActionMessage message = in.get<ActionMessage>();
+            sharedActions_.push_back(
+                {message.npc, REMOTE_SLOT, message.sell, message.founds != 0, in.text(message.nameLength)});
+        }
+    }
+    std::stable_sort(sharedActions_.begin(), sharedActions_.end(),
+                     [](const SharedAction& a, const SharedAction& b) { return a.npc < b.npc; });
+
+    // The same structural changes in the same order on every shard give every business the same slot and ID
+    for (const SharedAction& action : sharedActions_) {
+        if (action.slot != REMOTE_SLOT) {
+            npcs.at(action.slot)->restructure(world);
+            continue;
+        }
+        if (!action.sell.isNull()) {
+            world.destroyBusiness(action.sell); // As Npc::restructure() does for the owner
+        }
+        if (action.founds) {
+            world.createBusiness(std::string(action.name));
+        }
+    }
+}
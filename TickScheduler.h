@@ -0,0 +1,248 @@
+#pragma once
+#ifndef TICK_SCHEDULER_H
+#define TICK_SCHEDULER_H
+
+#include "CandidateSelector.h"
+#include "Intent.h"
+#include "NpcStrategy.h"
+#include "OrderBook.h"
+#include "ProductKernels.h"
+#include "Shard.h"
+#include "ThreadPool.h"
+#include "TimingWheel.h"
+#include "World.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/**
+ * @struct TickStats
+ * @brief Work done by one tick.
+ */
+struct TickStats {
+    std::size_t businessUpdates = 0;  // Businesses updated
+    std::size_t npcUpdates = 0;       // NPCs updated
+    std::size_t purchases = 0;        // Product purchases that were filled
+    std::size_t stockTrades = 0;      // Stock orders that were filled, at least partially
+    std::int64_t sharesTraded = 0;    // Shares that changed hands in the auctions
+    std::size_t transfers = 0;        // Journal entries applied by the ledger
+    bool balanced = true;             // Whether the ledger audit found money conserved and no account overdrawn
+
+    std::size_t trades() const noexcept { return purchases + stockTrades; } // Filled purchases and stock orders
+};
+
+/**
+ * @brief Which entities a tick updates.
+ */
+enum class SchedulingMode {
+    EveryTick, // Every business and NPC, every tick
+    Events,    // Only the entities whose next event is due, kept on timing wheels
+};
+
+/**
+ * @class TickScheduler
+ * @brief Runs one simulation tick over every business and NPC on a thread pool.
+ *
+ * A tick runs in phases separated by barriers, and within a phase every entity is only written by one thread:
+ *  1. Businesses update their own stock and products (Business::update). When the sweep pays off
+ *     (sweepsProducts()), the product columns of the whole market are instead swept at once with the widest vector
+ *     instructions available (updateBusinesses).
+ *  2. NPCs decide (Npc::decide) among their candidates (CandidateSelector). The businesses are a frozen snapshot
+ *     during this phase; NPCs only write their own state and record product
+ *     purchases, stock orders and transfers in the IntentBuffer of the thread deciding them, which the scheduler
+ *     owns and clears every tick. NPCs are grouped by strategy (NpcStrategy.h) and every group runs a loop bound
+ *     to its policies at compile time, so the strategy is dispatched once per group and range, not per NPC.
+ *  3. Purchases are grouped by business and every business commits its own purchases, in NPC order. Stock orders
+ *     are submitted to the order books, in NPC order.
+ *  4. Every business runs the call auction of its order book.
+ *  5. Execution reports are grouped by NPC and NPCs settle their purchases and orders (Npc::settle), posting
+ *     the payments to the journal of the settling thread. The journals are applied by the ledger of the World as
+ *     one batch, which sums every account in integer cents whatever the order of the entries, and the ledger is
+ *     audited.
+ *  6. Businesses founded or closed during the tick are created and destroyed in the World, in NPC order
+ *     (Npc::restructure).
+ * Entities are walked in slot order, and purchases and execution reports are grouped by slot.
+ * Since every phase has a fixed commit order, every entity draws from its own random stream and money is summed in
+ * integer cents, the result of a tick does not depend on the number of threads.
+ *
+ * In the event-driven mode only due entities take part in a tick, so a quiet world costs in proportion to its
+ * events rather than its population. Businesses are due every tick while anything about them can move; one with
+ * neither products nor stock demand cannot change during a tick (an auction only sets its stock price, which the
+ * update does not read) and is parked for BUSINESS_PARK_INTERVAL ticks, which leaves the results identical.
+ * Products added to a parked business between ticks only take effect once it is due again. NPCs are due every tick
+ * while they trade; an NPC whose decision bought nothing, placed no order and holds no shares waits twice as long
+ * for its next decision, up to NPC_MAX_INTERVAL ticks; its savings interest for the skipped ticks is compounded and
+ * applied when it is next due, before it decides and earns the interest of that tick. The wheels are not saved in
+ * snapshots (settleInterest() pays what waiting NPCs are owed first): the first event-driven tick on a world,
+ * restored or not, makes every entity due.
+ *
+ * A sharded tick (setShard()) runs on a world holding every business but only the NPCs of its shard. The shards
+ * exchange what their NPCs did at three points: the purchases and stock orders after phase 2, the transfers that
+ * touch a business before the ledger applies the batch, and the businesses founded and closed in phase 6. Each
+ * shard merges the batches in NPC creation order, which is the slot order of an unsharded world, and commits all
+ * of them to its copy of the businesses, so every copy stays identical to the businesses of a single world. A
+ * barrier ends every sharded tick.
+ */
+class TickScheduler {
+  public:
+    /**
+     * @brief Create a scheduler.
+     * @param threads The number of threads to run ticks on; 0 uses every hardware thread.
+     */
+    explicit TickScheduler(std::size_t threads = 0);
+
+    std::size_t threads() const noexcept { return pool_.size(); } // Number of threads running ticks
+    ThreadPool& pool() noexcept { return pool_; }                 // Threads running ticks, idle between them
+
+    /**
+     * @brief Get the selector of the businesses every NPC considers; it considers every business by default.
+     */
+    CandidateSelector& candidates() noexcept { return candidates_; }
+
+    SchedulingMode scheduling() const noexcept { return scheduling_; }
+    void setScheduling(SchedulingMode mode) noexcept; // Switch modes between ticks
+
+    /**
+     * @brief Run ticks as one shard of a sharded world, or on a whole world here with nullptr (the default).
+     * The world must hold every business and exactly the NPCs the shard owns, created with their creation number.
+     */
+    void setShard(ShardLink* shard) noexcept { shard_ = shard; }
+    ShardLink* shard() const noexcept { return shard_; }
+
+    /**
+     * @brief Run one tick.
+     * @param world The businesses and NPCs to update; businesses founded during the tick are added to it.
+     * @return The work done by the tick.
+     */
+    TickStats tick(World& world);
+
+    /**
+     * @brief Phase 1 of a tick: update every business of a world.
+     * Gives the same results as calling Business::update() on every business, but the product columns of the
+     * businesses in the market table are updated in one sweep instead of block by block.
+     * @param world The businesses to update.
+     * @param level The instruction set of the product sweep; it must be supported.
+     */
+    void updateBusinesses(World& world, SimdLevel level = bestSimdLevel());
+
+    /**
+     * @brief Check whether tick() updates the businesses of a world with the sweep of updateBusinesses().
+     * The sweep only beats Business::update() with vector instructions and at SWEEP_MIN_ROWS product rows per
+     * business or more (see "Benchmarks" in the README); other worlds are updated business by business.
+     */
+    static bool sweepsProducts(const World& world) noexcept;
+
+    static constexpr std::size_t SWEEP_MIN_ROWS = 8; // Rows of the market table per business for the sweep to pay
+
+    /**
+     * @brief Pay the savings interest owed to NPCs waiting on the timing wheel, up to the last tick run.
+     * Between event-driven ticks the balances of waiting NPCs lag behind; call this before saving a snapshot,
+     * which does not keep the wheels. Does nothing in the every-tick mode.
+     * @param world The world of the last ticks.
+     */
+    void settleInterest(World& world);
+
+    static constexpr std::uint64_t BUSINESS_PARK_INTERVAL = 4096; // Ticks between updates of a stuck business
+    static constexpr std::uint32_t NPC_MAX_INTERVAL = 16;          // Longest wait between decisions of an idle NPC
+
+  private:
+    void groupNpcs(World& world);         // Fills grouped_ and groupStart_ from npcSlots_
+    template <class Strategy> void decideGroup(World& world, std::size_t begin, std::size_t end); // Of grouped_
+    void groupPurchases(World& world);    // Fills byBusiness_ from the NPCs of npcSlots_
+    std::size_t groupFills(World& world); // Fills byNpc_ from the auctions_, returns the number of filled orders
+    std::size_t collectDue(World& world, std::uint64_t now); // Fills dueBusinesses_ and npcSlots_, pays the interest
+    void updateDue(World& world, std::uint64_t now);    // Phase 1 of an event-driven tick
+    void scheduleNpcs(World& world, std::uint64_t now); // Schedule the next decision of every NPC that decided
+
+    struct NpcIntents {
+        std::uint32_t buffer;        // Index in intents_ of the buffer the NPC decided into
+        std::uint32_t purchases;     // First purchase of the NPC in the buffer
+        std::uint32_t purchaseCount; // Number of purchases of the NPC
+        std::uint32_t orders;        // First stock order of the NPC in the buffer
+        std::uint32_t orderCount;    // Number of stock orders of the NPC
+    };
+
+    std::span<PurchaseIntent> purchasesOf(std::uint32_t npc) noexcept { // Decided this tick by an NPC slot
+        const NpcIntents& at = npcIntents_[npc];
+        return {intents_[at.buffer].purchases.data() + at.purchases, at.purchaseCount};
+    }
+    std::span<const StockOrder> ordersOf(std::uint32_t npc) const noexcept { // Placed this tick by an NPC slot
+        const NpcIntents& at = npcIntents_[npc];
+        return {intents_[at.buffer].orders.data() + at.orders, at.orderCount};
+    }
+
+    // Sharded ticks
+    static constexpr std::uint64_t REMOTE_OWNER = UINT64_MAX; // Owner tag of the orders of other shards' NPCs
+    static constexpr std::uint32_t REMOTE_SLOT = UINT32_MAX;  // Slot of the NPCs of other shards
+
+    struct SharedPurchase {
+        std::uint64_t npc;        // Creation number of the buyer
+        PurchaseIntent* purchase; // In intents_ if this shard owns the buyer, else in remotePurchases_
+    };
+    struct SharedOrder {
+        std::uint64_t npc;   // Creation number of the NPC placing the order
+        std::uint64_t owner; // Slot of the NPC, REMOTE_OWNER if another shard owns it
+        StockOrder order;
+    };
+    struct SharedAction {
+        std::uint64_t npc;     // Creation number of the NPC founding or closing a business
+        std::uint32_t slot;    // Slot of the NPC, REMOTE_SLOT if another shard owns it
+        BusinessHandle sell;   // Business closed, null if none
+        bool founds;           // Whether a business is founded
+        std::string_view name; // Name of the founded business, in the batch of the other shard
+    };
+
+    void exchangeIntents(World& world);      // Fills sharedPurchases_ and sharedOrders_ with every shard's NPCs
+    void exchangeTransfers(World& world);    // Posts the transfers of other shards that touch businesses
+    void exchangeRestructures(World& world); // Phase 6 of a sharded tick
+
+    static BusinessHandle businessTimer(const TimingWheel::Timer& timer) noexcept {
+        return {static_cast<std::uint32_t>(timer.payload), static_cast<std::uint32_t>(timer.payload >> 32)};
+    }
+    static NpcHandle npcTimer(const TimingWheel::Timer& timer) noexcept {
+        return {static_cast<std::uint32_t>(timer.payload), static_cast<std::uint32_t>(timer.payload >> 32)};
+    }
+
+    ThreadPool pool_;
+    SchedulingMode scheduling_ = SchedulingMode::EveryTick;
+    std::vector<std::uint32_t> npcSlots_;     // NPCs deciding this tick, in slot order
+    std::vector<std::uint32_t> auctions_;     // Businesses that received stock orders this tick, in slot order
+    std::vector<std::uint32_t> grouped_;      // npcSlots_ grouped by strategy, in slot order within a group
+    std::array<std::size_t, STRATEGY_COUNT + 1> groupStart_ = {}; // First entry of every strategy in grouped_
+    std::vector<IntentBuffer> intents_;       // What the NPCs did this tick, one buffer per thread of the pool
+    std::vector<NpcIntents> npcIntents_;      // Where the intents of every NPC slot deciding this tick are
+    CandidateSelector candidates_;            // Businesses every NPC considers, prepared after phase 1
+    std::vector<std::size_t> businessStart_;  // First entry of every business slot in byBusiness_
+    std::vector<PurchaseIntent*> byBusiness_; // Every purchase of the tick, grouped by business
+    std::vector<std::size_t> npcStart_;       // First entry of every NPC slot in byNpc_
+    std::vector<StockFill> byNpc_;            // Every execution report of the tick, grouped by NPC
+    std::vector<std::size_t> cursor_;         // Write cursors of the grouping passes
+    std::vector<double> slotFactors_;         // Random factor of every block of the market table
+
+    // Event-driven mode
+    const World* wheelWorld_ = nullptr;         // World the wheels were seeded for
+    TimingWheel businessWheel_;                 // Next update of every business, payload is the handle bits
+    TimingWheel npcWheel_;                      // Next decision of every NPC, payload is the handle bits
+    std::vector<std::uint64_t> businessDue_;    // Tick of the live timer of every business slot
+    std::vector<std::uint32_t> npcIntervals_;   // Current wait between decisions of every NPC slot
+    std::vector<std::uint64_t> npcPaidThrough_; // Last tick whose savings interest every NPC slot received
+    std::uint64_t lastTick_ = 0;                // Last event-driven tick
+    std::vector<std::uint32_t> dueBusinesses_;  // Businesses updated this tick, in slot order
+    std::vector<std::uint8_t> dueIdle_;         // Whether every due business came out unable to move
+    std::vector<TimingWheel::Timer> fired_;     // Scratch of the wheel advances
+
+    // Sharded mode
+    ShardLink* shard_ = nullptr;
+    ShardBatch batch_;                             // Batch this shard sends in the current exchange
+    std::vector<PurchaseIntent> remotePurchases_;  // Purchases of other shards' NPCs, committed here as well
+    std::vector<SharedPurchase> sharedPurchases_;  // Every purchase of the tick, in NPC creation order
+    std::vector<SharedOrder> sharedOrders_;        // Every stock order of the tick, in NPC creation order
+    std::vector<JournalEntry> remoteTransfers_;    // Transfers of other shards touching businesses
+    std::vector<SharedAction> sharedActions_;      // Every business founded or closed, in NPC creation order
+};
+
+#endif // TICK_SCHEDULER_H
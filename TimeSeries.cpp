@@ -0,0 +1,499 @@
+#include "TimeSeries.h"
+
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr char MAGIC[8] = {'E', 'C', 'O', 'S', 'E', 'R', 'I', 'E'};
+constexpr std::uint32_t VERSION = 1;
+constexpr char CHUNK_TAG = 'C'; // Block of encoded ticks
+constexpr char NAMES_TAG = 'N'; // Block of product names, written when the file is closed
+
+enum Column : std::size_t {
+    Ticks,
+    BusinessCount,
+    BusinessIds,
+    StockPrices,
+    RowCount,
+    RowBusinesses,
+    RowProducts,
+    RowPrices,
+    RowSupply,
+    RowDemand,
+    NpcCount,
+    NpcIds,
+    NpcBalances,
+    NpcScores,
+    COLUMN_COUNT,
+};
+
+void putVarint(std::vector<std::uint8_t>& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+std::uint64_t zigzag(std::int64_t value) noexcept {
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+std::int64_t unzigzag(std::uint64_t value) noexcept {
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+std::uint64_t byteReverse(std::uint64_t value) noexcept {
+    std::uint64_t reversed = 0;
+    for (int i = 0; i < 8; ++i) {
+        reversed = (reversed << 8) | (value & 0xFF);
+        value >>= 8;
+    }
+    return reversed;
+}
+
+std::uint64_t bitsOf(double value) noexcept {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double doubleOf(std::uint64_t bits) noexcept {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Values are encoded against the value at the same position of the previous tick, 0 past its end
+template <class T> T previousAt(const std::vector<T>& previous, std::size_t i) {
+    return i < previous.size() ? previous[i] : T{};
+}
+
+void putInts(std::vector<std::uint8_t>& out, const std::vector<std::int64_t>& values,
+             const std::vector<std::int64_t>& previous) {
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        putVarint(out, zigzag(values[i] - previousAt(previous, i)));
+    }
+}
+
+void putDoubles(std::vector<std::uint8_t>& out, const std::vector<double>& values, const std::vector<double>& previous) {
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        putVarint(out, byteReverse(bitsOf(values[i]) ^ bitsOf(previousAt(previous, i))));
+    }
+}
+
+/**
+ * @brief Reads varints from a column of a chunk.
+ */
+class ColumnReader {
+  public:
+    ColumnReader() = default;
+    ColumnReader(const std::uint8_t* data, std::size_t size) : data_(data), end_(data + size) {}
+
+    bool varint(std::uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64 && data_ != end_; shift += 7) {
+            std::uint8_t byte = *data_++;
+            value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false; // Truncated column
+    }
+
+    bool text(std::string& value) {
+        std::uint64_t length;
+        if (!varint(length) || length > static_cast<std::uint64_t>(end_ - data_)) {
+            return false;
+        }
+        value.assign(reinterpret_cast<const char*>(data_), static_cast<std::size_t>(length));
+        data_ += length;
+        return true;
+    }
+
+    // Every value takes at least one byte, which bounds the count a column can hold
+    bool holds(std::int64_t count) const noexcept { return count >= 0 && count <= end_ - data_; }
+
+    bool ints(std::vector<std::int64_t>& values, std::int64_t count) {
+        if (!holds(count)) {
+            return false; // Corrupt count
+        }
+        std::vector<std::int64_t> previous = std::move(values);
+        values.resize(count);
+        for (std::int64_t i = 0; i < count; ++i) {
+            std::uint64_t delta;
+            if (!varint(delta)) {
+                return false;
+            }
+            values[i] = previousAt(previous, i) + unzigzag(delta);
+        }
+        return true;
+    }
+
+    bool doubles(std::vector<double>& values, std::int64_t count) {
+        if (!holds(count)) {
+            return false; // Corrupt count
+        }
+        std::vector<double> previous = std::move(values);
+        values.resize(count);
+        for (std::int64_t i = 0; i < count; ++i) {
+            std::uint64_t delta;
+            if (!varint(delta)) {
+                return false;
+            }
+            values[i] = doubleOf(byteReverse(delta) ^ bitsOf(previousAt(previous, i)));
+        }
+        return true;
+    }
+
+  private:
+    const std::uint8_t* data_ = nullptr;
+    const std::uint8_t* end_ = nullptr;
+};
+
+enum class BlockRead {
+    Block,     // A whole block was read
+    End,       // The file ends between blocks
+    Truncated, // The file ends inside a block, which was cut short or is still being written
+};
+
+BlockRead readBlock(std::ifstream& in, char& tag, std::vector<std::uint8_t>& payload) {
+    if (!in.read(&tag, 1)) {
+        return BlockRead::End;
+    }
+    std::uint64_t length;
+    if (!in.read(reinterpret_cast<char*>(&length), sizeof(length))) {
+        return BlockRead::Truncated;
+    }
+    std::streampos here = in.tellg();
+    in.seekg(0, std::ios::end);
+    std::uint64_t remaining = static_cast<std::uint64_t>(in.tellg() - here);
+    in.seekg(here);
+    if (length > remaining) {
+        return BlockRead::Truncated; // Checked before sizing the payload after a corrupt length
+    }
+    payload.resize(length);
+    in.read(reinterpret_cast<char*>(payload.data()), static_cast<std::streamsize>(length));
+    return in ? BlockRead::Block : BlockRead::Truncated;
+}
+
+} // namespace
+
+TimeSeriesRecorder::~TimeSeriesRecorder() {
+    close();
+}
+
+bool TimeSeriesRecorder::open(const std::string& path) {
+    close();
+    file_ = std::fopen(path.c_str(), "wb");
+    if (file_ == nullptr) {
+        return false; // Cannot create the file
+    }
+    std::fwrite(MAGIC, sizeof(MAGIC), 1, file_);
+    std::fwrite(&VERSION, sizeof(VERSION), 1, file_);
+
+    stopping_ = false;
+    chunkTicks_ = 0;
+    chunkSize_ = 0;
+    columns_.assign(COLUMN_COUNT, {});
+    previous_ = Frame{};
+    writer_ = std::thread(&TimeSeriesRecorder::writerLoop, this);
+    return true;
+}
+
+void TimeSeriesRecorder::close() {
+    if (file_ == nullptr) {
+        return; // Not open
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    filled_.notify_all();
+    writer_.join(); // Writes the frames still queued, the last chunk and the names
+
+    std::fclose(file_);
+    file_ = nullptr;
+}
+
+void TimeSeriesRecorder::record(const World& world, std::uint64_t tick) {
+    std::unique_ptr<Frame> frame;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        drained_.wait(lock, [&] { return !spare_.empty() || frames_ < QUEUE_FRAMES; }); // Bounded memory
+        if (!spare_.empty()) {
+            frame = std::move(spare_.back());
+            spare_.pop_back();
+        } else {
+            frame = std::make_unique<Frame>();
+            ++frames_;
+        }
+    }
+
+    frame->tick = tick;
+    frame->businessIds.clear();
+    frame->stockPrices.clear();
+    frame->rowBusinesses.clear();
+    frame->rowProducts.clear();
+    frame->rowPrices.clear();
+    frame->rowSupply.clear();
+    frame->rowDemand.clear();
+    frame->npcIds.clear();
+    frame->npcBalances.clear();
+    frame->npcScores.clear();
+
+    const SlotPool<Business>& businesses = world.businesses();
+    for (std::uint32_t i = 0; i < businesses.slots(); ++i) {
+        const Business* business = businesses.at(i);
+        if (business == nullptr) {
+            continue;
+        }
+        frame->businessIds.push_back(business->id());
+        frame->stockPrices.push_back(business->stockPrice());
+
+        std::span<const ProductId> products = business->products();
+        frame->rowBusinesses.insert(frame->rowBusinesses.end(), products.size(), business->id());
+        frame->rowProducts.insert(frame->rowProducts.end(), products.begin(), products.end());
+        frame->rowPrices.insert(frame->rowPrices.end(), business->prices().begin(), business->prices().end());
+        frame->rowSupply.insert(frame->rowSupply.end(), business->supply().begin(), business->supply().end());
+        frame->rowDemand.insert(frame->rowDemand.end(), business->demand().begin(), business->demand().end());
+    }
+
+    const SlotPool<Npc>& npcs = world.npcs();
+    for (std::uint32_t i = 0; i < npcs.slots(); ++i) {
+        if (const Npc* npc = npcs.at(i)) {
+            frame->npcIds.push_back(static_cast<std::int64_t>(npc->id()));
+            frame->npcBalances.push_back(npc->balance().toDouble());
+            frame->npcScores.push_back(npc->score());
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(frame));
+    }
+    filled_.notify_one();
+}
+
+void TimeSeriesRecorder::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        filled_.wait(lock, [&] { return !queue_.empty() || stopping_; });
+        if (queue_.empty()) {
+            break; // Stopping and every frame was written
+        }
+        std::unique_ptr<Frame> frame = std::move(queue_.front());
+        queue_.pop_front();
+        lock.unlock();
+
+        encode(*frame);
+
+        lock.lock();
+        spare_.push_back(std::move(frame));
+        drained_.notify_one();
+    }
+    lock.unlock();
+
+    flushChunk();
+    writeNames();
+}
+
+void TimeSeriesRecorder::encode(const Frame& frame) {
+    if (chunkTicks_ == 0) {
+        chunkFirstTick_ = frame.tick;
+    }
+    putVarint(columns_[Ticks], zigzag(static_cast<std::int64_t>(frame.tick - previous_.tick)));
+    putVarint(columns_[BusinessCount], zigzag(static_cast<std::int64_t>(frame.businessIds.size()) -
+                                              static_cast<std::int64_t>(previous_.businessIds.size())));
+    putInts(columns_[BusinessIds], frame.businessIds, previous_.businessIds);
+    putDoubles(columns_[StockPrices], frame.stockPrices, previous_.stockPrices);
+    putVarint(columns_[RowCount], zigzag(static_cast<std::int64_t>(frame.rowProducts.size()) -
+                                         static_cast<std::int64_t>(previous_.rowProducts.size())));
+    putInts(columns_[RowBusinesses], frame.rowBusinesses, previous_.rowBusinesses);
+    putInts(columns_[RowProducts], frame.rowProducts, previous_.rowProducts);
+    putDoubles(columns_[RowPrices], frame.rowPrices, previous_.rowPrices);
+    putInts(columns_[RowSupply], frame.rowSupply, previous_.rowSupply);
+    putDoubles(columns_[RowDemand], frame.rowDemand, previous_.rowDemand);
+    putVarint(columns_[NpcCount], zigzag(static_cast<std::int64_t>(frame.npcIds.size()) -
+                                         static_cast<std::int64_t>(previous_.npcIds.size())));
+    putInts(columns_[NpcIds], frame.npcIds, previous_.npcIds);
+    putDoubles(columns_[NpcBalances], frame.npcBalances, previous_.npcBalances);
+    putInts(columns_[NpcScores], frame.npcScores, previous_.npcScores);
+
+    previous_ = frame; // Reuses the capacity of the previous vectors
+    ++chunkTicks_;
+    chunkSize_ = 0;
+    for (const auto& column : columns_) {
+        chunkSize_ += column.size();
+    }
+    if (chunkTicks_ == CHUNK_TICKS || chunkSize_ >= CHUNK_BYTES) {
+        flushChunk();
+    }
+}
+
+void TimeSeriesRecorder::flushChunk() {
+    if (chunkTicks_ == 0) {
+        return; // Nothing captured since the last chunk
+    }
+    std::vector<std::uint8_t> header;
+    putVarint(header, chunkFirstTick_);
+    putVarint(header, chunkTicks_);
+    putVarint(header, COLUMN_COUNT);
+    for (const auto& column : columns_) {
+        putVarint(header, column.size());
+    }
+
+    std::uint64_t length = header.size() + chunkSize_;
+    std::fwrite(&CHUNK_TAG, 1, 1, file_);
+    std::fwrite(&length, sizeof(length), 1, file_);
+    std::fwrite(header.data(), 1, header.size(), file_);
+    for (auto& column : columns_) {
+        std::fwrite(column.data(), 1, column.size(), file_);
+        column.clear();
+    }
+
+    // The next chunk decodes on its own
+    chunkTicks_ = 0;
+    chunkSize_ = 0;
+    previous_ = Frame{};
+}
+
+void TimeSeriesRecorder::writeNames() {
+    const ProductCatalog& catalog = ProductCatalog::global();
+    std::vector<std::uint8_t> payload;
+    std::size_t count = catalog.size();
+    putVarint(payload, count);
+    for (ProductId id = 0; id < count; ++id) {
+        const std::string& name = catalog.name(id);
+        putVarint(payload, name.size());
+        payload.insert(payload.end(), name.begin(), name.end());
+    }
+
+    std::uint64_t length = payload.size();
+    std::fwrite(&NAMES_TAG, 1, 1, file_);
+    std::fwrite(&length, sizeof(length), 1, file_);
+    std::fwrite(payload.data(), 1, payload.size(), file_);
+}
+
+bool TimeSeriesRecorder::decode(const std::string& path, std::ostream& out) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(MAGIC)];
+    std::uint32_t version;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        !in.read(reinterpret_cast<char*>(&version), sizeof(version)) || version != VERSION) {
+        return false; // Not a time series, or written by an incompatible version
+    }
+    std::streampos start = in.tellg();
+
+    // First pass: the product names sit at the end of the file
+    std::vector<std::string> names;
+    char tag;
+    std::vector<std::uint8_t> payload;
+    BlockRead read;
+    while ((read = readBlock(in, tag, payload)) == BlockRead::Block) {
+        if (tag != NAMES_TAG) {
+            continue;
+        }
+        ColumnReader reader(payload.data(), payload.size());
+        std::uint64_t count;
+        if (!reader.varint(count) || count > payload.size()) {
+            return false; // Corrupt names, every one takes a byte at least
+        }
+        names.resize(count);
+        for (auto& name : names) {
+            if (!reader.text(name)) {
+                return false;
+            }
+        }
+    }
+    auto productName = [&](std::int64_t id) {
+        return id >= 0 && static_cast<std::size_t>(id) < names.size() ? names[id] : std::to_string(id);
+    };
+
+    // Second pass: decode the chunks
+    in.clear();
+    in.seekg(start);
+    if (read == BlockRead::Truncated) {
+        return false; // Only whole files decode
+    }
+    out << "tick,table,id,product,value1,value2,value3\n";
+    while (readBlock(in, tag, payload) == BlockRead::Block) {
+        if (tag != CHUNK_TAG) {
+            continue;
+        }
+        ColumnReader header(payload.data(), payload.size());
+        std::uint64_t firstTick;
+        std::uint64_t ticks;
+        std::uint64_t columnCount;
+        if (!header.varint(firstTick) || !header.varint(ticks) || !header.varint(columnCount) ||
+            columnCount != COLUMN_COUNT) {
+            return false; // Corrupt chunk
+        }
+        std::vector<std::uint64_t> lengths(COLUMN_COUNT);
+        std::uint64_t total = 0;
+        for (auto& length : lengths) {
+            if (!header.varint(length)) {
+                return false;
+            }
+            total += length;
+        }
+        if (total > payload.size()) {
+            return false;
+        }
+        std::vector<ColumnReader> columns(COLUMN_COUNT);
+        const std::uint8_t* data = payload.data() + payload.size() - total; // Columns follow the header
+        for (std::size_t c = 0; c < COLUMN_COUNT; ++c) {
+            columns[c] = ColumnReader(data, lengths[c]);
+            data += lengths[c];
+        }
+
+        Frame frame; // Previous tick of the chunk, then the current one
+        std::int64_t businessCount = 0;
+        std::int64_t rowCount = 0;
+        std::int64_t npcCount = 0;
+        for (std::uint64_t t = 0; t < ticks; ++t) {
+            std::uint64_t delta;
+            if (!columns[Ticks].varint(delta)) {
+                return false;
+            }
+            frame.tick += unzigzag(delta);
+
+            bool ok = columns[BusinessCount].varint(delta);
+            businessCount += unzigzag(delta);
+            ok = ok && columns[BusinessIds].ints(frame.businessIds, businessCount) &&
+                 columns[StockPrices].doubles(frame.stockPrices, businessCount) && columns[RowCount].varint(delta);
+            rowCount += unzigzag(delta);
+            ok = ok && columns[RowBusinesses].ints(frame.rowBusinesses, rowCount) &&
+                 columns[RowProducts].ints(frame.rowProducts, rowCount) &&
+                 columns[RowPrices].doubles(frame.rowPrices, rowCount) &&
+                 columns[RowSupply].ints(frame.rowSupply, rowCount) &&
+                 columns[RowDemand].doubles(frame.rowDemand, rowCount) && columns[NpcCount].varint(delta);
+            npcCount += unzigzag(delta);
+            ok = ok && columns[NpcIds].ints(frame.npcIds, npcCount) &&
+                 columns[NpcBalances].doubles(frame.npcBalances, npcCount) &&
+                 columns[NpcScores].ints(frame.npcScores, npcCount);
+            if (!ok) {
+                return false; // Truncated column
+            }
+
+            for (std::int64_t i = 0; i < businessCount; ++i) {
+                out << frame.tick << ",business," << frame.businessIds[i] << ",," << frame.stockPrices[i] << ",,\n";
+            }
+            for (std::int64_t i = 0; i < rowCount; ++i) {
+                out << frame.tick << ",product," << frame.rowBusinesses[i] << "," << productName(frame.rowProducts[i])
+                    << "," << frame.rowPrices[i] << "," << frame.rowSupply[i] << "," << frame.rowDemand[i] << "\n";
+            }
+            for (std::int64_t i = 0; i < npcCount; ++i) {
+                out << frame.tick << ",npc," << frame.npcIds[i] << ",," << frame.npcBalances[i] << ","
+                    << frame.npcScores[i] << ",\n";
+            }
+        }
+    }
+    return true;
+}
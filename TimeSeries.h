@@ -0,0 +1,115 @@
+#pragma once
+#ifndef TIME_SERIES_H
+#define TIME_SERIES_H
+
+#include "ProductCatalog.h"
+#include "World.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class TimeSeriesRecorder
+ * @brief Streams the per-tick market state to a columnar file.
+ *
+ * Every recorded tick captures, in slot order, the stock price of every business; the price, supply and demand of
+ * every product row; and the balance and score of every NPC. The tick loop only copies these values into a
+ * reusable frame. A background thread encodes the frames and writes them out as chunks of columns, so the loop
+ * never waits for the disk unless the writer falls a whole queue of frames behind.
+ *
+ * Within a chunk each column is stored contiguously and every value is encoded against the value at the same
+ * position in the previous tick: integers as zigzag varint deltas, doubles as the varint of their XOR with the
+ * previous value (byte-reversed, so the zero low bits of slowly moving values cost nothing). Chunks start from a
+ * blank previous tick, so each decodes on its own, and memory stays bounded by the frame queue and one chunk.
+ */
+class TimeSeriesRecorder {
+  public:
+    static constexpr std::size_t QUEUE_FRAMES = 8;              // Captured frames waiting for the writer, at most
+    static constexpr std::size_t CHUNK_TICKS = 64;              // Ticks per chunk, at most
+    static constexpr std::size_t CHUNK_BYTES = 8u * 1024 * 1024; // Encoded bytes per chunk before it is flushed
+
+    TimeSeriesRecorder() = default;
+    ~TimeSeriesRecorder();
+
+    TimeSeriesRecorder(const TimeSeriesRecorder&) = delete;
+    TimeSeriesRecorder& operator=(const TimeSeriesRecorder&) = delete;
+
+    /**
+     * @brief Start recording to a file, replacing it.
+     * @return false if the file cannot be opened.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Write every captured tick and close the file.
+     */
+    void close();
+
+    bool isOpen() const noexcept { return file_ != nullptr; }
+
+    /**
+     * @brief Capture the state of a world after a tick.
+     * @param world The world, at a tick boundary.
+     * @param tick The tick that just ran.
+     */
+    void record(const World& world, std::uint64_t tick);
+
+    /**
+     * @brief Convert a recorded file to CSV, one row per entity and tick.
+     * Columns: tick, table (business, product or npc), id, product, then the values of the table: stock price;
+     * price, supply and demand; balance and score.
+     * @return false if the file cannot be read, is corrupt or ends inside a block, which is found before any row is
+     * written.
+     */
+    static bool decode(const std::string& path, std::ostream& out);
+
+  private:
+    // Values of one tick, in slot order; the vectors keep their capacity between ticks
+    struct Frame {
+        std::uint64_t tick = 0;
+        std::vector<std::int64_t> businessIds;
+        std::vector<double> stockPrices;
+        std::vector<std::int64_t> rowBusinesses; // Business ID of every product row
+        std::vector<std::int64_t> rowProducts;
+        std::vector<double> rowPrices;
+        std::vector<std::int64_t> rowSupply;
+        std::vector<double> rowDemand;
+        std::vector<std::int64_t> npcIds;
+        std::vector<double> npcBalances;
+        std::vector<std::int64_t> npcScores;
+    };
+
+    void writerLoop();               // Body of the writer thread
+    void encode(const Frame& frame); // Append a frame to the current chunk
+    void flushChunk();               // Write the current chunk and start a new one
+    void writeNames();               // Write the product names the rows refer to
+
+    std::FILE* file_ = nullptr;
+    std::thread writer_;
+
+    std::mutex mutex_;                          // Guards the queues and stopping_
+    std::condition_variable filled_;            // Signals the writer that a frame was captured or the file closes
+    std::condition_variable drained_;           // Signals the tick loop that a frame can be reused
+    std::deque<std::unique_ptr<Frame>> queue_;  // Captured frames, in tick order
+    std::vector<std::unique_ptr<Frame>> spare_; // Frames ready to be reused
+    std::size_t frames_ = 0;                    // Frames allocated so far, at most QUEUE_FRAMES
+    bool stopping_ = false;
+
+    // Current chunk, owned by the writer thread
+    std::uint64_t chunkFirstTick_ = 0;
+    std::uint32_t chunkTicks_ = 0;
+    std::vector<std::vector<std::uint8_t>> columns_; // Encoded bytes of every column
+    std::size_t chunkSize_ = 0;                      // Encoded bytes of the current chunk
+    Frame previous_;                                 // Previous tick of the chunk, the base of the deltas
+};
+
+#endif // TIME_SERIES_H
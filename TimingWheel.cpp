@@ -0,0 +1,67 @@
+#include "TimingWheel.h"
+
+#include <utility>
+
+void TimingWheel::reset(std::uint64_t now) {
+    for (auto& bucket : buckets_) {
+        bucket.clear();
+    }
+    overflow_.clear();
+    ready_.clear();
+    now_ = now;
+    size_ = 0;
+}
+
+void TimingWheel::schedule(const Timer& timer) {
+    ++size_;
+    if (timer.due <= now_) {
+        ready_.push_back(timer); // Already late, fires on the next advance()
+    } else {
+        place(timer);
+    }
+}
+
+void TimingWheel::advance(std::uint64_t tick, std::vector<Timer>& due) {
+    size_ -= ready_.size();
+    due.insert(due.end(), ready_.begin(), ready_.end());
+    ready_.clear();
+    if (size_ == 0 && tick > now_) {
+        now_ = tick; // Nothing waits, skip the idle ticks
+        return;
+    }
+    while (now_ < tick) {
+        std::uint64_t t = ++now_;
+        // Entering a new span of a level: bring its bucket down, highest level first so timers can fall through
+        if ((t & ((1ull << (BITS * LEVELS)) - 1)) == 0) {
+            cascade(overflow_);
+        }
+        for (unsigned level = LEVELS - 1; level > 0; --level) {
+            if ((t & ((1ull << (BITS * level)) - 1)) == 0) {
+                cascade(buckets_[level * BUCKETS + ((t >> (BITS * level)) & (BUCKETS - 1))]);
+            }
+        }
+        std::vector<Timer>& bucket = buckets_[t & (BUCKETS - 1)];
+        size_ -= bucket.size();
+        due.insert(due.end(), bucket.begin(), bucket.end());
+        bucket.clear();
+    }
+}
+
+void TimingWheel::place(const Timer& timer) {
+    for (unsigned level = 0; level < LEVELS; ++level) {
+        unsigned shift = BITS * (level + 1);
+        if ((timer.due >> shift) == (now_ >> shift)) {
+            buckets_[level * BUCKETS + ((timer.due >> (BITS * level)) & (BUCKETS - 1))].push_back(timer);
+            return;
+        }
+    }
+    overflow_.push_back(timer);
+}
+
+void TimingWheel::cascade(std::vector<Timer>& bucket) {
+    moving_.clear();
+    std::swap(moving_, bucket); // The bucket may receive some of its own timers back
+    for (const Timer& timer : moving_) {
+        place(timer);
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class TimingWheel
+ * @brief Hierarchical timing wheel of tick timers.
+ *
+ * Four levels of 64 buckets cover 2^24 ticks ahead; later timers wait in an overflow list. A timer goes to the
+ * lowest level whose bucket span still separates it from the current tick, and is moved down a level when the
+ * wheel reaches its bucket, so scheduling is O(1) and every timer is moved at most once per level. Advancing costs
+ * O(1) per tick plus the timers that fall due, whatever the number of timers waiting.
+ */
+class TimingWheel {
+  public:
+    /**
+     * @struct Timer
+     * @brief A pending event.
+     */
+    struct Timer {
+        std::uint64_t payload;   // Opaque value given back when the timer fires, e.g. handle bits
+        std::uint64_t scheduled; // Tick the timer was scheduled at
+        std::uint64_t due;       // Tick the timer fires at
+    };
+
+    /**
+     * @brief Create an empty wheel.
+     * @param now The last tick already processed; timers are due after it.
+     */
+    explicit TimingWheel(std::uint64_t now = 0) noexcept : now_(now) {}
+
+    std::uint64_t now() const noexcept { return now_; }   // Last tick processed
+    std::size_t size() const noexcept { return size_; } // Timers waiting
+
+    /**
+     * @brief Drop every timer and restart from a tick.
+     */
+    void reset(std::uint64_t now);
+
+    /**
+     * @brief Add a timer. A timer due at or before now() fires on the next advance().
+     */
+    void schedule(const Timer& timer);
+
+    /**
+     * @brief Move the wheel forward to a tick and collect every timer due by then.
+     * @param tick The tick to reach; earlier ticks are ignored.
+     * @param due Receives the timers that fired, appended in the order they fell due.
+     */
+    void advance(std::uint64_t tick, std::vector<Timer>& due);
+
+  private:
+    static constexpr unsigned LEVELS = 4;
+    static constexpr unsigned BITS = 6; // log2 of the buckets per level
+    static constexpr std::uint64_t BUCKETS = 1ull << BITS;
+
+    void place(const Timer& timer); // Put a timer due after now_ in its bucket
+    void cascade(std::vector<Timer>& bucket);
+
+    std::array<std::vector<Timer>, LEVELS * BUCKETS> buckets_; // Level-major buckets
+    std::vector<Timer> overflow_;                              // Timers beyond the last level
+    std::vector<Timer> ready_;                                 // Timers scheduled at or before now_
+    std::vector<Timer> moving_;                                // Scratch of cascade()
+    std::uint64_t now_;
+    std::size_t size_ = 0;
+};
+
+#endif // TIMING_WHEEL_H
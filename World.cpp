@@ -0,0 +1,119 @@
+#include "World.h"
+#include "EventLog.h"
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+World::~World() {
+    // Hand every product block back in one compaction per table; releasing them one by one shifts the rows behind
+    // each block, which is quadratic in the number of businesses
+    std::vector<std::pair<ProductTable*, std::vector<ProductTable::Slot>>> tables;
+    for (std::uint32_t i = 0; i < businesses_.slots(); ++i) {
+        Business* business = businesses_.at(i);
+        if (business == nullptr || business->slot_ == ProductTable::NO_SLOT) {
+            continue;
+        }
+        auto it = std::find_if(tables.begin(), tables.end(), [&](const auto& entry) {
+            return entry.first == business->table_;
+        });
+        if (it == tables.end()) {
+            it = tables.insert(tables.end(), {business->table_, {}});
+        }
+        it->second.push_back(std::exchange(business->slot_, ProductTable::NO_SLOT)); // The destructor skips it
+    }
+    for (auto& [table, slots] : tables) {
+        table->releaseSlots(slots);
+    }
+}
+
+BusinessHandle World::createBusiness(std::string name, std::string description, Money capital) {
+    std::unique_lock<std::mutex> lock(businessMutex_);
+    BusinessHandle handle = businesses_.create(std::move(name), std::move(description));
+    Business* business = businesses_.get(handle);
+    business->handle_ = handle; // Lets the business tag its execution reports
+    business->aggregates_ = &aggregates_;
+    businessIds_.emplace(business->id(), handle);
+    aggregates_.addBusiness(*business);
+    ledger_.transfer({Account::system(), Account::business(handle.index), capital, TransferKind::Capital});
+    createdBusinesses_.push_back(handle);
+    lock.unlock();
+
+    EventRecord opened{.kind = EventKind::BusinessOpened, .business = static_cast<std::uint32_t>(business->id())};
+    opened.setText(business->name());
+    EventLog::emit(EventLevel::Warning, opened);
+    Metrics::count(Counter::BusinessesCreated);
+    return handle;
+}
+
+NpcHandle World::createNpc(std::string name, Money endowment) {
+    return adoptNpc(npcs_.create(std::move(name)), endowment);
+}
+
+NpcHandle World::createNpc(std::string name, Money endowment, std::uint64_t id) {
+    return adoptNpc(npcs_.create(std::move(name), id), endowment);
+}
+
+NpcHandle World::adoptNpc(NpcHandle handle, Money endowment) {
+    Npc* npc = npcs_.get(handle);
+    npc->handle_ = handle; // Lets the NPC tag the orders it submits itself
+    ledger_.transfer({Account::system(), Account::npc(handle.index), endowment, TransferKind::Endowment});
+    createdNpcs_.push_back(handle);
+
+    EventRecord created{.kind = EventKind::NpcCreated, .actor = npc->id()};
+    created.setText(npc->name());
+    EventLog::emit(EventLevel::Warning, created);
+    Metrics::count(Counter::NpcsCreated);
+    return handle;
+}
+
+void World::destroyBusiness(BusinessHandle handle) {
+    std::lock_guard<std::mutex> lock(businessMutex_);
+    if (const Business* business = businesses_.get(handle)) {
+        EventLog::emit(EventLevel::Warning,
+                       {.kind = EventKind::BusinessClosed, .business = static_cast<std::uint32_t>(business->id())});
+        businessIds_.erase(business->id()); // The ID is retired with the business
+        aggregates_.removeBusiness(*business);
+        ledger_.transfer({Account::business(handle.index), Account::system(), business->balance(),
+                          TransferKind::Liquidation});
+        Metrics::count(Counter::BusinessesClosed);
+    }
+    businesses_.destroy(handle);
+}
+
+void World::reserve(std::size_t businesses, std::size_t npcs) {
+    businesses_.reserve(businesses_.slots() + businesses); // Enough even if no freed slot is reused
+    npcs_.reserve(npcs_.slots() + npcs);
+    businessIds_.reserve(businessIds_.size() + businesses);
+    createdBusinesses_.reserve(createdBusinesses_.size() + businesses);
+    createdNpcs_.reserve(createdNpcs_.size() + npcs);
+}
+
+Business* World::businessById(int id) noexcept {
+    auto it = businessIds_.find(id);
+    return it != businessIds_.end() ? businesses_.get(it->second) : nullptr;
+}
+
+const Business* World::businessById(int id) const noexcept {
+    auto it = businessIds_.find(id);
+    return it != businessIds_.end() ? businesses_.get(it->second) : nullptr;
+}
+
+void World::clearCreated() noexcept {
+    createdBusinesses_.clear();
+    createdNpcs_.clear();
+}
+
+void World::destroyNpc(NpcHandle handle) {
+    if (const Npc* npc = npcs_.get(handle)) {
+        ledger_.transfer({Account::npc(handle.index), Account::system(), npc->balance(), TransferKind::Liquidation});
+        ledger_.transfer({Account::savings(handle.index), Account::system(), npc->savingsAccount(),
+                          TransferKind::Liquidation});
+    }
+    npcs_.destroy(handle);
+}
@@ -0,0 +1,115 @@
+#pragma once
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "Business.h"
+#include "Handle.h"
+#include "Ledger.h"
+#include "MarketAggregates.h"
+#include "Npc.h"
+#include "SlotPool.h"
+
+#include <cstddef>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class World
+ * @brief Registry owning every business and NPC of a simulation.
+ * Entities live in slot pools and are referred to by generational handles; a handle to a destroyed entity resolves
+ * to nullptr. Creating and destroying entities is O(1) and reuses freed slots.
+ * Businesses can be created and destroyed from several threads at once, as long as no thread reads the world
+ * meanwhile; everything else must run on one thread or on disjoint entities.
+ * New entities are funded through the ledger and destroyed ones hand their money back to it, so the money supply
+ * only changes through journal entries.
+ */
+class World {
+  public:
+    World() : ledger_(*this) {}
+    ~World();
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+
+    /**
+     * @brief Create a business.
+     * @param name The name of the business.
+     * @param description The description of the business.
+     * @param capital The balance the business is funded with.
+     * @return The handle to the new business.
+     */
+    BusinessHandle createBusiness(std::string name, std::string description = {}, Money capital = Business::CAPITAL);
+
+    /**
+     * @brief Create an NPC.
+     * @param name The name of the NPC.
+     * @param endowment The balance the NPC is funded with.
+     * @return The handle to the new NPC.
+     */
+    NpcHandle createNpc(std::string name, Money endowment = Npc::ENDOWMENT);
+
+    /**
+     * @brief Create an NPC with a given creation number, for worlds holding only part of a population.
+     * @see Npc::Npc(std::string_view, std::uint64_t)
+     */
+    NpcHandle createNpc(std::string name, Money endowment, std::uint64_t id);
+
+    /**
+     * @brief Make room for a number of entities on top of the existing ones, so creating them does not reallocate.
+     */
+    void reserve(std::size_t businesses, std::size_t npcs);
+
+    void destroyBusiness(BusinessHandle handle); // Destroy a business, stale handles are ignored
+    void destroyNpc(NpcHandle handle);           // Destroy an NPC, stale handles are ignored
+
+    Business* business(BusinessHandle handle) noexcept { return businesses_.get(handle); } // nullptr if stale
+    const Business* business(BusinessHandle handle) const noexcept { return businesses_.get(handle); }
+    Business* businessById(int id) noexcept;             // nullptr if no live business has the ID
+    const Business* businessById(int id) const noexcept; // nullptr if no live business has the ID
+    Npc* npc(NpcHandle handle) noexcept { return npcs_.get(handle); } // nullptr if stale
+    const Npc* npc(NpcHandle handle) const noexcept { return npcs_.get(handle); }
+
+    SlotPool<Business>& businesses() noexcept { return businesses_; } // Every business, by slot
+    const SlotPool<Business>& businesses() const noexcept { return businesses_; }
+    SlotPool<Npc>& npcs() noexcept { return npcs_; } // Every NPC, by slot
+    const SlotPool<Npc>& npcs() const noexcept { return npcs_; }
+
+    /**
+     * @brief Get the entities created since the last clearCreated(), in creation order.
+     * Lets a scheduler pick up new entities without scanning the world; restored entities are not listed.
+     */
+    std::span<const BusinessHandle> createdBusinesses() const noexcept { return createdBusinesses_; }
+    std::span<const NpcHandle> createdNpcs() const noexcept { return createdNpcs_; }
+    void clearCreated() noexcept; // Forget the entities created so far
+
+    /**
+     * @brief Get the market-wide totals and indices, kept up to date as businesses change.
+     * Changes marked during ticks only show after MarketAggregates::refresh(), which readers call between ticks.
+     */
+    MarketAggregates& aggregates() noexcept { return aggregates_; }
+    const MarketAggregates& aggregates() const noexcept { return aggregates_; }
+
+    /**
+     * @brief Get the ledger every balance of the world changes through.
+     */
+    Ledger& ledger() noexcept { return ledger_; }
+    const Ledger& ledger() const noexcept { return ledger_; }
+
+  private:
+    friend class Snapshot; // Rebuilds the ID index, the aggregates and the ledger of restored entities
+
+    NpcHandle adoptNpc(NpcHandle handle, Money endowment); // Fund and register a newly created NPC
+
+    SlotPool<Business> businesses_;
+    SlotPool<Npc> npcs_;
+    std::unordered_map<int, BusinessHandle> businessIds_; // Live businesses by ID
+    std::mutex businessMutex_;                            // Serializes business creation and destruction
+    MarketAggregates aggregates_;                         // Totals over the live businesses
+    Ledger ledger_;                                       // Accounts of every entity
+    std::vector<BusinessHandle> createdBusinesses_;       // Created since the last clearCreated()
+    std::vector<NpcHandle> createdNpcs_;                  // Created since the last clearCreated()
+};
+
+#endif // WORLD_H
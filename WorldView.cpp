@@ -0,0 +1,149 @@
+#include "WorldView.h"
+#include "World.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <vector>
+
+namespace {
+
+// Sort keys of prices: NaN sorts after every price, whichever the direction, so it never breaks the order of a sort
+double highestFirst(double price) noexcept {
+    return std::isnan(price) ? -std::numeric_limits<double>::infinity() : price;
+}
+
+double cheapestFirst(double price) noexcept {
+    return std::isnan(price) ? std::numeric_limits<double>::infinity() : price;
+}
+
+// Indexes of rows sorted by a key, highest first; ties keep slot order
+template <class Rows, class Key> void sortDescending(std::vector<std::uint32_t>& order, const Rows& rows, Key key) {
+    order.resize(rows.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+        return key(rows[a]) > key(rows[b]);
+    });
+}
+
+template <class Row> std::vector<Row> gather(const std::vector<Row>& rows, const std::vector<std::uint32_t>& order,
+                                             std::size_t k) {
+    std::vector<Row> top;
+    top.reserve(std::min(k, order.size()));
+    for (std::size_t i = 0; i < order.size() && i < k; ++i) {
+        top.push_back(rows[order[i]]);
+    }
+    return top;
+}
+
+} // namespace
+
+std::vector<BusinessSummary> WorldView::topBusinesses(std::size_t k) const {
+    return gather(businesses_, byStockPrice_, k);
+}
+
+std::vector<NpcSummary> WorldView::richestNpcs(std::size_t k) const {
+    return gather(npcs_, byBalance_, k);
+}
+
+std::vector<NpcSummary> WorldView::topScorers(std::size_t k) const {
+    return gather(npcs_, byScore_, k);
+}
+
+std::span<const ProductOffer> WorldView::offers(ProductId product) const noexcept {
+    if (product + std::size_t{1} >= productStart_.size()) {
+        return {}; // No business offered the product
+    }
+    return {offers_.data() + productStart_[product], productStart_[product + 1] - productStart_[product]};
+}
+
+std::span<const ProductOffer> WorldView::offers(ProductId product, double minPrice, double maxPrice) const noexcept {
+    std::span<const ProductOffer> all = offers(product);
+    auto begin = std::partition_point(all.begin(), all.end(), [&](const ProductOffer& offer) {
+        return cheapestFirst(offer.price) < minPrice;
+    });
+    auto end = std::partition_point(begin, all.end(), [&](const ProductOffer& offer) {
+        return cheapestFirst(offer.price) <= maxPrice;
+    });
+    return {begin, end};
+}
+
+std::int64_t WorldView::supply(ProductId product) const noexcept {
+    return product < productSupply_.size() ? productSupply_[product] : 0;
+}
+
+void WorldView::capture(const World& world, std::uint64_t tick) {
+    tick_ = tick;
+    businesses_.clear();
+    npcs_.clear();
+    captured_.clear();
+
+    const SlotPool<Business>& businesses = world.businesses();
+    for (std::uint32_t i = 0; i < businesses.slots(); ++i) {
+        const Business* business = businesses.at(i);
+        if (business == nullptr) {
+            continue;
+        }
+        std::uint32_t index = static_cast<std::uint32_t>(businesses_.size());
+        businesses_.push_back({business->handle(), business->id(), business->stockPrice(), business->stockDemand(),
+                               business->balance(), business->sharesOutstanding()});
+        std::span<const ProductId> products = business->products();
+        std::span<const double> prices = business->prices();
+        std::span<const int> supply = business->supply();
+        for (std::size_t row = 0; row < products.size(); ++row) {
+            captured_.push_back({products[row], index, prices[row], supply[row]});
+        }
+    }
+
+    const SlotPool<Npc>& npcs = world.npcs();
+    for (std::uint32_t i = 0; i < npcs.slots(); ++i) {
+        if (const Npc* npc = npcs.at(i)) {
+            npcs_.push_back({npc->handle(), npc->id(), npc->balance(), npc->savingsAccount(), npc->score(),
+                             npc->strategy()});
+        }
+    }
+}
+
+void WorldView::index() {
+    // Counting sort of the product rows by product, then every product by price, cheapest first
+    ProductId products = 0;
+    for (const ProductOffer& offer : captured_) {
+        if (offer.product != INVALID_PRODUCT) {
+            products = std::max<ProductId>(products, offer.product + 1);
+        }
+    }
+    productStart_.assign(products + std::size_t{1}, 0);
+    productSupply_.assign(products, 0);
+    for (const ProductOffer& offer : captured_) {
+        if (offer.product != INVALID_PRODUCT) {
+            ++productStart_[offer.product + std::size_t{1}];
+            productSupply_[offer.product] += offer.supply;
+        }
+    }
+    for (std::size_t p = 0; p < products; ++p) {
+        productStart_[p + 1] += productStart_[p];
+    }
+    offers_.resize(productStart_.back());
+    cursor_.assign(productStart_.begin(), productStart_.end() - 1);
+    for (const ProductOffer& offer : captured_) {
+        if (offer.product != INVALID_PRODUCT) {
+            offers_[cursor_[offer.product]++] = offer;
+        }
+    }
+    for (std::size_t p = 0; p < products; ++p) {
+        std::stable_sort(offers_.begin() + productStart_[p], offers_.begin() + productStart_[p + 1],
+                         [](const ProductOffer& a, const ProductOffer& b) {
+                             return cheapestFirst(a.price) < cheapestFirst(b.price);
+                         });
+    }
+
+    sortDescending(byStockPrice_, businesses_, [](const BusinessSummary& business) {
+        return highestFirst(business.stockPrice);
+    });
+    sortDescending(byBalance_, npcs_, [](const NpcSummary& npc) { return npc.balance; });
+    sortDescending(byScore_, npcs_, [](const NpcSummary& npc) { return npc.score; });
+}
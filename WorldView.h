@@ -0,0 +1,118 @@
+#pragma once
+#ifndef WORLD_VIEW_H
+#define WORLD_VIEW_H
+
+#include "Handle.h"
+#include "Money.h"
+#include "NpcStrategy.h"
+#include "ProductCatalog.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class World;
+
+/**
+ * @struct BusinessSummary
+ * @brief State of a business in a WorldView.
+ */
+struct BusinessSummary {
+    BusinessHandle handle;
+    int id = 0;
+    double stockPrice = 0;
+    double stockDemand = 0;
+    Money balance;
+    std::int64_t sharesOutstanding = 0;
+};
+
+/**
+ * @struct NpcSummary
+ * @brief State of an NPC in a WorldView.
+ */
+struct NpcSummary {
+    NpcHandle handle;
+    std::uint64_t id = 0;
+    Money balance;
+    Money savings;
+    int score = 0;
+    StrategyId strategy = StrategyId::Speculator;
+};
+
+/**
+ * @struct ProductOffer
+ * @brief A product row of a business in a WorldView.
+ */
+struct ProductOffer {
+    ProductId product = INVALID_PRODUCT;
+    std::uint32_t business = 0; // Index of the business in WorldView::businesses()
+    double price = 0;
+    int supply = 0;
+};
+
+/**
+ * @class WorldView
+ * @brief Immutable copy of the market at a tick boundary, with the indexes queries need.
+ *
+ * Businesses and NPCs are listed in slot order. Indexes sort them by stock price, balance and score for top-K
+ * queries, and group the product rows by product, cheapest first, for per-product totals and price ranges. Views
+ * are built by QueryService and never change once published, so any number of threads can query one at a time.
+ */
+class WorldView {
+  public:
+    std::uint64_t tick() const noexcept { return tick_; } // Tick the view was taken after
+
+    std::span<const BusinessSummary> businesses() const noexcept { return businesses_; }
+    std::span<const NpcSummary> npcs() const noexcept { return npcs_; }
+
+    /**
+     * @brief Get the k businesses with the highest stock price, highest first.
+     */
+    std::vector<BusinessSummary> topBusinesses(std::size_t k) const;
+
+    /**
+     * @brief Get the k NPCs with the highest balance, highest first.
+     */
+    std::vector<NpcSummary> richestNpcs(std::size_t k) const;
+
+    /**
+     * @brief Get the k NPCs with the highest score, highest first.
+     */
+    std::vector<NpcSummary> topScorers(std::size_t k) const;
+
+    /**
+     * @brief Get every offer of a product, cheapest first.
+     */
+    std::span<const ProductOffer> offers(ProductId product) const noexcept;
+
+    /**
+     * @brief Get the offers of a product priced within [minPrice, maxPrice], cheapest first.
+     */
+    std::span<const ProductOffer> offers(ProductId product, double minPrice, double maxPrice) const noexcept;
+
+    /**
+     * @brief Get the supply of a product across the market.
+     */
+    std::int64_t supply(ProductId product) const noexcept;
+
+  private:
+    friend class QueryService; // Captures and indexes views before publishing them
+
+    void capture(const World& world, std::uint64_t tick); // Copy the market, reusing the capacity of the view
+    void index();                                         // Build the indexes of the captured market
+
+    std::uint64_t tick_ = 0;
+    std::vector<BusinessSummary> businesses_;
+    std::vector<NpcSummary> npcs_;
+    std::vector<ProductOffer> offers_;        // By product, then price
+    std::vector<std::size_t> productStart_;   // First offer of every product in offers_
+    std::vector<std::int64_t> productSupply_; // Supply of every product
+    std::vector<std::uint32_t> byStockPrice_; // Indexes of businesses_, highest stock price first
+    std::vector<std::uint32_t> byBalance_;    // Indexes of npcs_, highest balance first
+    std::vector<std::uint32_t> byScore_;      // Indexes of npcs_, highest score first
+    std::vector<std::size_t> cursor_;         // Write cursors of the grouping pass
+    std::vector<ProductOffer> captured_;      // Product rows in business order, as captured
+};
+
+#endif // WORLD_VIEW_H